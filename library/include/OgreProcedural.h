@@ -41,13 +41,16 @@ THE SOFTWARE.
 #include "OgreProceduralPlaneGenerator.h"
 #include "OgreProceduralRoot.h"
 #include "OgreProceduralExtruder.h"
+#include "OgreProceduralIncrementalExtruder.h"
 #include "OgreProceduralLathe.h"
 #include "OgreProceduralShape.h"
 #include "OgreProceduralShapeGenerators.h"
 #include "OgreProceduralMultiShape.h"
+#include "OgreProceduralPointInsideIndex.h"
 #include "OgreProceduralPath.h"
 #include "OgreProceduralPathGenerators.h"
 #include "OgreProceduralTriangulator.h"
+#include "OgreProceduralTriangulationCache.h"
 #include "OgreProceduralTriangleBuffer.h"
 #include "OgreProceduralTrack.h"
 
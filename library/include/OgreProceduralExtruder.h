@@ -34,14 +34,62 @@ THE SOFTWARE.
 #include "OgreProceduralMeshGenerator.h"
 #include "OgreProceduralMultiShape.h"
 #include "OgreProceduralTrack.h"
+#include "OgreProceduralTriangulationCache.h"
+#include "OgreProceduralProfileTable.h"
 
 namespace OgreProcedural
 {
+/**
+ * Supplies the points of an extrusion path one after the other,
+ * for paths which are too long to be held in memory, such as paths read from a file while they are extruded.
+ * @see Extruder::streamChunks
+ */
+class _ProceduralExport PathSource
+{
+public:
+	virtual ~PathSource() {}
+
+	/**
+	 * Gets the next point of the path
+	 * @arg point Receives the point
+	 * @return false when there are no more points
+	 */
+	virtual bool nextPoint(Ogre::Vector3& point) = 0;
+};
+
+/**
+ * Receives the chunks of a streamed extrusion, as soon as each one is finished
+ * @see Extruder::streamChunks
+ */
+class _ProceduralExport ExtrusionChunkSink
+{
+public:
+	virtual ~ExtrusionChunkSink() {}
+
+	/**
+	 * Receives a chunk. The buffer is dropped afterwards, so the chunk has to be turned into a mesh, or copied, right away.
+	 * @arg buffer The chunk
+	 * @arg chunkIndex The index of the chunk along the path, starting from 0
+	 */
+	virtual void chunk(TriangleBuffer& buffer, size_t chunkIndex) = 0;
+};
+
 /** Extrudes a 2D shape along a path to build an extruded mesh.
  * Can be used to build things such as pipelines, roads...
  */
 class _ProceduralExport Extruder : public MeshGenerator<Extruder>
 {
+	friend class IncrementalExtruder;
+public:
+	/// Tells how the sections are oriented along the extrusion path
+	enum FrameMode
+	{
+		/// The Y axis of the sections stays as close as possible to the up vector
+		FM_FIXED_UP,
+		/// The sections turn as little as possible around the path (rotation minimizing frames), so they never flip
+		FM_ROTATION_MINIMIZING
+	};
+private:
 	Shape* mShapeToExtrude;
 	MultiShape* mMultiShapeToExtrude;
 	Path* mExtrusionPath;
@@ -49,14 +97,80 @@ class _ProceduralExport Extruder : public MeshGenerator<Extruder>
 	bool mFixSharpAngles;
 	Track* mRotationTrack;
 	Track* mScaleTrack;
+	TriangulationCache* mTriangulationCache;
+	FrameMode mFrameMode;
+	Ogre::Vector3 mUpVector;
+	Ogre::Real mBanking;
+	unsigned int mNumThreads;
+	Ogre::Real mChunkLength;
+	unsigned int mChunkSegCount;
 
-	void _extrudeBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude) const;
+	/// Placement of the section at a point of the path, shared by all the shapes which are extruded
+	struct Section
+	{
+		Ogre::Vector3 position;
+		Ogre::Quaternion orientation;
+		Ogre::Real scale;
+		/// Texture coordinate along the path, before tiling
+		Ogre::Real u;
+	};
 
-	void _extrudeCapImpl(TriangleBuffer& buffer) const;
+	/**
+	 * Computes the Y axis of the frame at a point of the path, going on from the frame at the previous point
+	 * @arg z The direction of the path at the point
+	 * @arg first Whether it's the first point, whose frame only depends on the up vector
+	 * @arg previousY The Y axis of the frame at the previous point
+	 * @arg previousZ The direction of the path at the previous point
+	 * @arg segment The segment from the previous point to this one
+	 */
+	Ogre::Vector3 _getFrameYAxis(const Ogre::Vector3& z, bool first, const Ogre::Vector3& previousY, const Ogre::Vector3& previousZ, const Ogre::Vector3& segment) const;
+
+	/// Rolls a frame into the turn of the path, given the directions of the path around it, and the length ds between them
+	Ogre::Quaternion _bankFrame(const Ogre::Quaternion& frame, const Ogre::Vector3& previousTangent, const Ogre::Vector3& nextTangent, Ogre::Real ds) const;
+
+	/**
+	 * Computes the orientation of the section at each point of the path, in a single pass.
+	 * The Z axis of each frame follows the path, and its Y axis is the up direction of the section.
+	 */
+	void _computeFrames(const Path& path, std::vector<Ogre::Quaternion>& frames) const;
+
+	/**
+	 * Computes the placement of the section at each point of the path, merged with the keys of the tracks,
+	 * and the placements of the begin and end caps, which take the first and last values of the tracks.
+	 */
+	void _computeSections(std::vector<Section>& sections, Section caps[2]) const;
+
+	/// Lists the shapes to extrude, whether there is a single shape or a multishape
+	void _getShapes(std::vector<const Shape*>& shapes) const;
+
+	/**
+	 * Writes the rings from firstRing to lastRing (excluded) of the body of a shape, in room already made in the buffer.
+	 * The body goes from ring bodyFirstRing to ring bodyLastRing (included) : ring i starts at vertex firstVertex+(i-bodyFirstRing)*(shape points count),
+	 * and its triangles, which join it to the next ring, at index firstIndex+(i-bodyFirstRing)*(shape segments count)*6.
+	 */
+	void _extrudeBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude, const ProfileTable& profile, const std::vector<Section>& sections,
+		unsigned int bodyFirstRing, unsigned int bodyLastRing, size_t firstVertex, size_t firstIndex, unsigned int firstRing, unsigned int lastRing) const;
+
+	/**
+	 * Writes the body of all the shapes, from ring bodyFirstRing to ring bodyLastRing (included), at the end of the buffer.
+	 * Threads share the rings of all the shapes.
+	 */
+	void _extrudeBody(TriangleBuffer& buffer, const std::vector<const Shape*>& shapes, const std::vector<ProfileTable>& profiles,
+		const std::vector<Section>& sections, unsigned int bodyFirstRing, unsigned int bodyLastRing, unsigned int numThreads) const;
+
+	/// Lists the shapes to extrude, and reads their points
+	void _readProfiles(std::vector<const Shape*>& shapes, std::vector<ProfileTable>& profiles) const;
+
+	class CapSink;
+
+	/// Writes the begin and end caps, each into its buffer, which may be the same
+	void _extrudeCapImpl(TriangleBuffer& bufferBegin, const Section& capBegin, TriangleBuffer& bufferEnd, const Section& capEnd) const;
 
 public:
 	/// Default constructor
-	Extruder() : mShapeToExtrude(0), mExtrusionPath(0), mCapped(true), mFixSharpAngles(false), mRotationTrack(0), mScaleTrack(0)
+	Extruder() : mShapeToExtrude(0), mExtrusionPath(0), mCapped(true), mFixSharpAngles(false), mRotationTrack(0), mScaleTrack(0), mTriangulationCache(0),
+		mFrameMode(FM_FIXED_UP), mUpVector(Ogre::Vector3::UNIT_Y), mBanking(0.), mNumThreads(0),
+		mChunkLength(0.), mChunkSegCount(0)
 	{}
 
 	/**
@@ -65,6 +179,37 @@ public:
 	 */
 	void addToTriangleBuffer(TriangleBuffer& buffer) const;
 
+	/**
+	 * Builds the mesh as a series of chunks along the path, each into its own TriangleBuffer, appended to the given list.
+	 * The ring at the seam between two chunks is duplicated, so that each chunk stands on its own,
+	 * and the begin and end caps go into the first and last chunks. Chunks are built in parallel.
+	 * @see setChunkLength, setChunkSegCount
+	 */
+	void addChunksToTriangleBuffers(std::vector<TriangleBuffer>& buffers) const;
+
+	/**
+	 * Builds the mesh as chunks, as addChunksToTriangleBuffers() does, along a path whose points are read from a source while the chunks are built.
+	 * The extrusion path isn't used. Only the few points around the current one, and the sections of the chunk being built, are kept,
+	 * so memory doesn't grow with the length of the path, as long as the length or the number of segments of the chunks is limited.
+	 * The path is open. Tracks can't be addressed by relative lineic position, as the length of the path is only known at its end.
+	 * For the same reason, the texture coordinate along the path is the lineic position, instead of going from 0 to 1.
+	 * @arg source Supplies the points of the path, which has at least two points
+	 * @arg sink Receives each chunk as soon as it is finished
+	 * @return The number of chunks
+	 * @exception std::runtime_error If the rotation or the scale track is addressed by relative lineic position
+	 * @see setChunkLength, setChunkSegCount
+	 */
+	size_t streamChunks(PathSource& source, ExtrusionChunkSink& sink) const;
+
+	/**
+	 * Builds one mesh per chunk, so that each one has its own bounds, for the chunks out of view to be culled.
+	 * @param name base name of the meshes, which are named name_0, name_1... If empty, each mesh gets a generated name.
+	 * @param group ressource group in which the meshes will be created
+	 * @see addChunksToTriangleBuffers
+	 */
+	std::vector<Ogre::MeshPtr> realizeChunkMeshes(const std::string& name = "",
+		const Ogre::String& group = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME) const;
+
 	/** Sets the shape to extrude. Mutually exclusive with setMultiShapeToExtrude. */
 	inline Extruder & setShapeToExtrude(Shape* shapeToExtrude)
 	{
@@ -109,6 +254,80 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Sets the cache used to triangulate the caps (default=0)
+	 * Sharing a cache between extruders of the same shape lets the caps be triangulated only once.
+	 */
+	inline Extruder & setTriangulationCache(TriangulationCache* triangulationCache)
+	{
+		mTriangulationCache = triangulationCache;
+		return *this;
+	}
+
+	/**
+	 * Sets how the sections are oriented along the path (default=FM_FIXED_UP)
+	 * Rotation minimizing frames suit paths which go up and down, such as roller coasters or cables,
+	 * where keeping a fixed up vector would flip the sections when the path gets vertical.
+	 */
+	inline Extruder & setFrameMode(FrameMode frameMode)
+	{
+		mFrameMode = frameMode;
+		return *this;
+	}
+
+	/**
+	 * Sets the up vector (default=Vector3::UNIT_Y)
+	 * With FM_FIXED_UP, the sections keep their Y axis towards it.
+	 * With FM_ROTATION_MINIMIZING, it only sets the orientation of the first section.
+	 */
+	inline Extruder & setUpVector(const Ogre::Vector3& upVector)
+	{
+		mUpVector = upVector;
+		return *this;
+	}
+
+	/**
+	 * Sets how much the sections lean into the turns of the path (default=0, no banking)
+	 * Sections roll by atan(banking*curvature), as a vehicle does when it turns
+	 * at a speed whose square is banking times the gravity.
+	 */
+	inline Extruder & setBanking(Ogre::Real banking)
+	{
+		mBanking = banking;
+		return *this;
+	}
+
+	/**
+	 * Sets the number of threads which share the rings of the extrusion (default=0, one thread per hardware core)
+	 * Small extrusions are always done in the calling thread.
+	 */
+	inline Extruder & setNumThreads(unsigned int numThreads)
+	{
+		mNumThreads = numThreads;
+		return *this;
+	}
+
+	/**
+	 * Sets the length of path covered by each chunk, when the extrusion is built as chunks (default=0, no limit)
+	 * @see addChunksToTriangleBuffers
+	 */
+	inline Extruder & setChunkLength(Ogre::Real chunkLength)
+	{
+		mChunkLength = chunkLength;
+		return *this;
+	}
+
+	/**
+	 * Sets the number of path segments in each chunk, when the extrusion is built as chunks (default=0, no limit)
+	 * A chunk ends as soon as it reaches either its length or its number of segments.
+	 * @see addChunksToTriangleBuffers
+	 */
+	inline Extruder & setChunkSegCount(unsigned int chunkSegCount)
+	{
+		mChunkSegCount = chunkSegCount;
+		return *this;
+	}
+
 	/// WIP
 	/// Sets the FixSharpAngles option (default = false)
 	/// When enabled, extruder tries to prevent the generated mesh to self intersect when
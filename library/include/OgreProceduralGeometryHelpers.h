@@ -31,6 +31,8 @@ THE SOFTWARE.
 #include "OgrePlane.h"
 #include "OgreVector2.h"
 #include "OgreVector3.h"
+#include <vector>
+#include <queue>
 
 namespace OgreProcedural
 {
@@ -137,5 +139,183 @@ class Segment2D
 	/// Tells whether this segments intersects the other segment
 	bool intersects(const Segment2D& other) const;
 };
+//-----------------------------------------------------------------------
+/// Computes the distance between a point and a segment, in 2D or 3D
+template<class T>
+Ogre::Real _distanceToSegment(const T& point, const T& a, const T& b)
+{
+	T ab = b-a;
+	Ogre::Real squaredLength = ab.squaredLength();
+	if (squaredLength<=0.)
+		return (point-a).length();
+	Ogre::Real t = Ogre::Math::Clamp((point-a).dotProduct(ab)/squaredLength, (Ogre::Real)0., (Ogre::Real)1.);
+	return (a+t*ab-point).length();
+}
+//-----------------------------------------------------------------------
+/**
+ * Finds which points of a polyline, in 2D or 3D, can be removed while keeping it close to the original one.
+ * As in Visvalingam's algorithm, the point which changes the polyline the least is removed first, again and again,
+ * the points being kept in a priority queue, so that it runs in O(n log n).
+ * The cost of removing a point also counts the error of the points already removed around it,
+ * so that no original point ever gets further than the tolerance from the simplified polyline.
+ * The ends of an open polyline and the first point of a closed one are always kept,
+ * and a closed polyline keeps at least 3 points.
+ * @arg points the points of the polyline
+ * @arg closed whether the last point is connected to the first one
+ * @arg tolerance the maximum distance between the original points and the simplified polyline
+ * @arg locked for each point, whether it must be kept. It can be empty if no point is locked.
+ * @arg kept receives, for each point, whether it is kept
+ * @arg check is asked, through canRemove(p, i, n), whether point i can go from between points p and n,
+ * and told through remove(p, i, n) when it does. A point which can't go is asked again when one of its neighbours goes.
+ */
+template<class T, class RemovalCheck>
+void _simplifyPolyline(const std::vector<T>& points, bool closed, Ogre::Real tolerance, const std::vector<bool>& locked, std::vector<bool>& kept,
+	RemovalCheck& check)
+{
+	int numPoints = (int)points.size();
+	kept.assign(numPoints, true);
+	int numKept = numPoints;
+	int minPoints = closed?3:2;
+	if (numPoints<=minPoints)
+		return;
+
+	// Doubly linked list of the points left, with an error bound on the segment after each of them
+	std::vector<int> previous(numPoints), next(numPoints), version(numPoints, 0);
+	std::vector<Ogre::Real> segmentError(numPoints, 0.);
+	for (int i=0;i<numPoints;i++)
+	{
+		previous[i] = (i==0)?numPoints-1:i-1;
+		next[i] = (i==numPoints-1)?0:i+1;
+	}
+
+	// Costs are pushed again when they change, old entries are told apart by the version of their point
+	typedef std::pair<Ogre::Real, std::pair<int, int> > QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > queue;
+	for (int i=1;i<(closed?numPoints:numPoints-1);i++)
+		if (locked.empty() || !locked[i])
+		{
+			Ogre::Real cost = _distanceToSegment(points[i], points[previous[i]], points[next[i]]);
+			queue.push(std::make_pair(cost, std::make_pair(i, 0)));
+		}
+
+	while (!queue.empty() && numKept>minPoints)
+	{
+		QueueEntry entry = queue.top();
+		queue.pop();
+		int i = entry.second.first;
+		if (entry.second.second!=version[i])
+			continue;
+		if (entry.first>tolerance)
+			break;
+
+		// Removes the point, the new segment inherits the error of the removal
+		int p = previous[i];
+		int n = next[i];
+		if (!check.canRemove(p, i, n))
+			continue;
+		check.remove(p, i, n);
+		next[p] = n;
+		previous[n] = p;
+		segmentError[p] = entry.first;
+		kept[i] = false;
+		numKept--;
+
+		// The neighbours see their costs change
+		int neighbours[2] = {p, n};
+		for (int k=0;k<2;k++)
+		{
+			int j = neighbours[k];
+			if (j==0 || (!closed && j==numPoints-1) || (!locked.empty() && locked[j]))
+				continue;
+			version[j]++;
+			Ogre::Real cost = _distanceToSegment(points[j], points[previous[j]], points[next[j]])
+				+ std::max(segmentError[previous[j]], segmentError[j]);
+			queue.push(std::make_pair(cost, std::make_pair(j, version[j])));
+		}
+	}
+}
+//-----------------------------------------------------------------------
+/// Lets _simplifyPolyline() remove any point within the tolerance
+struct AnyRemovalCheck
+{
+	bool canRemove(int, int, int)
+	{
+		return true;
+	}
+	void remove(int, int, int) {}
+};
+//-----------------------------------------------------------------------
+/// @copydoc _simplifyPolyline
+template<class T>
+void _simplifyPolyline(const std::vector<T>& points, bool closed, Ogre::Real tolerance, const std::vector<bool>& locked, std::vector<bool>& kept)
+{
+	AnyRemovalCheck check;
+	_simplifyPolyline(points, closed, tolerance, locked, kept, check);
+}
+//-----------------------------------------------------------------------
+/**
+ * Tells whether removing a point while simplifying 2D polylines would make a polyline cross itself or another polyline.
+ * As long as the polylines don't cross each other, removing point i from between points p and n can only make them cross
+ * if a point which is left lies in the triangle (p, i, n) : any polyline crossing the new segment has to go through the triangle,
+ * and can't leave it through the segments which are removed.
+ * The points are kept in a k-d tree which counts the points left under each node, so that each check runs in about O(log n),
+ * and simplification stays in O(n log n).
+ * The index works on its own copy of the points, so the polylines can be changed as soon as they are simplified.
+ */
+class SimplificationIndex
+{
+	/// Box around the points of a node of the tree, and the number of them which are left
+	struct Node
+	{
+		Ogre::Vector2 min;
+		Ogre::Vector2 max;
+		int count;
+	};
+	/// All the points, polyline after polyline
+	std::vector<Ogre::Vector2> mPoints;
+	/// Index of the first point of each polyline
+	std::vector<int> mPolylineStarts;
+	/// Neighbours of each point along its polyline, or -1
+	std::vector<int> mPrevious;
+	std::vector<int> mNext;
+	std::vector<bool> mLeft;
+	/// Points in the order of the tree, node k covering a range of them, its children being nodes 2k+1 and 2k+2
+	std::vector<int> mOrder;
+	std::vector<int> mPositions;
+	std::vector<Node> mNodes;
+	std::vector<int> mStack;
+
+	void _buildNode(int node, int first, int last);
+	bool _hasPointInTriangle(int p, int i, int n);
+
+public:
+	/// Adds a polyline. Polylines are numbered in the order they are added.
+	void addPolyline(const std::vector<Ogre::Vector2>& points, bool closed);
+
+	/// Builds the tree, once all the polylines have been added
+	void build();
+
+	/// Tells whether point i of a polyline can be removed from between its points p and n
+	bool canRemove(int polyline, int p, int i, int n);
+
+	/// Removes point i of a polyline from between its points p and n
+	void remove(int polyline, int p, int i, int n);
+
+	/// Checks the removals of the points of one of the polylines, for _simplifyPolyline()
+	struct PolylineCheck
+	{
+		SimplificationIndex& mIndex;
+		int mPolyline;
+		PolylineCheck(SimplificationIndex& index, int polyline) : mIndex(index), mPolyline(polyline) {}
+		bool canRemove(int p, int i, int n)
+		{
+			return mIndex.canRemove(mPolyline, p, i, n);
+		}
+		void remove(int p, int i, int n)
+		{
+			mIndex.remove(mPolyline, p, i, n);
+		}
+	};
+};
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,175 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef PROCEDURAL_INCREMENTAL_EXTRUDER_INCLUDED
+#define PROCEDURAL_INCREMENTAL_EXTRUDER_INCLUDED
+
+#include "OgreHardwareVertexBuffer.h"
+#include "OgreHardwareIndexBuffer.h"
+#include "OgreProceduralPlatform.h"
+#include "OgreProceduralExtruder.h"
+
+namespace OgreProcedural
+{
+/**
+ * Keeps the mesh of an extruder up to date while its path or its tracks are edited,
+ * by rewriting only the rings which have moved, straight into dynamic hardware buffers.
+ *
+ * After each edit, update() places the sections again, and compares them with the previous ones :
+ * only the rings of the sections which changed are generated and uploaded.
+ * On an open path without tracks, a section only depends on the points around it and on the frame at the previous point,
+ * so the sections are only placed again from the first point which moved, until the frames are back to their previous values.
+ * Otherwise, all the sections are placed again, which is cheap compared to writing the rings.
+ * How many sections an edit changes depends on how the extruder places them. Dragging a point of a long path costs
+ * a few rings, and appending points costs the new rings, with FM_FIXED_UP frames and with tracks addressed by point.
+ * Otherwise the edit also changes sections further along the path :
+ * - with FM_ROTATION_MINIMIZING, each frame follows the previous one, so every ring after the edited point is written again,
+ *   and on a closed path the twist is spread over the whole path, so all the rings are;
+ * - with AM_ABSOLUTE_LINEIC tracks, a drag that changes the length of the path moves every ring after the edited point;
+ * - with AM_RELATIVE_LINEIC tracks, any edit that changes the total length moves all the rings, appending included.
+ *
+ * Vertices are laid out ring after ring, each ring holding the points of all the shapes,
+ * so that growing the path doesn't move any existing vertex. The buffers are allocated with some room to spare,
+ * and are only reallocated when the path outgrows them.
+ * Texture coordinates go in their own buffer, as they all change when the number of rings changes.
+ *
+ * Changes to the shapes are only noticed if their number of points, their out side, or whether the extrusion is capped, changes :
+ * call rebuild() after moving points of the shapes.
+ * The mesh has a single submesh, with positions, 32-bit indices, and the normals and texture coordinate sets
+ * the extruder is set to produce when realizeMesh() is called. All the texture coordinate sets are the same.
+ */
+class _ProceduralExport IncrementalExtruder
+{
+	const Extruder& mExtruder;
+	Ogre::MeshPtr mMesh;
+	Ogre::SubMesh* mSubMesh;
+	/// Positions and normals, interleaved
+	Ogre::HardwareVertexBufferSharedPtr mVertexBuffer;
+	Ogre::HardwareVertexBufferSharedPtr mTexCoordBuffer;
+	Ogre::HardwareIndexBufferSharedPtr mIndexBuffer;
+
+	/// Shapes, as they were when the mesh was last rebuilt
+	std::vector<ProfileTable> mProfiles;
+	std::vector<unsigned int> mShapeSegCounts;
+	std::vector<bool> mShapeOutSidesLeft;
+	/// Number of vertices of each ring, and number of indices between two rings
+	size_t mRingVertexCount;
+	size_t mRingIndexCount;
+
+	/// Triangulation of the caps, if any : the begin cap comes first in the buffers, then the end cap, then the rings
+	bool mHasCaps;
+	std::vector<Ogre::Vector2> mCapPoints;
+	std::vector<int> mCapTriangles;
+
+	/// Layout of the vertices : positions, and normals if enabled, in the first buffer, and texture coordinate sets in the second one
+	bool mHasNormals;
+	unsigned int mTexCoordSetCount;
+
+	/// Placements of the sections and caps which are in the buffers
+	std::vector<Extruder::Section> mSections;
+	/// Sections which changed in the last placement, in increasing order, and the number of sections which were placed
+	std::vector<size_t> mChangedSections;
+	size_t mPlacedSectionCount;
+	/// On an open path without tracks, the points of the path, and the Y axes of the frames before banking,
+	/// as they were when the sections were placed, with the settings of the extruder
+	std::vector<Ogre::Vector3> mPathPoints;
+	std::vector<Ogre::Vector3> mYAxes;
+	Extruder::FrameMode mFrameMode;
+	Ogre::Vector3 mUpVector;
+	Ogre::Real mBanking;
+	Extruder::Section mCaps[2];
+	std::vector<Ogre::AxisAlignedBox> mRingBounds;
+	Ogre::AxisAlignedBox mCapBounds;
+
+	/// Number of rings the buffers have room for, and number of spaces between rings whose indices have been written
+	size_t mRingCapacity;
+	size_t mIndexedRingCount;
+	size_t mUpdatedRingCount;
+
+	static bool _isSameSection(const Extruder::Section& a, const Extruder::Section& b);
+	void _readShapes();
+	void _placeSections();
+	size_t _getVertexFloatCount() const;
+	bool _shapesHaveChanged() const;
+	void _allocateBuffers(size_t ringCapacity);
+	size_t _getCapVertexCount() const;
+	size_t _getCapIndexCount() const;
+	void _writeCaps();
+	void _writeRings(size_t firstRing, size_t lastRing);
+	void _writeTextureCoords();
+	void _writeIndices(size_t firstRing, size_t lastRing);
+	void _writeAll();
+	void _updateBounds();
+
+public:
+	/**
+	 * Constructor
+	 * @arg extruder The extruder which holds the settings, the shapes, the path and the tracks.
+	 * It must outlive this object.
+	 */
+	IncrementalExtruder(const Extruder& extruder) : mExtruder(extruder), mSubMesh(0), mRingVertexCount(0), mRingIndexCount(0), mHasCaps(false),
+		mHasNormals(true), mTexCoordSetCount(1), mPlacedSectionCount(0), mFrameMode(Extruder::FM_FIXED_UP), mBanking(0.),
+		mRingCapacity(0), mIndexedRingCount(0), mUpdatedRingCount(0)
+	{}
+
+	/**
+	 * Builds the mesh, with dynamic buffers, and remembers it for the next updates
+	 * @param name of the mesh for the MeshManager
+	 * @param group ressource group in which the mesh will be created
+	 */
+	Ogre::MeshPtr realizeMesh(const std::string& name = "",
+		const Ogre::String& group = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+
+	/**
+	 * Brings the mesh up to date with the path and the tracks of the extruder,
+	 * rewriting only the rings which have changed since the last update
+	 */
+	IncrementalExtruder& update();
+
+	/// Rewrites the whole mesh, for instance after the shapes have been edited
+	IncrementalExtruder& rebuild();
+
+	/// Gets the mesh built by realizeMesh()
+	const Ogre::MeshPtr& getMesh() const
+	{
+		return mMesh;
+	}
+
+	/// Gets the number of rings which were written by the last update() or rebuild()
+	size_t getUpdatedRingCount() const
+	{
+		return mUpdatedRingCount;
+	}
+
+	/// Gets the number of sections which were placed again by the last update() or rebuild()
+	size_t getPlacedSectionCount() const
+	{
+		return mPlacedSectionCount;
+	}
+};
+}
+#endif
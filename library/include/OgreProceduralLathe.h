@@ -41,10 +41,11 @@ class _ProceduralExport Lathe : public MeshGenerator<Lathe>
 {
 	Shape* mShapeToExtrude;
 	int mNumSeg;
+	unsigned int mNumThreads;
 
 public:
 	/// Contructor with arguments
-	Lathe(Shape* shapeToExtrude = 0, int numSeg = 16) : mShapeToExtrude(shapeToExtrude), mNumSeg(numSeg)
+	Lathe(Shape* shapeToExtrude = 0, int numSeg = 16) : mShapeToExtrude(shapeToExtrude), mNumSeg(numSeg), mNumThreads(0)
 	{}
 
 	/** Sets the number of segments when rotating around the axis (default=16)*/
@@ -54,6 +55,16 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Sets the number of threads which share the angular steps (default=0, one thread per hardware core)
+	 * Small meshes are always built in the calling thread.
+	 */
+	inline Lathe& setNumThreads(unsigned int numThreads)
+	{
+		mNumThreads = numThreads;
+		return *this;
+	}
+
 	/** Sets the shape to extrude */
 	inline Lathe & setShapeToExtrude(Shape* shapeToExtrude)
 	{
@@ -158,6 +158,21 @@ protected:
 			buffer.textureCoord(mUVOrigin.x + uv.x*mUTile, mUVOrigin.y+uv.y*mVTile);
 	}
 
+	/// Sets a point of a triangle buffer, which has been made room for with TriangleBuffer::extend(), using the format defined for that MeshGenerator
+	/// @arg buffer the triangle buffer to update
+	/// @arg vertexIndex the index of the point in the buffer
+	/// @arg position the position of the point
+	/// @arg normal the normal of the point
+	/// @arg uv the uv texcoord of the point
+	inline void setPoint(TriangleBuffer& buffer, size_t vertexIndex, const Ogre::Vector3& position, const Ogre::Vector3& normal, const Ogre::Vector2& uv) const
+	{
+		buffer.setPosition(vertexIndex, position);
+		if (mEnableNormals)
+			buffer.setNormal(vertexIndex, normal);
+		if (mNumTexCoordSet>0)
+			buffer.setTextureCoord(vertexIndex, Ogre::Vector2(mUVOrigin.x + uv.x*mUTile, mUVOrigin.y+uv.y*mVTile));
+	}
+
 };
 //
 }
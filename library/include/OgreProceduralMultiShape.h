@@ -34,6 +34,31 @@ namespace OgreProcedural
 {
 	class Shape;
 
+/**
+ * Tells which points are inside a set of contours, from the number of times the contours wind around them.
+ * A contour winds positively around the points on its inside, as given by its out side.
+ */
+enum WindingRule
+{
+	/// Points around which the contours wind a non-zero number of times are inside
+	WR_NONZERO,
+	/// Points around which the contours wind an odd number of times are inside
+	WR_EVENODD,
+	/// Points around which the contours wind a positive number of times are inside
+	WR_POSITIVE
+};
+
+/// Tells how the offset contours are joined around the corners of the offset shapes
+enum JoinType
+{
+	/// Edges are extended until they meet, unless they would go further than the miter limit
+	JT_MITER,
+	/// Corners are rounded
+	JT_ROUND,
+	/// Corners are cut at the offset distance
+	JT_SQUARE
+};
+
 /** Holds a bunch of shapes.
  * There are a number of assumptions that are made and are not checked
  * against : the shapes must not cross each other
@@ -44,6 +69,72 @@ class _ProceduralExport MultiShape
 	std::vector<Shape> mShapes;
 
 	public:
+	/**
+	 * Goes through the points of all the shapes of a multishape, in order, without copying them
+	 */
+	class PointIterator
+	{
+		const std::vector<Shape>* mShapes;
+		size_t mShapeIndex;
+		size_t mPointIndex;
+
+		void _skipEmptyShapes();
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Ogre::Vector2 value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Ogre::Vector2* pointer;
+		typedef const Ogre::Vector2& reference;
+
+		PointIterator(const std::vector<Shape>* shapes, size_t shapeIndex) : mShapes(shapes), mShapeIndex(shapeIndex), mPointIndex(0)
+		{
+			_skipEmptyShapes();
+		}
+
+		reference operator*() const;
+
+		pointer operator->() const
+		{
+			return &**this;
+		}
+
+		PointIterator& operator++()
+		{
+			mPointIndex++;
+			_skipEmptyShapes();
+			return *this;
+		}
+
+		PointIterator operator++(int)
+		{
+			PointIterator previous = *this;
+			++*this;
+			return previous;
+		}
+
+		bool operator==(const PointIterator& other) const
+		{
+			return mShapeIndex==other.mShapeIndex && mPointIndex==other.mPointIndex;
+		}
+
+		bool operator!=(const PointIterator& other) const
+		{
+			return !(*this==other);
+		}
+
+		/// Gets the index of the shape the current point belongs to
+		size_t getShapeIndex() const
+		{
+			return mShapeIndex;
+		}
+
+		/// Gets the index of the current point in its shape
+		size_t getPointIndex() const
+		{
+			return mPointIndex;
+		}
+	};
+
 	/// Default constructor
 	MultiShape()
 	{}
@@ -76,6 +167,21 @@ class _ProceduralExport MultiShape
 	/// Builds an aggregated list of all points contained in all shapes
 	std::vector<Ogre::Vector2> getPoints() const;
 	//-----------------------------------------------------------------------
+	/// Gets the first of all points contained in all shapes, to go through them without building a list
+	PointIterator pointsBegin() const
+	{
+		return PointIterator(&mShapes, 0);
+	}
+	//-----------------------------------------------------------------------
+	/// Gets the end of all points contained in all shapes
+	PointIterator pointsEnd() const
+	{
+		return PointIterator(&mShapes, mShapes.size());
+	}
+	//-----------------------------------------------------------------------
+	/// Returns the number of points in all shapes
+	size_t getPointCount() const;
+	//-----------------------------------------------------------------------
 	/// Returns the number of shapes in that MultiShape
 	int getShapeCount() const
 	{
@@ -91,6 +197,18 @@ class _ProceduralExport MultiShape
 		}
 	}
 	//-----------------------------------------------------------------------
+	/**
+	 * Applies the given translation to all the shapes.
+	 * As with Shape::translate, the points are only moved when they're needed.
+	 */
+	MultiShape& translate(const Ogre::Vector2& translation);
+	//-----------------------------------------------------------------------
+	/// Applies the given rotation to all the shapes, around the origin
+	MultiShape& rotate(Ogre::Radian angle);
+	//-----------------------------------------------------------------------
+	/// Applies the given scale to all the shapes
+	MultiShape& scale(Ogre::Real scaleX, Ogre::Real scaleY);
+	//-----------------------------------------------------------------------
 	/// Outputs the Multi Shape to a Mesh, mostly for visualisation or debugging purposes
 	Ogre::MeshPtr realizeMesh(const std::string& name="");
 	//-----------------------------------------------------------------------
@@ -98,6 +216,7 @@ class _ProceduralExport MultiShape
 	/// It assumes that all of the shapes in that multishape are closed,
 	/// and that they don't contradict each other,
 	/// ie a point cannot be outside and inside at the same time
+	/// To test many points, PointInsideIndex is much faster.
 	bool isPointInside(const Ogre::Vector2& point) const;
 	//-----------------------------------------------------------------------
 	/**
@@ -105,7 +224,90 @@ class _ProceduralExport MultiShape
 	 * MultiShape is considered to be closed if and only if all shapes are closed
 	 */
 	bool isClosed() const;
+	//-----------------------------------------------------------------------
+	/**
+	 * Computes the union of this multishape and another one, in a single pass over all their contours.
+	 * Contours may overlap each other, within a multishape or across both.
+	 * To merge the shapes of a single multishape, pass an empty multishape as the other one.
+	 * Single shapes can go through it as one-shape multishapes.
+	 * @arg other The other multishape
+	 * @arg windingRule How overlapping contours of each multishape are combined (default=WR_NONZERO)
+	 * @arg gridResolution If positive, all points are snapped to a grid of that step, so that nearly coincident edges
+	 * get merged. A grid too fine for the shapes to fit within 2^25 grid steps of the origin is coarsened until they do.
+	 * (default=0, the grid is as fine as the float precision of the shapes)
+	 * @return The outer contours, counter-clockwise, and the holes, clockwise, all having their out side on the right.
+	 * In the unlikely case where the crossings rounded to the grid keep making edges meet, the operation starts over
+	 * on a grid twice as coarse, a few times.
+	 * @exception std::runtime_error If the edges still keep meeting on the coarsest of these grids
+	 */
+	MultiShape booleanUnion(const MultiShape& other, WindingRule windingRule = WR_NONZERO, Ogre::Real gridResolution = 0.) const;
+	//-----------------------------------------------------------------------
+	/**
+	 * Same as booleanUnion, with a bound on the passes of the sweep which splits the edges where they meet,
+	 * to test what happens when it is reached
+	 * @arg maxSweepPasses The bound on the passes on each grid, 0 for as many as there are edges
+	 * @see booleanUnion
+	 */
+	MultiShape _booleanUnion(const MultiShape& other, WindingRule windingRule, Ogre::Real gridResolution, unsigned int maxSweepPasses) const;
+	//-----------------------------------------------------------------------
+	/**
+	 * Computes the intersection of this multishape and another one
+	 * @see booleanUnion
+	 */
+	MultiShape booleanIntersect(const MultiShape& other, WindingRule windingRule = WR_NONZERO, Ogre::Real gridResolution = 0.) const;
+	//-----------------------------------------------------------------------
+	/**
+	 * Computes the difference between this multishape and another one
+	 * @see booleanUnion
+	 */
+	MultiShape booleanDifference(const MultiShape& other, WindingRule windingRule = WR_NONZERO, Ogre::Real gridResolution = 0.) const;
+	//-----------------------------------------------------------------------
+	/**
+	 * Computes the exclusive or of this multishape and another one,
+	 * ie the parts that are covered by one of them but not by both
+	 * @see booleanUnion
+	 */
+	MultiShape booleanXor(const MultiShape& other, WindingRule windingRule = WR_NONZERO, Ogre::Real gridResolution = 0.) const;
+	//-----------------------------------------------------------------------
+	/**
+	 * Offsets all the shapes of this multishape.
+	 * Closed shapes are grown by the given amount on their out side, or shrunk if it's negative.
+	 * Open shapes are turned into strokes, as with thicken().
+	 * The offset contours are merged, and their self-intersections removed.
+	 * @arg amount The offset distance
+	 * @arg joinType How corners are joined (default=JT_MITER)
+	 * @arg miterLimit With JT_MITER, the maximum distance of a corner, relative to the offset distance,
+	 * before it gets cut (default=2)
+	 * @arg numSegCircle With JT_ROUND, the number of segments a full circle would be made of (default=16)
+	 * @arg gridResolution If positive, the merge of the offset contours runs on that grid (default=0)
+	 * @see booleanUnion
+	 */
+	MultiShape offset(Ogre::Real amount, JoinType joinType = JT_MITER, Ogre::Real miterLimit = 2., unsigned int numSegCircle = 16, Ogre::Real gridResolution = 0.) const;
+	//-----------------------------------------------------------------------
+	/**
+	 * Applies a "thickness" to all the shapes of this multishape, ie a bit like the extruder, but in 2D.
+	 * Each shape becomes a band, which covers both sides of the shape up to the given distance.
+	 * Open shapes are capped according to the join type : flat with JT_MITER, round with JT_ROUND,
+	 * and extended by the thickness with JT_SQUARE.
+	 * @see offset
+	 */
+	MultiShape thicken(Ogre::Real amount, JoinType joinType = JT_MITER, Ogre::Real miterLimit = 2., unsigned int numSegCircle = 16, Ogre::Real gridResolution = 0.) const;
+
+	/**
+	 * Simplifies each shape of this multishape.
+	 * Points whose removal would make a shape cross itself or another shape are kept, so shapes which didn't cross
+	 * still don't, and can still be triangulated or go through boolean operations.
+	 * @see Shape::simplify
+	 */
+	MultiShape& simplify(Ogre::Real tolerance);
+
+	private:
+
+	enum BooleanOperationType { BOT_UNION, BOT_INTERSECTION, BOT_DIFFERENCE, BOT_XOR};
+
+	MultiShape _booleanOperation(const MultiShape& other, BooleanOperationType opType, WindingRule windingRule, Ogre::Real gridResolution, size_t maxSweepPasses=0) const;
 
+	MultiShape _offset(Ogre::Real amount, bool thicken, JoinType joinType, Ogre::Real miterLimit, unsigned int numSegCircle, Ogre::Real gridResolution) const;
 };
 }
 #endif
@@ -43,7 +43,12 @@ namespace OgreProcedural
 class _ProceduralExport Path
 {
 	std::vector<Ogre::Vector3> mPoints;
+	/// Lineic position of each point, ie the length of the path from its first point to that one
+	std::vector<Ogre::Real> mLengths;
 	bool mClosed;
+
+	/// Finds the segment containing a lineic position, which must be between 0 and the total length
+	unsigned int _findSegment(Ogre::Real coord) const;
 public:
 	/// Default constructor
 	Path() : mClosed(false)	{}
@@ -51,21 +56,36 @@ public:
 	/** Adds a point to the path, as a Vector3 */
 	Path& addPoint(const Ogre::Vector3& pt)
 	{
+		mLengths.push_back(mPoints.empty()?0.f:mLengths.back()+(pt-mPoints.back()).length());
 		mPoints.push_back(pt);
 		return *this;
 	}
 
+	/**
+	 * Moves a point of the path.
+	 * The lineic positions of the following points are updated, as if the points had been added again.
+	 */
+	Path& setPoint(unsigned int i, const Ogre::Vector3& pt);
+
+	/** Reserves memory for a number of points, when it's known before adding them */
+	Path& reserve(size_t numPoints)
+	{
+		mPoints.reserve(numPoints);
+		mLengths.reserve(numPoints);
+		return *this;
+	}
+
 	/** Adds a point to the path, using its 3 coordinates */
 	Path& addPoint(Ogre::Real x, Ogre::Real y, Ogre::Real z)
 	{
-		mPoints.push_back(Ogre::Vector3(x,y,z));
-		return *this;
+		return addPoint(Ogre::Vector3(x,y,z));
 	}
 
 	/** Clears the content of the Path */
 	Path& reset()
 	{
 		mPoints.clear();
+		mLengths.clear();
 		return *this;
 	}
 
@@ -78,13 +98,19 @@ public:
 	}
 
 	/** Tells if the path is closed or not */
-	bool isClosed()
+	bool isClosed() const
 	{
 		return mClosed;
 	}
 
-	/** Gets the list of points as a vector of Vector3 */
-	std::vector<Ogre::Vector3> getPoints()
+	/** Gets a copy of the list of points as a vector of Vector3 */
+	std::vector<Ogre::Vector3> getPoints() const
+	{
+		return mPoints;
+	}
+
+	/** Gets the list of points as a vector of Vector3, without copying it */
+	const std::vector<Ogre::Vector3>& getPointsReference() const
 	{
 		return mPoints;
 	}
@@ -104,7 +130,7 @@ public:
 	/** Gets the number of segments in the path
 	 * Takes into accound whether path is closed or not
 	 */
-	int getSegCount()
+	int getSegCount() const
 	{
 		return (mPoints.size()-1) + (mClosed?1:0);
 	}
@@ -112,7 +138,7 @@ public:
 	/**
 	 * Returns local direction after the current point
 	 */
-	Ogre::Vector3 getDirectionAfter(unsigned int i)
+	Ogre::Vector3 getDirectionAfter(unsigned int i) const
 	{
 		// If the path isn't closed, we get a different calculation at the end, because
 		// the tangent shall not be null
@@ -125,7 +151,7 @@ public:
 	/**
 	 * Returns local direction after the current point
 	 */
-	Ogre::Vector3 getDirectionBefore(int i)
+	Ogre::Vector3 getDirectionBefore(int i) const
 	{
 		// If the path isn't closed, we get a different calculation at the end, because
 		// the tangent shall not be null
@@ -139,13 +165,32 @@ public:
 	 * Returns the local direction at the current point.
 	 * @param i index of the point
 	 */
-	Ogre::Vector3 getAvgDirection(int i)
+	Ogre::Vector3 getAvgDirection(int i) const
 	{
 	    return (getDirectionAfter(i) + getDirectionBefore(i)).normalisedCopy();
 	}
 
-	/// Returns the total lineic length of that shape
-	Ogre::Real getTotalLength() const;
+	/// Returns the total lineic length of that path
+	Ogre::Real getTotalLength() const
+	{
+		if (mPoints.empty())
+			return 0.;
+		if (mClosed)
+			return mLengths.back()+(mPoints.front()-mPoints.back()).length();
+		return mLengths.back();
+	}
+
+	/**
+	 * Gets the lineic position of a point, ie the length of the path from its first point to that one.
+	 * Lineic positions are kept up to date as points are added, so this doesn't need any computation.
+	 * @arg i index of the point. On a closed path, i can be the number of points, to get the total length.
+	 */
+	inline Ogre::Real getLengthAtPoint(unsigned int i) const
+	{
+		if (i==mPoints.size())
+			return getTotalLength();
+		return mLengths[i];
+	}
 
 	/// Gets a position on the shape with index of the point and a percentage of position on the segment
 	/// @arg i index of the segment
@@ -159,9 +204,22 @@ public:
 		return A + coord*(B-A);
 	}
 
-	/// Gets a position on the shape from lineic coordinate
-	/// @arg coord lineic coordinate
-	 Ogre::Vector3 getPosition(Ogre::Real coord) const;
+	/**
+	 * Gets a position on the path from lineic coordinate.
+	 * The segment is found with a binary search.
+	 * On an open path, coordinates are clamped between 0 and the total length,
+	 * and on a closed path, they go round the path.
+	 * @arg coord lineic coordinate
+	 */
+	Ogre::Vector3 getPosition(Ogre::Real coord) const;
+
+	/**
+	 * Gets a position on the path from lineic coordinate, starting the search of the segment from a cursor.
+	 * When positions are sampled in order, each call only moves the cursor forward by a few segments.
+	 * @arg coord lineic coordinate
+	 * @arg cursor index of the segment where the search starts (0 the first time), updated to the segment found
+	 */
+	Ogre::Vector3 getPosition(Ogre::Real coord, unsigned int& cursor) const;
 
 	/**
 	 * Outputs a mesh representing the path.
@@ -175,7 +233,29 @@ public:
 	 */
 	//void fixSharpAngles(Ogre::Real radius);
 
-	Path mergeKeysWithTrack(const Track& track);
+	/**
+	 * Inserts a point wherever the track has a key between two points of the path,
+	 * so that the key is applied exactly.
+	 * Runs in a single pass over the points and the keys.
+	 */
+	Path mergeKeysWithTrack(const Track& track) const;
+
+	/**
+	 * Removes the points which aren't needed to keep the path within a tolerance of its current points.
+	 * The path stays closed if it was, and keeps its ends, or its first point if it's closed.
+	 * Runs in O(n log n).
+	 * The points the tracks rely on are kept : the points closest to the keys of lineic tracks,
+	 * and all the points up to the last key of tracks addressed by point, so that their indices don't change.
+	 * Lineic positions change a little, as the path gets shorter.
+	 * @arg tolerance the maximum distance between the current points and the simplified path
+	 * @arg track a track whose keys must be kept, or 0
+	 * @arg otherTrack another track whose keys must be kept, or 0
+	 */
+	Path& simplify(Ogre::Real tolerance, const Track* track=0, const Track* otherTrack=0);
+
+private:
+	/// Locks the points a track relies on
+	void _lockTrackKeys(const Track& track, std::vector<bool>& locked) const;
 
 };
 
@@ -26,6 +26,7 @@ THE SOFTWARE.
 -----------------------------------------------------------------------------
 */
 #include "OgreProceduralPath.h"
+#include "OgreProceduralSplines.h"
 
 namespace OgreProcedural
 {
@@ -39,8 +40,58 @@ protected:
 	unsigned int mNumSeg;
 	/// Tells if the spline is closed or not
 	bool mClosed;
+	/// The maximum distance between the spline and the segments of the path, 0 if not used
+	Ogre::Real mMaxDeviation;
+	/// The maximum angle between the tangents at both ends of a segment, 0 if not used
+	Ogre::Radian mMaxAngle;
+	/// The length of the segments when the spline is sampled at constant speed, 0 if not used
+	Ogre::Real mSegmentLength;
+
+	/// Builds the path from the curves between successive control points
+	Path _realizePath(const std::vector<HermiteCurve<Ogre::Vector3> >& curves) const
+	{
+		Path path;
+		if (curves.empty())
+			return path;
+		if (mSegmentLength>0.)
+		{
+			// Evenly spaced points, the segment length being adjusted to fit a whole number of times
+			ArcLengthTable<Ogre::Vector3> table(curves);
+			unsigned int numSeg = std::max(1u, (unsigned int)Ogre::Math::Ceil(table.getTotalLength()/mSegmentLength));
+			path.reserve(numSeg+1);
+			size_t cursor = 0;
+			for (unsigned int i=0;i<numSeg;i++)
+				path.addPoint(table.getPoint(table.getTotalLength()*i/numSeg, cursor));
+		}
+		else
+		{
+			bool isAdaptive = mMaxDeviation>0. || mMaxAngle.valueRadians()>0.;
+			size_t numPoints = 1;
+			for (size_t i=0;i<curves.size();i++)
+				numPoints += isAdaptive?curves[i].estimateNumSeg(mMaxDeviation, mMaxAngle):mNumSeg;
+			path.reserve(numPoints);
+			if (isAdaptive)
+			{
+				for (size_t i=0;i<curves.size();i++)
+					curves[i].tessellate(path, mMaxDeviation, mMaxAngle);
+			}
+			else
+			{
+				// All the curves are evaluated at once, one coordinate at a time
+				std::vector<Ogre::Real> coordinates[3];
+				HermiteBasis(mNumSeg).evaluate(curves, 3, coordinates);
+				for (size_t i=0;i<coordinates[0].size();i++)
+					path.addPoint(coordinates[0][i], coordinates[1][i], coordinates[2][i]);
+			}
+		}
+		if (mClosed)
+			path.close();
+		else
+			path.addPoint(curves.back().p1);
+		return path;
+	}
 public:
-	BaseSpline3() : mNumSeg(4), mClosed(false) {}
+	BaseSpline3() : mNumSeg(4), mClosed(false), mMaxDeviation(0.), mMaxAngle(0.), mSegmentLength(0.) {}
 
 	/// Sets the number of segments between 2 control points
 	T& setNumSeg(int numSeg)
@@ -56,6 +107,40 @@ public:
 		mClosed = true;
 		return (T&)*this;
 	}
+
+	/**
+	 * Sets the maximum distance between the spline and the segments of the path (default=0, not used).
+	 * When a maximum distance or a maximum angle is set, the number of segments between 2 control points
+	 * isn't used any more : segments are only added where the spline bends.
+	 */
+	T& setMaxDeviation(Ogre::Real maxDeviation)
+	{
+		mMaxDeviation = maxDeviation;
+		return (T&)*this;
+	}
+
+	/**
+	 * Sets the maximum angle between the tangents of the spline at both ends of a segment of the path (default=0, not used).
+	 * @see setMaxDeviation
+	 */
+	T& setMaxAngle(Ogre::Radian maxAngle)
+	{
+		mMaxAngle = maxAngle;
+		return (T&)*this;
+	}
+
+	/**
+	 * Sets the length of the segments of the path (default=0, not used).
+	 * When set, the points are evenly spaced along the spline, as if it was travelled at constant speed,
+	 * which keeps texture coordinates and lineic tracks stable whatever the spacing of the control points.
+	 * The length is adjusted so that the spline holds a whole number of segments.
+	 * It takes precedence over the number of segments and the adaptive settings.
+	 */
+	T& setSegmentLength(Ogre::Real segmentLength)
+	{
+		mSegmentLength = segmentLength;
+		return (T&)*this;
+	}
 };
 //-----------------------------------------------------------------------
 /**
@@ -73,7 +158,7 @@ class _ProceduralExport CatmullRomSpline3 : public BaseSpline3<CatmullRomSpline3
 	/// Copy constructor from an Ogre simplespline
 	CatmullRomSpline3(const Ogre::SimpleSpline& input)
 	{
-		mPoints.resize(input.getNumPoints());
+		mPoints.reserve(input.getNumPoints());
 		for (unsigned short i=0; i<input.getNumPoints(); i++)
 			mPoints.push_back(input.getPoint(i));
 	}
@@ -159,9 +244,10 @@ public:
 	{
 		assert(mNumSeg > 0);
 		Path p;
+		p.reserve(mNumSeg+1);
 		for (unsigned int i = 0; i <= mNumSeg; ++i)
 		{
-			p.addPoint(i/(Ogre::Real)mNumSeg * mPoint1 + i/(Ogre::Real)mNumSeg * mPoint2);
+			p.addPoint((1-i/(Ogre::Real)mNumSeg) * mPoint1 + i/(Ogre::Real)mNumSeg * mPoint2);
 		}
 		return p;
 	}
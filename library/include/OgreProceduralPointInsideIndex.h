@@ -0,0 +1,133 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef PROCEDURAL_POINT_INSIDE_INDEX_INCLUDED
+#define PROCEDURAL_POINT_INSIDE_INDEX_INCLUDED
+
+#include "OgreProceduralPlatform.h"
+#include "OgreProceduralShape.h"
+#include "OgreProceduralMultiShape.h"
+
+namespace OgreProcedural
+{
+/**
+ * Speeds up point inside tests against a multishape.
+ * The segments of the multishape are spread over a uniform grid, built once,
+ * so that each test only looks at the segments close to the tested point.
+ * Tests give the same results as MultiShape::isPointInside().
+ * The index keeps a copy of what it needs, so the multishape can change or be destroyed afterwards,
+ * but the index then has to be built again to take the changes into account.
+ */
+class _ProceduralExport PointInsideIndex
+{
+	struct Segment
+	{
+		Ogre::Vector2 a, b;
+		/// Normals used to tell the side of a point, respectively at a, at b, and along the segment
+		Ogre::Vector2 normalA, normalB, normal;
+	};
+
+	/// Segments, in the order of the shapes of the multishape
+	std::vector<Segment> mSegments;
+	/// Segments of each cell, cell c going from mCellSegments[mCellStarts[c]] to mCellSegments[mCellStarts[c+1]]
+	std::vector<size_t> mCellStarts;
+	std::vector<int> mCellSegments;
+	/// Bounding box of the segments
+	Ogre::Vector2 mMin, mMax;
+	/// Number of cells per unit of length, along each axis
+	Ogre::Vector2 mCellScale;
+	int mNumColumns;
+	int mNumRows;
+	Ogre::Real mCellsPerSegment;
+	/// Result for the points which don't see any segment on their horizontal line
+	bool mOutsideIsInside;
+
+	inline int _getColumn(Ogre::Real x) const
+	{
+		return std::min(mNumColumns-1, std::max(0, (int)((x-mMin.x)*mCellScale.x)));
+	}
+
+	inline int _getRow(Ogre::Real y) const
+	{
+		return std::min(mNumRows-1, std::max(0, (int)((y-mMin.y)*mCellScale.y)));
+	}
+
+public:
+	/// Default ctor, for an empty index
+	PointInsideIndex() : mNumColumns(0), mNumRows(0), mCellsPerSegment(1.), mOutsideIsInside(false) {}
+
+	/// Builds the index of a multishape
+	PointInsideIndex(const MultiShape& multiShape) : mNumColumns(0), mNumRows(0), mCellsPerSegment(1.), mOutsideIsInside(false)
+	{
+		build(multiShape);
+	}
+
+	/// Builds the index of a shape
+	PointInsideIndex(const Shape& shape) : mNumColumns(0), mNumRows(0), mCellsPerSegment(1.), mOutsideIsInside(false)
+	{
+		build(MultiShape(shape));
+	}
+
+	/**
+	 * Sets the number of grid cells per segment, used the next time the index is built (default=1)
+	 * More cells make the tests faster, at the expense of memory.
+	 */
+	PointInsideIndex& setCellsPerSegment(Ogre::Real cellsPerSegment)
+	{
+		mCellsPerSegment = cellsPerSegment;
+		return *this;
+	}
+
+	/// (Re)builds the index of a multishape
+	PointInsideIndex& build(const MultiShape& multiShape);
+
+	/// Tells whether a point is inside the indexed multishape
+	bool isPointInside(const Ogre::Vector2& point) const;
+
+	/**
+	 * Tells whether each point of an array is inside the indexed multishape
+	 * @arg points The tested points
+	 * @arg numPoints The number of tested points
+	 * @arg results Receives a result per point
+	 * @arg numThreads The number of threads sharing the tests (default=1). 0 means one thread per hardware core.
+	 */
+	void isPointInside(const Ogre::Vector2* points, size_t numPoints, bool* results, unsigned int numThreads=1) const;
+
+	/// Gets the number of segments in the index
+	size_t getSegmentCount() const
+	{
+		return mSegments.size();
+	}
+
+	/// Gets the number of cells of the grid
+	size_t getCellCount() const
+	{
+		return (size_t)mNumColumns*mNumRows;
+	}
+};
+}
+#endif
@@ -0,0 +1,73 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef PROCEDURAL_PROFILE_TABLE_INCLUDED
+#define PROCEDURAL_PROFILE_TABLE_INCLUDED
+
+#include "OgreProceduralPlatform.h"
+#include "OgreProceduralShape.h"
+
+namespace OgreProcedural
+{
+/**
+ * The points of a shape, with their normals and v texture coordinates, read once and stored coordinate by coordinate,
+ * so that the shape can be placed ring after ring, along a path or around an axis, by a loop the compiler can vectorize.
+ */
+class _ProceduralExport ProfileTable
+{
+	std::vector<Ogre::Real> mX, mY, mNormalX, mNormalY, mV;
+
+public:
+	/**
+	 * Reads the shape
+	 * @arg shape The shape
+	 * @arg flipNormals If false, normals point towards the out side of the shape, otherwise towards the other side
+	 */
+	ProfileTable(const Shape& shape, bool flipNormals=false);
+
+	/// Gets the number of points, ie the number of vertices of a ring
+	size_t getSize() const
+	{
+		return mX.size();
+	}
+
+	/// Gets the v texture coordinate of a point, from 0 at the first point to 1 at the last one
+	Ogre::Real getV(size_t j) const
+	{
+		return mV[j];
+	}
+
+	/**
+	 * Places the shape as a ring : point (x, y) goes to position+orientation*(scale*(x, y, 0)), and its normal is turned by the orientation.
+	 * @arg positions Receives the coordinates of the positions, ie positions[k][j] is coordinate k of point j
+	 * @arg normals Receives the coordinates of the normals
+	 */
+	void placeRing(const Ogre::Vector3& position, const Ogre::Quaternion& orientation, Ogre::Real scale,
+		Ogre::Real* const positions[3], Ogre::Real* const normals[3]) const;
+};
+}
+#endif
@@ -28,6 +28,10 @@ THE SOFTWARE.
 #ifndef PROCEDURAL_SHAPE_INCLUDED
 #define PROCEDURAL_SHAPE_INCLUDED
 
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <type_traits>
 #include "OgreVector2.h"
 #include "OgreProceduralPlatform.h"
 #include "OgreProceduralUtils.h"
@@ -39,45 +43,250 @@ THE SOFTWARE.
 namespace OgreProcedural
 {
 enum Side {SIDE_LEFT, SIDE_RIGHT};
+class SimplificationIndex;
 
 /** Describes a succession of interconnected 2D points.
- * It can be closed or not, and there's always an outside and an inside
+ * It can be closed or not, and there's always an outside and an inside.
+ * Transforms are only applied to the points when they are next read. A single thread applies them,
+ * under a lock, so that const reads, copies included, stay safe from several threads.
  */
 class _ProceduralExport Shape
 {
-	std::vector<Ogre::Vector2> mPoints;
+	friend class MultiShape;
+
+	// Points and lengths are mutable, because the pending transform is applied to them when they're read
+	mutable std::vector<Ogre::Vector2> mPoints;
+	/// Lineic position of each point, ie the length of the shape from its first point to that one
+	mutable std::vector<Ogre::Real> mLengths;
 	bool mClosed;
 	Side mOutSide;
 
+	/// Transform waiting to be applied to the points : a point p becomes mTransformX*p.x + mTransformY*p.y + mTransformOffset
+	mutable Ogre::Vector2 mTransformX, mTransformY, mTransformOffset;
+	mutable std::atomic<bool> mHasTransform;
+	/// False when the pending transform changes the lengths of the segments
+	mutable bool mTransformKeepsLengths;
+	/// Held while the pending transform is applied
+	mutable std::mutex mTransformMutex;
+
+	/// Computes the lineic positions of all points again
+	void _updateLengths() const;
+
+	/// Applies the pending transform to the points, in a single pass, unless another thread just did
+	void _flushTransform() const;
+
+	/// Applies the pending transform to the points, if there is one
+	inline void _applyTransform() const
+	{
+		if (mHasTransform)
+			_flushTransform();
+	}
+
+	/// Starts a pending transform, if there's none yet
+	inline void _beginTransform()
+	{
+		if (!mHasTransform)
+		{
+			mTransformX = Ogre::Vector2::UNIT_X;
+			mTransformY = Ogre::Vector2::UNIT_Y;
+			mTransformOffset = Ogre::Vector2::ZERO;
+			mTransformKeepsLengths = true;
+			mHasTransform = true;
+		}
+	}
+
+	/// Finds the segment containing a lineic position, which must be between 0 and the total length
+	unsigned int _findSegment(Ogre::Real coord) const;
+
+	/// Simplifies the shape, as polyline number polyline of the index, which keeps it from crossing any other polyline of the index
+	void _simplify(Ogre::Real tolerance, SimplificationIndex& index, int polyline);
+
+	struct IntersectionInShape
+	{
+		int index[2];
+		bool onVertex[2];
+		Ogre::Vector2 position;
+		IntersectionInShape(int i, int j, Ogre::Vector2 intersect) : position(intersect)
+		{
+			index[0] = i;
+			index[1] = j;
+			onVertex[0] = false;
+			onVertex[1] = false;
+		}
+	};
+
+	/// Bounding box of a segment, used to sweep over the segments of 2 shapes
+	struct SweepSegment
+	{
+		Ogre::Real minX, maxX, minY, maxY;
+		int shape;
+		int index;
+		bool operator<(const SweepSegment& other) const
+		{
+			return minX<other.minX;
+		}
+	};
+
 public:
+	/**
+	 * Scratch memory of the boolean operations.
+	 * Passing the same workspace to successive boolean operations lets them
+	 * reuse its buffers instead of allocating new ones each time.
+	 * The result is not held by the workspace : the returned multishape and its shapes,
+	 * as well as the copies of the input shapes some operations return, are allocated by each operation.
+	 */
+	class _ProceduralExport BooleanWorkspace
+	{
+		friend class Shape;
+
+		std::vector<IntersectionInShape> mIntersections;
+		std::vector<Ogre::Vector2> mOutputPoints;
+		std::vector<SweepSegment> mSweepSegments;
+		std::vector<int> mActiveSegments[2];
+		std::vector<std::pair<int, int> > mCandidatePairs;
+
+		size_t mCallCount;
+		size_t mGrowthCount;
+		size_t mMemoryUsage;
+
+		void _endCall()
+		{
+			mCallCount++;
+			size_t memoryUsage = mIntersections.capacity()*sizeof(IntersectionInShape) + mOutputPoints.capacity()*sizeof(Ogre::Vector2)
+				+ mSweepSegments.capacity()*sizeof(SweepSegment) + (mActiveSegments[0].capacity()+mActiveSegments[1].capacity())*sizeof(int)
+				+ mCandidatePairs.capacity()*sizeof(std::pair<int, int>);
+			if (memoryUsage>mMemoryUsage)
+				mGrowthCount++;
+			mMemoryUsage = memoryUsage;
+		}
+	public:
+		/// Default ctor
+		BooleanWorkspace() : mCallCount(0), mGrowthCount(0), mMemoryUsage(0) {}
+
+		/// Gets the number of boolean operations which used this workspace
+		size_t getCallCount() const
+		{
+			return mCallCount;
+		}
+
+		/// Gets the number of boolean operations which had to grow the buffers of this workspace, whatever the number of buffers they grew
+		size_t getGrowthCount() const
+		{
+			return mGrowthCount;
+		}
+
+		/// Gets the memory held by the buffers of this workspace, in bytes
+		size_t getMemoryUsage() const
+		{
+			return mMemoryUsage;
+		}
+
+		/// Resets the counters
+		void resetCounters()
+		{
+			mCallCount = 0;
+			mGrowthCount = 0;
+		}
+	};
+
 	/// Default constructor
-	Shape() : mClosed(false), mOutSide(SIDE_RIGHT) {}
+	Shape() : mClosed(false), mOutSide(SIDE_RIGHT), mHasTransform(false), mTransformKeepsLengths(true) {}
+
+	/// Copy constructor. The pending transform of the other shape is applied first.
+	Shape(const Shape& other) : mClosed(other.mClosed), mOutSide(other.mOutSide), mHasTransform(false), mTransformKeepsLengths(true)
+	{
+		other._applyTransform();
+		mPoints = other.mPoints;
+		mLengths = other.mLengths;
+	}
+
+	/// Move constructor. The pending transform goes along with the points.
+	/// It doesn't throw, so that vectors of shapes move them when they grow, rather than copying them.
+	Shape(Shape&& other) noexcept : mPoints(std::move(other.mPoints)), mLengths(std::move(other.mLengths)), mClosed(other.mClosed), mOutSide(other.mOutSide),
+		mTransformX(other.mTransformX), mTransformY(other.mTransformY), mTransformOffset(other.mTransformOffset),
+		mHasTransform(other.mHasTransform.load()), mTransformKeepsLengths(other.mTransformKeepsLengths)
+	{
+		other.mHasTransform = false;
+	}
+
+	/// Assignment operator. The pending transform of the other shape is applied first.
+	Shape& operator=(const Shape& other)
+	{
+		if (this != &other)
+		{
+			other._applyTransform();
+			mPoints = other.mPoints;
+			mLengths = other.mLengths;
+			mClosed = other.mClosed;
+			mOutSide = other.mOutSide;
+			mHasTransform = false;
+		}
+		return *this;
+	}
+
+	/// Move assignment operator. The pending transform goes along with the points.
+	Shape& operator=(Shape&& other) noexcept
+	{
+		if (this != &other)
+		{
+			mPoints = std::move(other.mPoints);
+			mLengths = std::move(other.mLengths);
+			mClosed = other.mClosed;
+			mOutSide = other.mOutSide;
+			mTransformX = other.mTransformX;
+			mTransformY = other.mTransformY;
+			mTransformOffset = other.mTransformOffset;
+			mTransformKeepsLengths = other.mTransformKeepsLengths;
+			mHasTransform = other.mHasTransform.load();
+			other.mHasTransform = false;
+		}
+		return *this;
+	}
 
 	//---------------------------------------------------------------------------
 	/// Adds a point to the shape
 	inline Shape& addPoint(const Ogre::Vector2& pt)
 	{
+		_applyTransform();
+		mLengths.push_back(mPoints.empty()?0.f:mLengths.back()+(pt-mPoints.back()).length());
 		mPoints.push_back(pt);
 		return *this;
 	}
 	//---------------------------------------------------------------------------
+	/// Reserves memory for a number of points, when it's known before adding them
+	inline Shape& reserve(size_t numPoints)
+	{
+		mPoints.reserve(numPoints);
+		mLengths.reserve(numPoints);
+		return *this;
+	}
+	//---------------------------------------------------------------------------
 	/// Adds a point to the shape
 	inline Shape& addPoint(Ogre::Real x, Ogre::Real y)
 	{
-		mPoints.push_back(Ogre::Vector2(x, y));
-		return *this;
+		return addPoint(Ogre::Vector2(x, y));
 	}
 	//---------------------------------------------------------------------------
 	/// Clears the content of the shape
 	inline Shape& reset()
 	{
 		mPoints.clear();
+		mHasTransform = false;
+		mLengths.clear();
 		return *this;
 	}
 	//---------------------------------------------------------------------------
-	/// Gets raw vector data of this shape
+	/// Gets a copy of raw vector data of this shape
 	inline std::vector<Ogre::Vector2> getPoints() const
 	{
+		_applyTransform();
+		return mPoints;
+	}
+	//---------------------------------------------------------------------------
+	/// Gets raw vector data of this shape, without copying it
+	inline const std::vector<Ogre::Vector2>& getPointsReference() const
+	{
+		_applyTransform();
 		return mPoints;
 	}
 
@@ -86,6 +295,7 @@ public:
 	 */
 	inline const Ogre::Vector2& getPoint(int i) const
 	{
+		_applyTransform();
 		if (mClosed)
 			return mPoints[Utils::modulo(i,mPoints.size())];
 		return mPoints[Utils::cap(i,0,mPoints.size()-1)];
@@ -125,6 +335,11 @@ public:
 		mOutSide = (mOutSide == SIDE_LEFT)? SIDE_RIGHT: SIDE_LEFT;
 		return *this;
 	}
+	/// Gets the number of points in that shape
+	inline size_t getPointCount() const
+	{
+		return mPoints.size();
+	}
 	/// Gets the number of segments in that shape
 	inline size_t getSegCount() const
 	{
@@ -143,6 +358,7 @@ public:
 	{
 		// If the path isn't closed, we get a different calculation at the end, because
 		// the tangent shall not be null
+		_applyTransform();
 		if (! mClosed && i == mPoints.size() - 1 && i > 0)
 			return (mPoints[i] - mPoints[i-1]).normalisedCopy();
 		else
@@ -156,6 +372,7 @@ public:
 	{
 		// If the path isn't closed, we get a different calculation at the end, because
 		// the tangent shall not be null
+		_applyTransform();
 		if (!mClosed && i == 1)
 			return (mPoints[1] - mPoints[0]).normalisedCopy();
 		else
@@ -207,6 +424,7 @@ public:
 	 * Tells whether a point is inside a shape or not
 	 * @arg point The point to check
 	 * @return true if the point is inside this shape, false otherwise
+	 * @see PointInsideIndex to test many points
 	 */
 	bool isPointInside(const Ogre::Vector2& point) const;
 
@@ -214,21 +432,31 @@ public:
 	 * Computes the intersection between this shape and another one.
 	 * Both shapes must be closed.
 	 * @arg other The shape against which the intersection is computed
+	 * @arg workspace Optional scratch memory to reuse between operations
 	 * @return The intersection of two shapes, as a new shape
 	 */
-	MultiShape booleanIntersect(const Shape& other) const;
+	MultiShape booleanIntersect(const Shape& other, BooleanWorkspace* workspace=0) const;
 
 	/**
 	 * Computes the union between this shape and another one.
 	 * Both shapes must be closed.
 	 */
-	MultiShape booleanUnion(const Shape& other) const;
+	MultiShape booleanUnion(const Shape& other, BooleanWorkspace* workspace=0) const;
 
 	/**
 	 * Computes the difference between this shape and another one.
 	 * Both shapes must be closed.
 	 */
-	MultiShape booleanDifference(const Shape& other) const;
+	MultiShape booleanDifference(const Shape& other, BooleanWorkspace* workspace=0) const;
+
+	/**
+	 * Finds the points where the segments of this shape cross the segments of another one, as the boolean operations do.
+	 * They are ordered by segment of this shape, then by segment of the other shape.
+	 * @arg other The other shape
+	 * @arg intersections Receives the crossing points
+	 * @arg workspace Optional scratch memory to reuse between calls
+	 */
+	void findIntersections(const Shape& other, std::vector<Ogre::Vector2>& intersections, BooleanWorkspace* workspace=0) const;
 
 	/**
 	 * On a closed shape, find if the outside is located on the right
@@ -239,13 +467,15 @@ public:
 
 	/**
 	 * Applies the given translation to all the points already defined.
-	 * Has strictly no effect on the points defined after that
+	 * Has strictly no effect on the points defined after that.
+	 * Translations, rotations and scales are gathered into a single transform,
+	 * which is only applied to the points when they're needed.
 	 * @param translation the translation vector
 	 */
 	Shape& translate(const Ogre::Vector2& translation)
 	{
-		for (std::vector<Ogre::Vector2>::iterator it = mPoints.begin(); it!=mPoints.end(); it++)
-			*it+=translation;
+		_beginTransform();
+		mTransformOffset += translation;
 		return *this;
 	}
 
@@ -261,20 +491,18 @@ public:
 
 	/**
 	 * Applies the given rotation to all the points already defined.
-	 * Has strictly no effect on the points defined after that
+	 * Has strictly no effect on the points defined after that.
+	 * Cos and sin are computed once here, the points are only rotated when they're needed.
 	 * @param angle angle of rotation
 	 */
 	Shape& rotate(Ogre::Radian angle)
 	{
 		Ogre::Real c = Ogre::Math::Cos(angle.valueRadians());
 		Ogre::Real s = Ogre::Math::Sin(angle.valueRadians());
-		for (std::vector<Ogre::Vector2>::iterator it = mPoints.begin(); it!=mPoints.end(); it++)
-		{
-			Ogre::Real x = it->x;
-			Ogre::Real y = it->y;
-			it->x = c * x - s * y;
-			it->y = s * x + c * y;
-		}
+		_beginTransform();
+		mTransformX = Ogre::Vector2(c * mTransformX.x - s * mTransformX.y, s * mTransformX.x + c * mTransformX.y);
+		mTransformY = Ogre::Vector2(c * mTransformY.x - s * mTransformY.y, s * mTransformY.x + c * mTransformY.y);
+		mTransformOffset = Ogre::Vector2(c * mTransformOffset.x - s * mTransformOffset.y, s * mTransformOffset.x + c * mTransformOffset.y);
 		return *this;
 	}
 
@@ -296,11 +524,11 @@ public:
 	 */
 	Shape& scale(Ogre::Real scaleX, Ogre::Real scaleY)
 	{
-		for (std::vector<Ogre::Vector2>::iterator it = mPoints.begin(); it!=mPoints.end(); it++)
-		{
-			it->x *= scaleX;
-			it->y *= scaleY;
-		}
+		_beginTransform();
+		mTransformX = Ogre::Vector2(scaleX * mTransformX.x, scaleY * mTransformX.y);
+		mTransformY = Ogre::Vector2(scaleX * mTransformY.x, scaleY * mTransformY.y);
+		mTransformOffset = Ogre::Vector2(scaleX * mTransformOffset.x, scaleY * mTransformOffset.y);
+		mTransformKeepsLengths = mTransformKeepsLengths && scaleX==1. && scaleY==1.;
 		return *this;
 	}
 
@@ -317,12 +545,25 @@ public:
 	/// Returns the total lineic length of that shape
 	Ogre::Real getTotalLength() const
 	{
-		Ogre::Real length = 0;
-		for (unsigned int i=0;i<mPoints.size()-1;i++)
-			length+=(mPoints[i+1]-mPoints[i]).length();
+		_applyTransform();
+		if (mPoints.empty())
+			return 0.;
 		if (mClosed)
-			length+=(mPoints.back()-*mPoints.begin()).length();
-		return length;
+			return mLengths.back()+(mPoints.front()-mPoints.back()).length();
+		return mLengths.back();
+	}
+
+	/**
+	 * Gets the lineic position of a point, ie the length of the shape from its first point to that one.
+	 * Lineic positions are kept up to date as the shape changes, so this doesn't need any computation.
+	 * @arg i index of the point. On a closed shape, i can be the number of points, to get the total length.
+	 */
+	inline Ogre::Real getLengthAtPoint(unsigned int i) const
+	{
+		_applyTransform();
+		if (i==mPoints.size())
+			return getTotalLength();
+		return mLengths[i];
 	}
 
 	/// Gets a position on the shape with index of the point and a percentage of position on the segment
@@ -337,56 +578,62 @@ public:
 		return A + coord*(B-A);
 	}
 
-	/// Gets a position on the shape from lineic coordinate
-	/// @arg coord lineic coordinate
-	inline Ogre::Vector2 getPosition(Ogre::Real coord) const
-	{
-		assert(mPoints.size()>=2 && "The shape must at least contain 2 points");
-		unsigned int i=0;
-		while(true)
-		{
-			Ogre::Real nextLen = (getPoint(i+1) - getPoint(i)).length();
-			if (coord>nextLen)
-				coord-=nextLen;
-			else
-				return getPosition(i, coord);
-			if (!mClosed && i>= mPoints.size()-2)
-				return mPoints.back();
-			i++;
-		}
-	}
+	/**
+	 * Gets a position on the shape from lineic coordinate.
+	 * The segment is found with a binary search.
+	 * On an open shape, coordinates are clamped between 0 and the total length,
+	 * and on a closed shape, they go round the shape.
+	 * @arg coord lineic coordinate
+	 */
+	Ogre::Vector2 getPosition(Ogre::Real coord) const;
+
+	/**
+	 * Gets a position on the shape from lineic coordinate, starting the search of the segment from a cursor.
+	 * When positions are sampled in order, each call only moves the cursor forward by a few segments.
+	 * @arg coord lineic coordinate
+	 * @arg cursor index of the segment where the search starts (0 the first time), updated to the segment found
+	 */
+	Ogre::Vector2 getPosition(Ogre::Real coord, unsigned int& cursor) const;
 
 	/// Computes the radius of a bounding circle centered on the origin
 	Ogre::Real findBoundingRadius() const
 	{
 		Ogre::Real sqRadius=0.f;
+		_applyTransform();
 		for (unsigned int i=0;i<mPoints.size();i++)
 			sqRadius=std::max(sqRadius,mPoints[i].squaredLength());
 		return Ogre::Math::Sqrt(sqRadius);
 	}
 
-	/// Applies a "thickness" to a shape, ie a bit like the extruder, but in 2D
-	MultiShape thicken(Ogre::Real amount);
+	/**
+	 * Removes the points which aren't needed to keep the shape within a tolerance of its current points.
+	 * The shape stays closed if it was, keeps its first point, and a closed shape keeps at least 3 points.
+	 * Points whose removal would make the shape cross itself are kept, so the topology of the shape doesn't change.
+	 * Runs in O(n log n).
+	 * @arg tolerance the maximum distance between the current points and the simplified shape
+	 */
+	Shape& simplify(Ogre::Real tolerance);
+
+	/**
+	 * Applies a "thickness" to a shape, ie a bit like the extruder, but in 2D
+	 * @see MultiShape::thicken
+	 */
+	MultiShape thicken(Ogre::Real amount, JoinType joinType = JT_MITER, Ogre::Real miterLimit = 2., unsigned int numSegCircle = 16) const;
+
+	/**
+	 * Offsets the shape : a closed shape is grown on its out side, or shrunk if the amount is negative,
+	 * and an open shape is thickened.
+	 * @see MultiShape::offset
+	 */
+	MultiShape offset(Ogre::Real amount, JoinType joinType = JT_MITER, Ogre::Real miterLimit = 2., unsigned int numSegCircle = 16) const;
 
 	private:
 
 	enum BooleanOperationType { BOT_UNION, BOT_INTERSECTION, BOT_DIFFERENCE};
 
-	MultiShape _booleanOperation(const Shape& other, BooleanOperationType opType) const;
+	MultiShape _booleanOperation(const Shape& other, BooleanOperationType opType, BooleanWorkspace* workspace) const;
 
-	struct IntersectionInShape
-	{
-		int index[2];
-		bool onVertex[2];
-		Ogre::Vector2 position;
-		IntersectionInShape(int i, int j, Ogre::Vector2 intersect) : position(intersect)
-		{
-			index[0] = i;
-			index[1] = j;
-			onVertex[0] = false;
-			onVertex[1] = false;
-		}
-	};
+	MultiShape _booleanOperationImpl(const Shape& other, BooleanOperationType opType, BooleanWorkspace& workspace) const;
 
 	bool _isLookingForOutside(BooleanOperationType opType, char shapeSelector) const;
 
@@ -394,9 +641,17 @@ public:
 
 	bool _findWhereToGo(const Shape* inputShapes[], BooleanOperationType opType, IntersectionInShape intersection, Ogre::uint8& shapeSelector, char& isIncreasing, int& currentSegment) const;
 
-	void _findAllIntersections(const Shape& other, std::vector<IntersectionInShape>& intersections) const;
+	/**
+	 * Finds all the intersections between the segments of this shape and the segments of the other shape.
+	 * Segments are swept along the X axis, so only segments whose bounding boxes overlap are tested against each other.
+	 * Intersections are output in the same order as a test of every segment pair would give.
+	 */
+	void _findAllIntersections(const Shape& other, BooleanWorkspace& ws) const;
 
 };
+
+// MultiShape keeps its shapes in a vector, which copies them when it grows unless they can be moved without throwing
+static_assert(std::is_nothrow_move_constructible<Shape>::value, "Shape must be nothrow move constructible");
 }
 
 #endif
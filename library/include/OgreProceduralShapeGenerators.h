@@ -29,6 +29,7 @@ THE SOFTWARE.
 #define PROCEDURAL_SHAPE_GENERATORS_INCLUDED
 
 #include "OgreProceduralShape.h"
+#include "OgreProceduralSplines.h"
 
 namespace OgreProcedural
 {
@@ -44,9 +45,44 @@ protected:
 	bool mClosed;
 	/// The "out" side of the shape
 	Side mOutSide;
+	/// The maximum distance between the spline and the segments of the shape, 0 if not used
+	Ogre::Real mMaxDeviation;
+	/// The maximum angle between the tangents at both ends of a segment, 0 if not used
+	Ogre::Radian mMaxAngle;
+
+	/// Builds the shape from the curves between successive control points
+	Shape _realizeShape(const std::vector<HermiteCurve<Ogre::Vector2> >& curves) const
+	{
+		Shape shape;
+		bool isAdaptive = mMaxDeviation>0. || mMaxAngle.valueRadians()>0.;
+		size_t numPoints = mClosed?0:1;
+		for (size_t i=0;i<curves.size();i++)
+			numPoints += isAdaptive?curves[i].estimateNumSeg(mMaxDeviation, mMaxAngle):mNumSeg;
+		shape.reserve(numPoints);
+
+		if (isAdaptive)
+		{
+			for (size_t i=0;i<curves.size();i++)
+				curves[i].tessellate(shape, mMaxDeviation, mMaxAngle);
+		}
+		else
+		{
+			// All the curves are evaluated at once, one coordinate at a time
+			std::vector<Ogre::Real> coordinates[2];
+			HermiteBasis(mNumSeg).evaluate(curves, 2, coordinates);
+			for (size_t i=0;i<coordinates[0].size();i++)
+				shape.addPoint(coordinates[0][i], coordinates[1][i]);
+		}
+		if (mClosed)
+			shape.close();
+		else if (!curves.empty())
+			shape.addPoint(curves.back().p1);
+		shape.setOutSide(mOutSide);
+		return shape;
+	}
 public:
 	/// Default constructor
-	BaseSpline2() : mNumSeg(4), mClosed(false), mOutSide(SIDE_RIGHT) {}
+	BaseSpline2() : mNumSeg(4), mClosed(false), mOutSide(SIDE_RIGHT), mMaxDeviation(0.), mMaxAngle(0.) {}
 
 	/// Sets the out side of the shape
 	T& setOutSide(Side outSide)
@@ -75,6 +111,27 @@ public:
 		mClosed = true;
 		return (T&)*this;
 	}
+
+	/**
+	 * Sets the maximum distance between the spline and the segments of the shape (default=0, not used).
+	 * When a maximum distance or a maximum angle is set, the number of segments between 2 control points
+	 * isn't used any more : segments are only added where the spline bends.
+	 */
+	T& setMaxDeviation(Ogre::Real maxDeviation)
+	{
+		mMaxDeviation = maxDeviation;
+		return (T&)*this;
+	}
+
+	/**
+	 * Sets the maximum angle between the tangents of the spline at both ends of a segment of the shape (default=0, not used).
+	 * @see setMaxDeviation
+	 */
+	T& setMaxAngle(Ogre::Radian maxAngle)
+	{
+		mMaxAngle = maxAngle;
+		return (T&)*this;
+	}
 };
 
 //-----------------------------------------------------------------------
@@ -0,0 +1,298 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef PROCEDURAL_SPLINES_INCLUDED
+#define PROCEDURAL_SPLINES_INCLUDED
+
+#include "OgreVector2.h"
+#include "OgreVector3.h"
+#include "OgreMath.h"
+#include <vector>
+
+namespace OgreProcedural
+{
+//-----------------------------------------------------------------------
+/**
+ * Cubic Hermite curve, in 2D or 3D, going from p0 to p1 with the tangents m0 and m1.
+ * All the splines are made of such curves, between successive control points.
+ */
+template<class T>
+struct HermiteCurve
+{
+	T p0, m0, p1, m1;
+
+	/// Contructor with arguments
+	HermiteCurve(const T& point0, const T& tangent0, const T& point1, const T& tangent1) : p0(point0), m0(tangent0), p1(point1), m1(tangent1) {}
+
+	/// Gets the point at parameter t, between 0 and 1
+	T getPoint(Ogre::Real t) const
+	{
+		Ogre::Real t2 = t*t;
+		Ogre::Real t3 = t2*t;
+		return (2*t3-3*t2+1)*p0+(t3-2*t2+t)*m0+(-2*t3+3*t2)*p1+(t3-t2)*m1;
+	}
+
+	/// Gets the derivative at parameter t, ie the direction of the curve scaled by its speed
+	T getDerivative(Ogre::Real t) const
+	{
+		Ogre::Real t2 = t*t;
+		return (6*t2-6*t)*(p0-p1)+(3*t2-4*t+1)*m0+(3*t2-2*t)*m1;
+	}
+
+	/// Gets the second derivative at parameter t
+	T getSecondDerivative(Ogre::Real t) const
+	{
+		return (12*t-6)*(p0-p1)+(6*t-4)*m0+(6*t-2)*m1;
+	}
+
+	/**
+	 * Gets the length of the curve between 2 parameters.
+	 * Uses a 3 points Gauss-Legendre quadrature, which is very accurate over short ranges.
+	 */
+	Ogre::Real getLength(Ogre::Real t0, Ogre::Real t1) const
+	{
+		Ogre::Real halfRange = .5f*(t1-t0);
+		Ogre::Real middle = .5f*(t0+t1);
+		Ogre::Real offset = halfRange*0.774596669f;
+		return halfRange*((5.f/9.f)*getDerivative(middle-offset).length()
+			+ (8.f/9.f)*getDerivative(middle).length()
+			+ (5.f/9.f)*getDerivative(middle+offset).length());
+	}
+
+	/**
+	 * Estimates the number of segments tessellate() will output.
+	 * The chord of a piece of curve deviates from it by at most the square of the piece's parameter length
+	 * times an eighth of the largest second derivative, which is reached at one end, since the curve is cubic.
+	 * The turn of the curve is estimated from the tangents at both ends and in the middle.
+	 */
+	unsigned int estimateNumSeg(Ogre::Real maxDeviation, Ogre::Radian maxAngle) const
+	{
+		Ogre::Real numSeg = 1.;
+		if (maxDeviation>0.)
+		{
+			Ogre::Real secondDerivative = std::max(getSecondDerivative(0.).length(), getSecondDerivative(1.).length());
+			numSeg = std::max(numSeg, Ogre::Math::Sqrt(secondDerivative/(8*maxDeviation)));
+		}
+		if (maxAngle.valueRadians()>0.)
+		{
+			Ogre::Real turn = _angleBetween(getDerivative(0.), getDerivative(.5)) + _angleBetween(getDerivative(.5), getDerivative(1.));
+			numSeg = std::max(numSeg, turn/maxAngle.valueRadians());
+		}
+		return (unsigned int)Ogre::Math::Ceil(numSeg);
+	}
+
+	/**
+	 * Outputs points along the curve, from p0 included to p1 excluded, so that successive curves can be chained.
+	 * The curve is cut in halves again and again, until each piece is close enough to its chord
+	 * and turns by less than the maximum angle, so that straight parts only get a few points.
+	 * @arg output anything with an addPoint(T) method
+	 * @arg maxDeviation the maximum distance between the curve and its segments, or 0
+	 * @arg maxAngle the maximum angle between the tangents at both ends of a segment, or 0
+	 */
+	template<class Output>
+	void tessellate(Output& output, Ogre::Real maxDeviation, Ogre::Radian maxAngle) const
+	{
+		Ogre::Real cosMaxAngle = (maxAngle.valueRadians()>0.)?Ogre::Math::Cos(maxAngle.valueRadians()):-2.;
+		_tessellate(output, 0., p0, 1., p1, maxDeviation, cosMaxAngle, 0);
+	}
+
+private:
+	static Ogre::Real _angleBetween(const T& a, const T& b)
+	{
+		Ogre::Real lengthProduct = a.length()*b.length();
+		if (lengthProduct<=0.)
+			return 0.;
+		return Ogre::Math::ACos(Ogre::Math::Clamp(a.dotProduct(b)/lengthProduct, (Ogre::Real)-1., (Ogre::Real)1.)).valueRadians();
+	}
+
+	static Ogre::Real _distanceToChord(const T& point, const T& a, const T& b)
+	{
+		T ab = b-a;
+		Ogre::Real squaredLength = ab.squaredLength();
+		if (squaredLength<=0.)
+			return (point-a).length();
+		Ogre::Real t = Ogre::Math::Clamp((point-a).dotProduct(ab)/squaredLength, (Ogre::Real)0., (Ogre::Real)1.);
+		return (a+t*ab-point).length();
+	}
+
+	template<class Output>
+	void _tessellate(Output& output, Ogre::Real t0, const T& a, Ogre::Real t1, const T& b, Ogre::Real maxDeviation, Ogre::Real cosMaxAngle, int depth) const
+	{
+		Ogre::Real tm = .5f*(t0+t1);
+		T middle = getPoint(tm);
+		// 12 levels is 4096 segments per curve, more than enough
+		bool isFlat = depth>=12;
+		if (!isFlat)
+		{
+			isFlat = true;
+			if (maxDeviation>0.)
+				isFlat = _distanceToChord(middle, a, b)<=maxDeviation
+					&& _distanceToChord(getPoint(.5f*(t0+tm)), a, b)<=maxDeviation
+					&& _distanceToChord(getPoint(.5f*(tm+t1)), a, b)<=maxDeviation;
+			if (isFlat && cosMaxAngle>-2.)
+			{
+				T d0 = getDerivative(t0);
+				T d1 = getDerivative(t1);
+				isFlat = d0.dotProduct(d1) >= cosMaxAngle*d0.length()*d1.length();
+			}
+		}
+		if (isFlat)
+		{
+			output.addPoint(a);
+			return;
+		}
+		_tessellate(output, t0, a, tm, middle, maxDeviation, cosMaxAngle, depth+1);
+		_tessellate(output, tm, middle, t1, b, maxDeviation, cosMaxAngle, depth+1);
+	}
+};
+//-----------------------------------------------------------------------
+/**
+ * Weights of the 4 Hermite basis functions at evenly spaced parameters, each function having its own array.
+ * Catmull-Rom and Kochanek-Bartels splines only differ from Hermite splines by their tangents,
+ * so the same weights serve all the splines, in 2D and in 3D.
+ */
+class HermiteBasis
+{
+	std::vector<Ogre::Real> mWeights[4];
+public:
+	/// Computes the weights at the parameters j/numSeg, for j from 0 to numSeg-1
+	HermiteBasis(unsigned int numSeg)
+	{
+		for (int k=0;k<4;k++)
+			mWeights[k].resize(numSeg);
+		for (unsigned int j=0;j<numSeg;j++)
+		{
+			Ogre::Real t = (Ogre::Real)j/(Ogre::Real)numSeg;
+			Ogre::Real t2 = t*t;
+			Ogre::Real t3 = t2*t;
+			mWeights[0][j] = 2*t3-3*t2+1;
+			mWeights[1][j] = t3-2*t2+t;
+			mWeights[2][j] = -2*t3+3*t2;
+			mWeights[3][j] = t3-t2;
+		}
+	}
+
+	/// Gets the number of parameters
+	size_t getSize() const
+	{
+		return mWeights[0].size();
+	}
+
+	/**
+	 * Evaluates a batch of curves at all the parameters, as the product of the weights by the geometry of each curve.
+	 * Each coordinate has its own output array, in which the points of the curves follow each other.
+	 * The inner loop only goes through plain arrays, so that the compiler can vectorize it.
+	 * @arg curves the curves to evaluate
+	 * @arg numCoordinates the number of coordinates of the points, 2 or 3
+	 * @arg outputs an array per coordinate, resized to the number of curves times the number of parameters
+	 */
+	template<class T>
+	void evaluate(const std::vector<HermiteCurve<T> >& curves, unsigned int numCoordinates, std::vector<Ogre::Real>* outputs) const
+	{
+		size_t size = getSize();
+		const Ogre::Real* w0 = size?&mWeights[0][0]:0;
+		const Ogre::Real* w1 = size?&mWeights[1][0]:0;
+		const Ogre::Real* w2 = size?&mWeights[2][0]:0;
+		const Ogre::Real* w3 = size?&mWeights[3][0]:0;
+		for (unsigned int c=0;c<numCoordinates;c++)
+		{
+			outputs[c].resize(curves.size()*size);
+			for (size_t i=0;i<curves.size();i++)
+			{
+				const HermiteCurve<T>& curve = curves[i];
+				Ogre::Real g0 = curve.p0[c], g1 = curve.m0[c], g2 = curve.p1[c], g3 = curve.m1[c];
+				Ogre::Real* output = size?&outputs[c][i*size]:0;
+				for (size_t j=0;j<size;j++)
+					output[j] = w0[j]*g0+w1[j]*g1+w2[j]*g2+w3[j]*g3;
+			}
+		}
+	}
+};
+//-----------------------------------------------------------------------
+/**
+ * Table of the arc length along a chain of curves, to sample them at evenly spaced lineic positions,
+ * ie as if they were travelled at constant speed.
+ * Each curve is cut into a few intervals whose lengths are integrated once,
+ * and the parameter of a lineic position is found in its interval with a Newton step.
+ */
+template<class T>
+class ArcLengthTable
+{
+	const std::vector<HermiteCurve<T> >& mCurves;
+	/// Lineic position at the start of each interval, and the total length at the end
+	std::vector<Ogre::Real> mLengths;
+	static const int NUM_INTERVALS = 16;
+public:
+	/// Builds the table of a chain of curves
+	ArcLengthTable(const std::vector<HermiteCurve<T> >& curves) : mCurves(curves)
+	{
+		mLengths.reserve(curves.size()*NUM_INTERVALS+1);
+		Ogre::Real length = 0.;
+		for (size_t i=0;i<curves.size();i++)
+			for (int k=0;k<NUM_INTERVALS;k++)
+			{
+				mLengths.push_back(length);
+				length += curves[i].getLength((Ogre::Real)k/NUM_INTERVALS, (Ogre::Real)(k+1)/NUM_INTERVALS);
+			}
+		mLengths.push_back(length);
+	}
+
+	/// Gets the length of the whole chain
+	Ogre::Real getTotalLength() const
+	{
+		return mLengths.back();
+	}
+
+	/**
+	 * Gets the point at a lineic position.
+	 * @arg coord lineic position, between 0 and the total length
+	 * @arg cursor interval where the search starts (0 the first time), updated to the interval found.
+	 * Sampling in order only moves it forward.
+	 */
+	T getPoint(Ogre::Real coord, size_t& cursor) const
+	{
+		size_t lastInterval = mLengths.size()-2;
+		cursor = std::min(cursor, lastInterval);
+		while (cursor>0 && coord<mLengths[cursor])
+			cursor--;
+		while (cursor<lastInterval && coord>=mLengths[cursor+1])
+			cursor++;
+		const HermiteCurve<T>& curve = mCurves[cursor/NUM_INTERVALS];
+		Ogre::Real t0 = (Ogre::Real)(cursor%NUM_INTERVALS)/NUM_INTERVALS;
+		Ogre::Real t1 = t0+(Ogre::Real)1./NUM_INTERVALS;
+		Ogre::Real intervalLength = mLengths[cursor+1]-mLengths[cursor];
+		if (intervalLength<=0.)
+			return curve.getPoint(t0);
+		Ogre::Real t = t0+(t1-t0)*(coord-mLengths[cursor])/intervalLength;
+		Ogre::Real speed = curve.getDerivative(t).length();
+		if (speed>0.)
+			t = Ogre::Math::Clamp(t-(mLengths[cursor]+curve.getLength(t0, t)-coord)/speed, t0, t1);
+		return curve.getPoint(t);
+	}
+};
+}
+#endif
@@ -36,6 +36,8 @@ namespace OgreProcedural
 /**
  * Represents a curve by interpolating between a list of key/values.
  * It always refers to a "principal" curve (a path, atm), so the keys to either its point index or lineic position.
+ * Keys are kept sorted in a flat array. The coefficients of the smooth interpolation modes are computed
+ * on the first read after a change, so a track which has just been changed shouldn't be first read by several threads at once.
  */
 class _ProceduralExport Track
 {
@@ -48,6 +50,17 @@ public:
 	{
 		AM_ABSOLUTE_LINEIC, AM_RELATIVE_LINEIC, AM_POINT
 	};
+
+	/// Defines how values are interpolated between keys
+	enum InterpolationMode
+	{
+		/// Straight lines between keys
+		IM_LINEAR,
+		/// Cubic curve through the keys, with continuous slope (Catmull-Rom). It may overshoot the values of the keys.
+		IM_CATMULL_ROM,
+		/// Cubic curve through the keys, with continuous slope, which never goes beyond the values of the keys around it
+		IM_MONOTONIC_CUBIC
+	};
 protected:
 	/// Adressing mode of the track (see the enum definition for more details)
 	AddressingMode mAddressingMode;
@@ -55,12 +68,41 @@ protected:
 	/// Tells whether we should add new points to principal curve if a key is defined here but not on principal curve
 	bool mInsertPoint;
 
-	/// Key frames
-	std::map<Ogre::Real, Ogre::Real> mKeyFrames;
+	/// Interpolation mode of the track
+	InterpolationMode mInterpolationMode;
+
+	/// Keys, sorted, and their values
+	std::vector<Ogre::Real> mKeys;
+	std::vector<Ogre::Real> mValues;
+
+	/// With smooth interpolation, value = c0+t*(c1+t*(c2+t*c3)) between key i and key i+1, t going from 0 to 1,
+	/// coefficients c0 to c3 being stored at 4*i
+	mutable std::vector<Ogre::Real> mCoefficients;
+	mutable bool mCoefficientsDirty;
+
+	/// Values sampled at a fixed step, from the first key to the last one, if a lookup table has been baked
+	std::vector<Ogre::Real> mLookupTable;
+	Ogre::Real mLookupTableScale;
+
+	void _updateCoefficients() const;
+
+	/// Finds the segment of a position, ie the index of the last key before it, starting from a cursor
+	inline unsigned int _findSegment(Ogre::Real pos, unsigned int cursor) const
+	{
+		if (cursor+1>=mKeys.size() || pos<mKeys[cursor])
+			return (unsigned int)std::max<int>(0, (int)(std::upper_bound(mKeys.begin(), mKeys.end(), pos)-mKeys.begin())-1);
+		while (cursor+2<mKeys.size() && mKeys[cursor+1]<=pos)
+			cursor++;
+		return cursor;
+	}
+
+	Ogre::Real _interpolate(Ogre::Real pos, unsigned int segment) const;
+
 public:
 	/// Default constructor.
 	/// Point insertion default to true, and addressing to absolute lineic
-	Track(AddressingMode addressingMode=AM_ABSOLUTE_LINEIC, bool insertPoint=true) : mAddressingMode(addressingMode), mInsertPoint(insertPoint) {}
+	Track(AddressingMode addressingMode=AM_ABSOLUTE_LINEIC, bool insertPoint=true) : mAddressingMode(addressingMode), mInsertPoint(insertPoint),
+		mInterpolationMode(IM_LINEAR), mCoefficientsDirty(true), mLookupTableScale(0.) {}
 
 	/// Gets addressing mode of the curve
 	AddressingMode getAddressingMode() const
@@ -69,12 +111,32 @@ public:
 	}
 
 	/// Inserts a new Key/Value couple anywhere on the track (it is auto-sorted anyway)
-	inline Track& addKeyFrame(Ogre::Real pos, Ogre::Real value)
+	Track& addKeyFrame(Ogre::Real pos, Ogre::Real value);
+
+	/// Sets how values are interpolated between keys (default=IM_LINEAR)
+	inline Track& setInterpolationMode(InterpolationMode interpolationMode)
 	{
-		mKeyFrames[pos] = value;
+		mInterpolationMode = interpolationMode;
+		mCoefficientsDirty = true;
+		mLookupTable.clear();
 		return *this;
 	}
 
+	/// Gets the interpolation mode of the track
+	InterpolationMode getInterpolationMode() const
+	{
+		return mInterpolationMode;
+	}
+
+	/**
+	 * Samples the track at a fixed step between its first and last keys, so that reading a value
+	 * only takes a linear interpolation between two samples.
+	 * Values are then approximations, unless the keys fall on the samples and the interpolation is linear.
+	 * The table is dropped when the track is changed.
+	 * @arg numSamples The number of samples, at least 2
+	 */
+	Track& bakeLookupTable(unsigned int numSamples);
+
 	/// @copydoc Track::mInsertPoint
 	inline bool isInsertPoint() const
 	{
@@ -87,32 +149,45 @@ public:
 	/// Gets the value on the current point
 	Ogre::Real getValue(Ogre::Real pos) const;
 
-	/// Get the key value couple before current point, taking into account addressing mode.
-	/// If current point is below minimum key, issues minimum key
-	std::map<Ogre::Real, Ogre::Real>::const_iterator _getKeyValueBefore(Ogre::Real absPos, Ogre::Real relPos, int index) const;
+	/**
+	 * Gets the value on the current point, taking into account the addressing mode, starting the search of the keys from a cursor.
+	 * When values are read in order, as the extruder does, each call only moves the cursor forward by a few keys.
+	 * @arg cursor index of the key where the search starts (0 the first time), updated to the last key before the point
+	 */
+	Ogre::Real getValue(Ogre::Real absPos, Ogre::Real relPos, int index, unsigned int& cursor) const;
+
+	/// Gets the value on the current point, starting the search of the keys from a cursor
+	/// @see getValue(Ogre::Real, Ogre::Real, int, unsigned int&) const
+	Ogre::Real getValue(Ogre::Real pos, unsigned int& cursor) const;
 
-	/// Get the key value couple before current point.
-	/// If current point is below minimum key, issues minimum key/value
-	std::map<Ogre::Real, Ogre::Real>::const_iterator _getKeyValueBefore(Ogre::Real pos) const;
+	/// Gets the number of keys
+	size_t getKeyCount() const
+	{
+		return mKeys.size();
+	}
 
-	/// Get the key value couple after current point, taking into account addressing mode.
-	/// If current point is above maximum key, issues maximum key/value
-	std::map<Ogre::Real, Ogre::Real>::const_iterator _getKeyValueAfter(Ogre::Real absPos, Ogre::Real relPos, int index) const;
+	/// Gets the i-th key, keys being sorted
+	Ogre::Real getKey(size_t i) const
+	{
+		return mKeys[i];
+	}
 
-	/// Get the key value couple after current point.
-	/// If current point is above maximum key, issues maximum key/value
-	std::map<Ogre::Real, Ogre::Real>::const_iterator _getKeyValueAfter(Ogre::Real pos) const;
+	/// Gets the value of the i-th key
+	Ogre::Real getKeyValue(size_t i) const
+	{
+		return mValues[i];
+	}
 
 	/// Gets the first value in the track
-	Ogre::Real getFirstValue()
+	Ogre::Real getFirstValue() const
 	{
-		return mKeyFrames.begin()->second;
+		return mValues.front();
 	}
 
 	/// Gets the last value in the track
-	Ogre::Real getLastValue()
+	Ogre::Real getLastValue() const
 	{
-		return (--mKeyFrames.end())->second;
+		return mValues.back();
 	}
 };
 //---------------------------------------------------
@@ -42,8 +42,8 @@ namespace OgreProcedural
  */
 class TriangleBuffer
 {
-	std::vector<int> mIndices;
-
+public:
+	/// A vertex of the buffer
 	struct Vertex
 	{
 		Ogre::Vector3 mPosition;
@@ -51,6 +51,8 @@ class TriangleBuffer
 		Ogre::Vector2 mUV;
 	};
 
+private:
+	std::vector<int> mIndices;
 	std::vector<Vertex> mVertices;
 	//std::vector<Vertex>::iterator mCurrentVertex;
 	int globalOffset;
@@ -167,6 +169,74 @@ class TriangleBuffer
 		return *this;
 	}
 
+	/// Gets the number of vertices in the buffer
+	size_t getVertexCount() const
+	{
+		return mVertices.size();
+	}
+
+	/// Gets the number of indices in the buffer
+	size_t getIndexCount() const
+	{
+		return mIndices.size();
+	}
+
+	/// Gets the vertices of the buffer
+	const std::vector<Vertex>& getVertices() const
+	{
+		return mVertices;
+	}
+
+	/// Gets the indices of the buffer. Unlike the ones given to index(), they are absolute.
+	const std::vector<int>& getIndices() const
+	{
+		return mIndices;
+	}
+
+	/**
+	 * Adds room for vertices and indices at the end of the buffer,
+	 * to be filled with setPosition(), setNormal(), setTextureCoord() and setIndex().
+	 * Different vertices and indices can then be filled by different threads at the same time.
+	 */
+	void extend(size_t numVertices, size_t numIndices)
+	{
+		mVertices.resize(mVertices.size()+numVertices);
+		mIndices.resize(mIndices.size()+numIndices);
+		if (!mVertices.empty())
+			mCurrentVertex = &mVertices.back();
+	}
+
+	/// Sets the position of a vertex
+	inline TriangleBuffer& setPosition(size_t vertexIndex, const Ogre::Vector3& pos)
+	{
+		mVertices[vertexIndex].mPosition = pos;
+		return *this;
+	}
+
+	/// Sets the normal of a vertex
+	inline TriangleBuffer& setNormal(size_t vertexIndex, const Ogre::Vector3& normal)
+	{
+		mVertices[vertexIndex].mNormal = normal;
+		return *this;
+	}
+
+	/// Sets the texture coordinates of a vertex
+	inline TriangleBuffer& setTextureCoord(size_t vertexIndex, const Ogre::Vector2& vec)
+	{
+		mVertices[vertexIndex].mUV = vec;
+		return *this;
+	}
+
+	/**
+	 * Sets an index of the index buffer.
+	 * Unlike index(), the vertex index is absolute.
+	 */
+	inline TriangleBuffer& setIndex(size_t i, int vertexIndex)
+	{
+		mIndices[i] = vertexIndex;
+		return *this;
+	}
+
 	/// Applies a matrix to transform all vertices inside the triangle buffer
 	TriangleBuffer& applyTransform(const Ogre::Matrix4& matrix)
 	{
@@ -0,0 +1,131 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef PROCEDURAL_TRIANGULATION_CACHE_INCLUDED
+#define PROCEDURAL_TRIANGULATION_CACHE_INCLUDED
+
+#include "OgreProceduralPlatform.h"
+#include "OgreProceduralShape.h"
+#include "OgreProceduralMultiShape.h"
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace OgreProcedural
+{
+/**
+ * Keeps the results of previous triangulations, so that identical shapes are only triangulated once.
+ * Shapes are looked up with a hash of their geometry, then compared point by point,
+ * so two different shapes never share an entry.
+ * The cache can be shared by several triangulators running at the same time.
+ * When it's full, the least recently used entry is dropped.
+ */
+class _ProceduralExport TriangulationCache
+{
+public:
+	/// Triangles of a cached triangulation, as counter-clockwise triplets of vertex indices
+	typedef std::shared_ptr<const std::vector<int> > IndexListPtr;
+
+private:
+	struct Entry
+	{
+		size_t hash;
+		/// Geometry of the triangulated shapes : each shape is stored as its point count, its closed flag, its out side, then its points
+		std::vector<Ogre::Real> key;
+		IndexListPtr indices;
+	};
+	typedef std::list<Entry> EntryList;
+
+	/// Entries, most recently used first
+	EntryList mEntries;
+	std::map<size_t, EntryList::iterator> mEntriesByHash;
+	size_t mMaxEntries;
+	size_t mHitCount;
+	size_t mMissCount;
+	mutable std::mutex mMutex;
+
+	static void _buildKey(const MultiShape& multiShape, std::vector<Ogre::Real>& key);
+	static size_t _computeHash(const std::vector<Ogre::Real>& key);
+	void _trim();
+
+public:
+	/**
+	 * Constructor
+	 * @arg maxEntries The maximum number of triangulations kept in the cache
+	 */
+	TriangulationCache(size_t maxEntries=64) : mMaxEntries(maxEntries), mHitCount(0), mMissCount(0) {}
+
+	/**
+	 * Looks for the triangulation of a multishape
+	 * @return the triangles if the multishape is in the cache, an empty pointer otherwise
+	 */
+	IndexListPtr find(const MultiShape& multiShape);
+
+	/**
+	 * Stores the triangulation of a multishape, replacing any previous one
+	 * @arg multiShape The triangulated multishape
+	 * @arg indices The triangles, indexing the points of all shapes in order
+	 */
+	void insert(const MultiShape& multiShape, const std::vector<int>& indices);
+
+	/// Sets the maximum number of triangulations kept in the cache (default=64)
+	TriangulationCache& setMaxEntries(size_t maxEntries);
+
+	/// Gets the maximum number of triangulations kept in the cache
+	size_t getMaxEntries() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mMaxEntries;
+	}
+
+	/// Gets the number of triangulations currently in the cache
+	size_t getEntryCount() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mEntries.size();
+	}
+
+	/// Gets the number of lookups which found their triangulation in the cache
+	size_t getHitCount() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mHitCount;
+	}
+
+	/// Gets the number of lookups which didn't find their triangulation in the cache
+	size_t getMissCount() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mMissCount;
+	}
+
+	/// Removes all the triangulations from the cache, and resets the counters
+	void clear();
+};
+}
+#endif
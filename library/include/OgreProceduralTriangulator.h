@@ -39,6 +39,31 @@ THE SOFTWARE.
 namespace OgreProcedural
 {
 typedef std::vector<Ogre::Vector2> PointList;
+class TriangulationCache;
+
+/**
+ * Receives the result of a triangulation, as soon as it is available.
+ * Implementing a sink lets the caller write vertices and indices directly
+ * where they are needed, without going through intermediate buffers.
+ */
+class _ProceduralExport TriangulationSink
+{
+public:
+	virtual ~TriangulationSink() {}
+
+	/**
+	 * Called once, before any vertex or triangle
+	 * @arg numVertices The number of vertices which will be output
+	 * @arg numTriangles The number of triangles which will be output
+	 */
+	virtual void begin(size_t numVertices, size_t numTriangles) {}
+
+	/// Outputs a vertex. Vertices are output in the same order as the points of the triangulated shapes.
+	virtual void vertex(const Ogre::Vector2& position) = 0;
+
+	/// Outputs a counter-clockwise triangle, made of indices of vertices
+	virtual void triangle(int i0, int i1, int i2) = 0;
+};
 
 /** Implements a Delaunay Triangulation algorithm.
  * It works on Shapes to build Triangle Buffers
@@ -47,7 +72,8 @@ class _ProceduralExport Triangulator : public MeshGenerator<Triangulator>
 {
 	struct Triangle;
 	struct DelaunaySegment;
-	typedef std::list<Triangle> DelaunayTriangleBuffer;
+	struct HalfEdge;
+	typedef std::vector<Triangle> DelaunayTriangleBuffer;
 
 //-----------------------------------------------------------------------
 struct DelaunaySegment
@@ -67,74 +93,174 @@ struct DelaunaySegment
 	}
 };
 
-	//-----------------------------------------------------------------------
+//-----------------------------------------------------------------------
+/**
+ * Triangle of the Delaunay triangulation.
+ * Vertices are stored counter-clockwise, and n[k] is the triangle sharing the
+ * edge opposite to vertex k (-1 if there's none).
+ */
 struct Triangle
 {
-	const PointList* pl;
 	int i[3];
-	Triangle(const PointList* pl)
-	{	this->pl = pl;
-	}
+	int n[3];
+	bool constrained[3];
+	bool isDead;
+	int mark;
 
-	inline Ogre::Vector2 p(int k) const
+	Triangle() : isDead(false), mark(-1)
 	{
-		return (*pl)[i[k]];
+		for (int k=0;k<3;k++)
+		{
+			i[k] = -1;
+			n[k] = -1;
+			constrained[k] = false;
+		}
 	}
 
-	bool operator==(const Triangle& other) const
+	inline Ogre::Vector2 p(int k, const PointList& pl) const
 	{
-		return i[0]==other.i[0] && i[1]==other.i[1] && i[2]==other.i[2];
+		return pl[i[k]];
 	}
 
-	inline Ogre::Vector2 getMidPoint() const
+	inline Ogre::Vector2 getMidPoint(const PointList& pl) const
 	{
-		return 1.f/3.f * (p(0)+p(1)+p(2));
+		return 1.f/3.f * (p(0, pl)+p(1, pl)+p(2, pl));
 	}
 
 	void setVertices(int i0, int i1, int i2);
 
 	int findSegNumber(int i0, int i1) const;
 
-	bool isPointInside(const Ogre::Vector2& point);
+	int findVertex(int v) const
+	{
+		for (int k=0;k<3;k++)
+			if (i[k]==v)
+				return k;
+		return -1;
+	}
 
 	bool containsSegment(int i0, int i1) const
 	{
 		return ((i0==i[0] || i0==i[1] || i0==i[2])&&(i1==i[0] || i1==i[1] || i1==i[2]));
 	}
 
-	bool isPointInsideCircumcircle(const Ogre::Vector2& point);
+	bool isPointInsideCircumcircle(const Ogre::Vector2& point, const PointList& pl) const;
 
-	void makeDirectIfNeeded()
-	{
-		if ((p(1)-p(0)).crossProduct(p(2)-p(0))<0)
-		{
-			std::swap(i[0], i[1]);
-		}
-	}
+	void makeDirectIfNeeded(const PointList& pl);
 };
+
+	Shape* mShapeToTriangulate;
+	MultiShape* mMultiShapeToTriangulate;
+	unsigned int mNumThreads;
+
 //-----------------------------------------------------------------------
-struct TouchSuperTriangle
+/// Edge of a triangle, used to link triangles together after a local re-triangulation
+struct HalfEdge
 {
-	int i0,i1,i2;
-	TouchSuperTriangle(int i, int j, int k) : i0(i), i1(j), i2(k) {}
-	bool operator()(const Triangulator::Triangle& tri)
+	int i1, i2;
+	int triangle;
+	int k;
+	bool constrained;
+	HalfEdge(int _i1, int _i2, int _triangle, int _k, bool _constrained=false) : i1(_i1), i2(_i2), triangle(_triangle), k(_k), constrained(_constrained) {}
+	bool operator<(const HalfEdge& other) const
 	{
-		for (int k=0;k<3;k++) if (tri.i[k]==i0 || tri.i[k]==i1 ||tri.i[k]==i2) return true;
-		return false;
+		if (i1!=other.i1)
+			return i1<other.i1;
+		else
+			return i2<other.i2;
 	}
 };
 
-	Shape* mShapeToTriangulate;
-	MultiShape* mMultiShapeToTriangulate;
+public:
+	/**
+	 * Scratch memory of the triangulation.
+	 * Keeping a workspace between calls to triangulate() lets the triangulator reuse
+	 * its buffers instead of allocating new ones for each shape.
+	 * A workspace can't be shared by triangulations running at the same time.
+	 * The output is not held by the workspace : the index buffer, point list or triangle buffer receiving the triangles grows as usual.
+	 */
+	class _ProceduralExport Workspace
+	{
+		friend class Triangulator;
+
+		PointList mPoints;
+		DelaunayTriangleBuffer mTriangles;
+		DelaunayTriangleBuffer mNewTriangles;
+		std::vector<int> mVertexTriangles;
+		std::vector<int> mShuffledPoints;
+		std::vector<std::pair<int, int> > mInsertionOrder;
+		std::vector<int> mCavity;
+		std::vector<int> mStack;
+		std::vector<int> mFreeTriangles;
+		std::vector<int> mCrossed;
+		std::vector<int> mPointsAbove;
+		std::vector<int> mPointsBelow;
+		std::vector<int> mDepth;
+		std::vector<HalfEdge> mInnerEdges;
+		std::vector<HalfEdge> mOuterEdges;
+		MultiShape mShapeWrapper;
 
-	void delaunay(PointList& pointList, DelaunayTriangleBuffer& tbuffer) const;
-	void addConstraints(const MultiShape& multiShape, DelaunayTriangleBuffer& tbuffer, const PointList& pl) const;
-	void _recursiveTriangulatePolygon(const DelaunaySegment& cuttingSeg, std::vector<int> inputPoints, DelaunayTriangleBuffer& tbuffer, const PointList&  pl) const;
+		size_t mCallCount;
+		size_t mGrowthCount;
+		size_t mMemoryUsage;
+
+		size_t _computeMemoryUsage() const;
+		void _endCall();
+	public:
+		/// Default ctor
+		Workspace() : mCallCount(0), mGrowthCount(0), mMemoryUsage(0) {}
+
+		/// Gets the number of triangulations which used this workspace
+		size_t getCallCount() const
+		{
+			return mCallCount;
+		}
+
+		/// Gets the number of triangulations which had to grow the buffers of this workspace, whatever the number of buffers they grew
+		size_t getGrowthCount() const
+		{
+			return mGrowthCount;
+		}
+
+		/// Gets the memory held by the buffers of this workspace, in bytes
+		size_t getMemoryUsage() const
+		{
+			return mMemoryUsage;
+		}
+
+		/// Resets the counters
+		void resetCounters()
+		{
+			mCallCount = 0;
+			mGrowthCount = 0;
+		}
+
+		/// Releases all the memory held by this workspace
+		void clear();
+	};
+
+private:
+	Workspace* mWorkspace;
+	TriangulationCache* mCache;
+
+	size_t _triangulate(const MultiShape& multiShape, Workspace& ws, bool* allConstraintsInserted=0) const;
+	void _triangulate(const MultiShape& multiShape, Workspace& ws, TriangulationSink& sink) const;
+	static void _findComponents(const MultiShape& multiShape, std::vector<std::vector<int> >& components);
+	static void _splitContour(const Shape& shape, size_t numPieces, std::vector<std::vector<int> >& pieces);
+	static bool _cutPiece(const PointList& pl, const std::vector<int>& piece, std::vector<int>& firstPart, std::vector<int>& secondPart);
+	static bool _isDiagonal(const PointList& pl, const std::vector<int>& piece, size_t a, size_t b, double orientation);
+	static void _copyTriangles(const DelaunayTriangleBuffer& tbuffer, const std::vector<int>& globalIndices, DelaunayTriangleBuffer& output, std::vector<int>& triangleIndices);
+	static bool _stitchPieces(DelaunayTriangleBuffer& tbuffer, const PointList& pl, size_t shapeOffset, size_t numPieces, std::vector<int>& stack);
+	void delaunay(Workspace& ws) const;
+	bool addConstraints(const MultiShape& multiShape, Workspace& ws) const;
+	bool _insertConstraint(int i1, int i2, int mark, Workspace& ws) const;
+	static void _setConstrained(DelaunayTriangleBuffer& tbuffer, int t, int i0, int i1);
+	void _recursiveTriangulatePolygon(const DelaunaySegment& cuttingSeg, const std::vector<int>& inputPoints, size_t first, size_t last, DelaunayTriangleBuffer& tbuffer, const PointList& pl) const;
 
 public:
 
 	/// Default ctor
-	Triangulator() : mShapeToTriangulate(0), mMultiShapeToTriangulate(0) {}
+	Triangulator() : mShapeToTriangulate(0), mMultiShapeToTriangulate(0), mNumThreads(0), mWorkspace(0), mCache(0) {}
 
 	/// Sets shape to triangulate
 	Triangulator& setShapeToTriangulate(Shape* shape)
@@ -151,12 +277,58 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Sets the number of threads used for the triangulation (default=0, one thread per hardware core)
+	 * Independent outer contours of a multishape, along with the holes they contain,
+	 * are triangulated in parallel. A big contour without holes is also cut along its diagonals into pieces,
+	 * which are triangulated in parallel, then stitched back together by flipping the edges which aren't Delaunay along the cuts.
+	 * An outer contour with holes is triangulated by one thread, and so are small multishapes.
+	 */
+	Triangulator& setNumThreads(unsigned int numThreads)
+	{
+		mNumThreads = numThreads;
+		return *this;
+	}
+
+	/**
+	 * Sets the workspace used by the triangulation (default=0)
+	 * If no workspace is set, a temporary one is used.
+	 * When several threads are used, the other threads work in temporary workspaces.
+	 */
+	Triangulator& setWorkspace(Workspace* workspace)
+	{
+		mWorkspace = workspace;
+		return *this;
+	}
+
+	/**
+	 * Sets the cache used by the triangulation (default=0)
+	 * Shapes found in the cache aren't triangulated again,
+	 * and the triangulation of other shapes is added to the cache.
+	 * A cache can be shared by several triangulators.
+	 */
+	Triangulator& setCache(TriangulationCache* cache)
+	{
+		mCache = cache;
+		return *this;
+	}
+
 	/**
 	 * Executes the Constrained Delaunay Triangulation algorithm
+	 * Indices are 32 bits wide, so there is no limit on the number of input points
+	 * other than memory.
 	 * @arg ouput A vector of index where is outputed the resulting triangle indexes
+	 * @arg outputVertices A vector of vertices referenced by the index buffer
 	 */
 	void triangulate(std::vector<int>& output, PointList& outputVertices) const;
 
+	/**
+	 * Executes the Constrained Delaunay Triangulation algorithm,
+	 * and streams the result to a sink
+	 * @arg sink Receives the vertices and the triangles
+	 */
+	void triangulate(TriangulationSink& sink) const;
+
 	/**
 	 * Builds the mesh into the given TriangleBuffer
 	 * @param buffer The TriangleBuffer on where to append the mesh.
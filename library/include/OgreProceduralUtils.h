@@ -29,6 +29,9 @@ THE SOFTWARE.
 #define PROCEDURAL_UTILS_INCLUDED
 #include "OgreVector3.h"
 #include "OgreAxisAlignedBox.h"
+#include <thread>
+#include <vector>
+#include <exception>
 
 namespace OgreProcedural
 {
@@ -159,6 +162,45 @@ public:
 	 */
 	static Ogre::Quaternion _computeQuaternion(Ogre::Vector3 direction);
 
+	/**
+	 * Splits the items from 0 to count into contiguous ranges, and calls f(first, last) on each range from its own thread.
+	 * @arg numThreads The maximum number of threads. 0 means one thread per hardware core.
+	 * @arg minCountPerThread Below that many items per thread, starting threads costs more than it saves,
+	 * so fewer threads are used, down to calling f(0, count) from the calling thread.
+	 * An exception thrown by f in one of the threads is thrown again from the calling thread, once all the threads are done.
+	 */
+	template<typename F>
+	static void _parallelFor(size_t count, unsigned int numThreads, size_t minCountPerThread, const F& f)
+	{
+		if (numThreads==0)
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		numThreads = (unsigned int)std::min<size_t>(numThreads, count/std::max<size_t>(minCountPerThread, 1)+1);
+		if (numThreads<2)
+		{
+			f((size_t)0, count);
+			return;
+		}
+		// An exception escaping a thread would terminate the program, so each thread keeps its own
+		std::vector<std::exception_ptr> errors(numThreads);
+		std::vector<std::thread> threads;
+		for (unsigned int t=0;t<numThreads;t++)
+			threads.push_back(std::thread([&f, &errors, t, count, numThreads]()
+			{
+				try
+				{
+					f(count*t/numThreads, count*(t+1)/numThreads);
+				}
+				catch (...)
+				{
+					errors[t] = std::current_exception();
+				}
+			}));
+		for (std::vector<std::thread>::iterator it = threads.begin(); it!=threads.end(); it++)
+			it->join();
+		for (std::vector<std::exception_ptr>::iterator it = errors.begin(); it!=errors.end(); it++)
+			if (*it)
+				std::rethrow_exception(*it);
+	}
 };
 }
 #endif
@@ -29,190 +29,669 @@ THE SOFTWARE.
 #include "OgreProceduralExtruder.h"
 #include "OgreProceduralTriangulator.h"
 #include "OgreProceduralGeometryHelpers.h"
+#include <deque>
+#include <stdexcept>
 
 using namespace Ogre;
 
 namespace OgreProcedural
 {
 	//-----------------------------------------------------------------------
-	void Extruder::_extrudeBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude) const
+	Vector3 Extruder::_getFrameYAxis(const Vector3& z, bool first, const Vector3& previousY, const Vector3& previousZ, const Vector3& segment) const
 	{
-		assert(mExtrusionPath && shapeToExtrude && "Shape and Path must not be null!");
-		unsigned int numSegPath = mExtrusionPath->getSegCount();
-		unsigned int numSegShape = shapeToExtrude->getSegCount();
-		assert( numSegPath > 0 && numSegShape > 0 && "Shape and path must contain at least two points");
-
-		/*if (mFixSharpAngles)
-		mExtrusionPath->fixSharpAngles(shapeToExtrude->findBoundingRadius());*/
-		Real totalPathLength=0;
-		if ((mRotationTrack && mRotationTrack->getAddressingMode()==Track::AM_RELATIVE_LINEIC) ||
-			(mScaleTrack && mScaleTrack->getAddressingMode()==Track::AM_RELATIVE_LINEIC))
+		if (first || mFrameMode == FM_FIXED_UP)
 		{
-			totalPathLength = mExtrusionPath->getTotalLength();
+			Vector3 up = mUpVector.normalisedCopy();
+			Vector3 projectedUp = up - up.dotProduct(z) * z;
+			if (projectedUp.squaredLength() > 1e-6)
+				return projectedUp.normalisedCopy();
+			if (first)
+				return z.perpendicular();
+			// The path goes along the up vector : keep turning the previous section as little as possible
+			return (previousY - previousY.dotProduct(z) * z).normalisedCopy();
 		}
 
-		Ogre::Real lineicPos=0.;
-		Path path = *mExtrusionPath;
-		if (mRotationTrack)
-			path = path.mergeKeysWithTrack(*mRotationTrack);
-		if (mScaleTrack)
-			path = path.mergeKeysWithTrack(*mScaleTrack);
-		numSegPath = path.getSegCount();
-		// Estimate vertex and index count
-		buffer.rebaseOffset();
-		buffer.estimateIndexCount(numSegShape*numSegPath*6);
-		buffer.estimateVertexCount((numSegShape+1)*(numSegPath+1));
+		// Double reflection method : reflect the previous frame across the bisector plane of the segment,
+		// then across the plane which brings the reflected tangent onto the new one
+		Real c1 = segment.dotProduct(segment);
+		Vector3 yL = previousY;
+		Vector3 zL = previousZ;
+		if (c1 > 0)
+		{
+			yL -= (2. / c1) * segment.dotProduct(yL) * segment;
+			zL -= (2. / c1) * segment.dotProduct(zL) * segment;
+		}
+		Vector3 v2 = z - zL;
+		Real c2 = v2.dotProduct(v2);
+		if (c2 > 0)
+			yL -= (2. / c2) * v2.dotProduct(yL) * v2;
+		return (yL - yL.dotProduct(z) * z).normalisedCopy();
+	}
+	//-----------------------------------------------------------------------
+	Quaternion Extruder::_bankFrame(const Quaternion& frame, const Vector3& previousTangent, const Vector3& nextTangent, Real ds) const
+	{
+		if (mBanking == 0 || ds <= 0)
+			return frame;
+		Real lateralCurvature = (nextTangent - previousTangent).dotProduct(frame.xAxis()) / ds;
+		return frame * Quaternion(-Math::ATan(mBanking * lateralCurvature), Vector3::UNIT_Z);
+	}
+	//-----------------------------------------------------------------------
+	void Extruder::_computeFrames(const Path& path, std::vector<Quaternion>& frames) const
+	{
+		unsigned int numSegPath = path.getSegCount();
+		std::vector<Vector3> tangents(numSegPath+1);
+		for (unsigned int i = 0; i <= numSegPath; ++i)
+			tangents[i] = path.getAvgDirection(i);
 
+		// Frames are built from their axes : Z follows the path, Y is the up direction of the section, and X = Y x Z
+		frames.resize(numSegPath+1);
+		Vector3 y;
 		for (unsigned int i = 0; i <= numSegPath; ++i)
 		{
-			Vector3 v0 = path.getPoint(i);
-			Vector3 direction = path.getAvgDirection(i);
+			const Vector3& z = tangents[i];
+			if (i == 0)
+				y = _getFrameYAxis(z, true, Vector3::ZERO, Vector3::ZERO, Vector3::ZERO);
+			else
+				y = _getFrameYAxis(z, false, y, tangents[i-1], path.getPoint(i) - path.getPoint(i-1));
+			frames[i] = Quaternion(y.crossProduct(z), y, z);
+		}
+
+		// On a closed path, the last section has to meet the first one :
+		// the remaining twist is spread along the path, in proportion to the length
+		Real totalLength = path.getTotalLength();
+		if (mFrameMode == FM_ROTATION_MINIMIZING && path.isClosed() && totalLength > 0)
+		{
+			Vector3 yLast = frames[numSegPath].yAxis();
+			Vector3 yFirst = frames[0].yAxis();
+			Real twist = Math::ATan2(yLast.crossProduct(yFirst).dotProduct(tangents[0]), yLast.dotProduct(yFirst)).valueRadians();
+			for (unsigned int i = 1; i <= numSegPath; ++i)
+				frames[i] = frames[i] * Quaternion(Radian(twist * path.getLengthAtPoint(i) / totalLength), Vector3::UNIT_Z);
+		}
 
-			Quaternion q = Utils::_computeQuaternion(direction);
+		// Sections roll into the turns, according to the curvature across them
+		if (mBanking != 0)
+		{
+			for (unsigned int i = 0; i <= numSegPath; ++i)
+			{
+				unsigned int previous = i, next = i;
+				if (i > 0)
+					previous = i-1;
+				else if (path.isClosed())
+					previous = numSegPath-1;
+				if (i < numSegPath)
+					next = i+1;
+				else if (path.isClosed())
+					next = 1;
+				Real ds = path.getPoint(previous).distance(path.getPoint(i)) + path.getPoint(i).distance(path.getPoint(next));
+				frames[i] = _bankFrame(frames[i], tangents[previous], tangents[next], ds);
+			}
+		}
+	}
+	//-----------------------------------------------------------------------
+	void Extruder::_extrudeBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude, const ProfileTable& profile, const std::vector<Section>& sections,
+		unsigned int bodyFirstRing, unsigned int bodyLastRing, size_t firstVertex, size_t firstIndex, unsigned int firstRing, unsigned int lastRing) const
+	{
+		assert(shapeToExtrude && "Shape must not be null!");
+		unsigned int numSegShape = shapeToExtrude->getSegCount();
+		assert( sections.size() > 1 && numSegShape > 0 && "Shape and path must contain at least two points");
 
-			Real scale=1.;
+		/*if (mFixSharpAngles)
+		mExtrusionPath->fixSharpAngles(shapeToExtrude->findBoundingRadius());*/
+		bool outSideLeft = shapeToExtrude->getOutSide() == SIDE_LEFT;
+		int ringSize = numSegShape + 1;
 
-			if (i>0) lineicPos += (v0-path.getPoint(i-1)).length();
+		// Each ring is placed at once into these arrays, then written into the buffer
+		std::vector<Real> ring(6*ringSize);
+		Real* positions[3] = {&ring[0], &ring[ringSize], &ring[2*ringSize]};
+		Real* normals[3] = {&ring[3*ringSize], &ring[4*ringSize], &ring[5*ringSize]};
 
-			// Get the values of angle and scale
-			if (mRotationTrack)
-			{
-				Real angle;
-				angle = mRotationTrack->getValue(lineicPos, lineicPos / totalPathLength, i);
+		for (unsigned int i = firstRing; i < lastRing; ++i)
+		{
+			profile.placeRing(sections[i].position, sections[i].orientation, sections[i].scale, positions, normals);
+			Real u = sections[i].u;
+			size_t vertex = firstVertex + (i-bodyFirstRing)*ringSize;
+			size_t index = firstIndex + (i-bodyFirstRing)*numSegShape*6;
 
-				q = q*Quaternion((Radian)angle, Vector3::UNIT_Z);
-			}
-			if (mScaleTrack)
-			{
-				scale = mScaleTrack->getValue(lineicPos, lineicPos / totalPathLength, i);
-			}
 			// Insert new points
-			for (unsigned int j =0; j <= numSegShape; ++j)
+			for (unsigned int j =0; j <= numSegShape; ++j, ++vertex)
 			{
-				Vector2 vp2 = shapeToExtrude->getPoint(j);
-				// Vector2 vp2direction = shapeToExtrude->getAvgDirection(j);
-				Vector2 vp2normal = shapeToExtrude->getAvgNormal(j);
-				Vector3 vp(vp2.x, vp2.y, 0);
-				Vector3 normal(vp2normal.x, vp2normal.y, 0);
-				buffer.rebaseOffset();
-				Vector3 newPoint = v0+q*(scale*vp);
+				setPoint(buffer, vertex,
+					Vector3(positions[0][j], positions[1][j], positions[2][j]),
+					Vector3(normals[0][j], normals[1][j], normals[2][j]),
+					Vector2(u, profile.getV(j)));
 
-				addPoint(buffer, newPoint,
-					q*normal,
-					Vector2(i/(Real)numSegPath, j/(Real)numSegShape));
-
-				if (j <numSegShape && i <numSegPath)
+				if (j <numSegShape && i <bodyLastRing)
 				{
-					if (shapeToExtrude->getOutSide() == SIDE_LEFT)
+					int v = vertex;
+					if (outSideLeft)
 					{
-						buffer.triangle(numSegShape + 1, numSegShape + 2, 0);
-						buffer.triangle(0, numSegShape + 2, 1);
+						buffer.setIndex(index, v + ringSize).setIndex(index+1, v + ringSize + 1).setIndex(index+2, v);
+						buffer.setIndex(index+3, v).setIndex(index+4, v + ringSize + 1).setIndex(index+5, v + 1);
 					}
 					else
 					{
-						buffer.triangle(numSegShape + 2, numSegShape + 1, 0);
-						buffer.triangle(numSegShape + 2, 0, 1);
+						buffer.setIndex(index, v + ringSize + 1).setIndex(index+1, v + ringSize).setIndex(index+2, v);
+						buffer.setIndex(index+3, v + ringSize + 1).setIndex(index+4, v).setIndex(index+5, v + 1);
 					}
+					index += 6;
 				}
 			}
 		}
 	}
 	//-----------------------------------------------------------------------
-	void Extruder::_extrudeCapImpl(TriangleBuffer& buffer) const
+	/**
+	 * Receives the triangulation of the shape, and writes both caps at the same time.
+	 * When both caps go into the same buffer, point j of the shape becomes vertex 2j of the begin cap and vertex 2j+1 of the end cap,
+	 * otherwise it becomes vertex j of each cap. A cap whose buffer is null is left out.
+	 */
+	class Extruder::CapSink : public TriangulationSink
 	{
-		std::vector<int> indexBuffer;
-		PointList pointList;
+		const Extruder& mExtruder;
+		TriangleBuffer* mBufferBegin;
+		TriangleBuffer* mBufferEnd;
+		const Section* mCapBegin;
+		const Section* mCapEnd;
+		int mStride;
+	public:
+		CapSink(const Extruder& extruder, TriangleBuffer* bufferBegin, const Section* capBegin, TriangleBuffer* bufferEnd, const Section* capEnd) :
+			mExtruder(extruder), mBufferBegin(bufferBegin), mBufferEnd(bufferEnd), mCapBegin(capBegin), mCapEnd(capEnd),
+			mStride((bufferBegin == bufferEnd)?2:1) {}
 
-		buffer.rebaseOffset();
+		void begin(size_t numVertices, size_t numTriangles)
+		{
+			if (mBufferBegin)
+			{
+				mBufferBegin->estimateVertexCount(numVertices);
+				mBufferBegin->estimateIndexCount(3*numTriangles);
+			}
+			if (mBufferEnd)
+			{
+				mBufferEnd->estimateVertexCount(numVertices);
+				mBufferEnd->estimateIndexCount(3*numTriangles);
+			}
+		}
+
+		void vertex(const Vector2& position)
+		{
+			Vector3 vp(position.x, position.y, 0);
+			if (mBufferBegin)
+				mExtruder.addPoint(*mBufferBegin, mCapBegin->position+mCapBegin->orientation*(mCapBegin->scale*vp), mCapBegin->orientation*-Vector3::UNIT_Z, position);
+			if (mBufferEnd)
+				mExtruder.addPoint(*mBufferEnd, mCapEnd->position+mCapEnd->orientation*(mCapEnd->scale*vp), mCapEnd->orientation*Vector3::UNIT_Z, position);
+		}
+
+		void triangle(int i0, int i1, int i2)
+		{
+			// begin cap faces backwards
+			int endOffset = mStride-1;
+			if (mBufferBegin)
+			{
+				mBufferBegin->index(mStride*i0);
+				mBufferBegin->index(mStride*i2);
+				mBufferBegin->index(mStride*i1);
+			}
+			if (mBufferEnd)
+			{
+				mBufferEnd->index(mStride*i0+endOffset);
+				mBufferEnd->index(mStride*i1+endOffset);
+				mBufferEnd->index(mStride*i2+endOffset);
+			}
+		}
+	};
+	//-----------------------------------------------------------------------
+	void Extruder::_extrudeCapImpl(TriangleBuffer& bufferBegin, const Section& capBegin, TriangleBuffer& bufferEnd, const Section& capEnd) const
+	{
+		bufferBegin.rebaseOffset();
+		bufferEnd.rebaseOffset();
 
+		// Both caps are written while the triangulation is streamed
+		CapSink sink(*this, &bufferBegin, &capBegin, &bufferEnd, &capEnd);
 		Triangulator t;
+		t.setCache(mTriangulationCache);
 		if (mShapeToExtrude)
 			t.setShapeToTriangulate(mShapeToExtrude);
 		else
 			t.setMultiShapeToTriangulate(mMultiShapeToExtrude);
-		t.triangulate(indexBuffer, pointList);
-		buffer.estimateIndexCount(2*indexBuffer.size());
-		buffer.estimateVertexCount(2*pointList.size());
+		t.triangulate(sink);
+	}
+	//-----------------------------------------------------------------------
+	void Extruder::_computeSections(std::vector<Section>& sections, Section caps[2]) const
+	{
+		// Sections are placed on the keys of the tracks too
+		Path path = *mExtrusionPath;
+		if (mRotationTrack)
+			path = path.mergeKeysWithTrack(*mRotationTrack);
+		if (mScaleTrack)
+			path = path.mergeKeysWithTrack(*mScaleTrack);
 
+		// The frames are computed once, and shared by the caps and the shapes of the body
+		std::vector<Quaternion> frames;
+		_computeFrames(path, frames);
 
-		//begin cap
-		buffer.rebaseOffset();
-		Quaternion qBegin = Utils::_computeQuaternion(mExtrusionPath->getDirectionAfter(0));
+		// So are the values of the tracks, which are read in order
+		Real totalPathLength = mExtrusionPath->getTotalLength();
+		unsigned int numSegPath = frames.size()-1;
+		sections.resize(frames.size());
+		unsigned int rotationCursor = 0, scaleCursor = 0;
+		for (unsigned int i = 0; i < sections.size(); ++i)
+		{
+			Real lineicPos = path.getLengthAtPoint(i);
+			sections[i].position = path.getPoint(i);
+			sections[i].orientation = frames[i];
+			sections[i].scale = 1.;
+			sections[i].u = i/(Real)numSegPath;
+			if (mRotationTrack)
+			{
+				Real angle = mRotationTrack->getValue(lineicPos, lineicPos / totalPathLength, i, rotationCursor);
+				sections[i].orientation = frames[i]*Quaternion((Radian)angle, Vector3::UNIT_Z);
+			}
+			if (mScaleTrack)
+				sections[i].scale = mScaleTrack->getValue(lineicPos, lineicPos / totalPathLength, i, scaleCursor);
+		}
+
+		// The caps take the first and last values of the tracks
+		caps[0].position = mExtrusionPath->getPoint(0);
+		caps[0].orientation = frames.front();
+		caps[0].scale = 1.;
+		caps[0].u = 0.;
+		caps[1].position = mExtrusionPath->getPoint(mExtrusionPath->getSegCount());
+		caps[1].orientation = frames.back();
+		caps[1].scale = 1.;
+		caps[1].u = 1.;
 		if (mRotationTrack)
 		{
-			Real angle = mRotationTrack->getFirstValue();
-			qBegin = qBegin*Quaternion((Radian)angle, Vector3::UNIT_Z);
+			caps[0].orientation = caps[0].orientation*Quaternion((Radian)mRotationTrack->getFirstValue(), Vector3::UNIT_Z);
+			caps[1].orientation = caps[1].orientation*Quaternion((Radian)mRotationTrack->getLastValue(), Vector3::UNIT_Z);
 		}
-		Real scaleBegin=1.;
 		if (mScaleTrack)
-			scaleBegin = mScaleTrack->getFirstValue();
-		for (size_t j =0;j<pointList.size();j++)
 		{
-			Vector2 vp2 = pointList[j];
-			Vector3 vp(vp2.x, vp2.y, 0);
-			Vector3 normal = -Vector3::UNIT_Z;
+			caps[0].scale = mScaleTrack->getFirstValue();
+			caps[1].scale = mScaleTrack->getLastValue();
+		}
+	}
+	//-----------------------------------------------------------------------
+	void Extruder::_getShapes(std::vector<const Shape*>& shapes) const
+	{
+		shapes.clear();
+		if (mShapeToExtrude)
+			shapes.push_back(mShapeToExtrude);
+		else
+			for (int i=0; i<mMultiShapeToExtrude->getShapeCount();i++)
+				shapes.push_back(&mMultiShapeToExtrude->getShape(i));
+	}
+	//-----------------------------------------------------------------------
+	void Extruder::addToTriangleBuffer(TriangleBuffer& buffer) const
+	{
+		assert((mShapeToExtrude || mMultiShapeToExtrude) && "Either shape or multishape must be defined!");
+		assert(mExtrusionPath && "Path must not be null!");
+
+		std::vector<Section> sections;
+		Section caps[2];
+		_computeSections(sections, caps);
+
+		// Triangulate the begin and end caps
+
+		if (!mExtrusionPath->isClosed() && mCapped)
+			_extrudeCapImpl(buffer, caps[0], buffer, caps[1]);
+
+		std::vector<const Shape*> shapes;
+		std::vector<ProfileTable> profiles;
+		_readProfiles(shapes, profiles);
+		_extrudeBody(buffer, shapes, profiles, sections, 0, sections.size()-1, mNumThreads);
+	}
+	//-----------------------------------------------------------------------
+	void Extruder::_readProfiles(std::vector<const Shape*>& shapes, std::vector<ProfileTable>& profiles) const
+	{
+		_getShapes(shapes);
+		// The points and normals of each shape are read once, and shared by all the rings
+		profiles.clear();
+		profiles.reserve(shapes.size());
+		for (size_t s=0; s<shapes.size(); s++)
+			profiles.push_back(ProfileTable(*shapes[s]));
+	}
+	//-----------------------------------------------------------------------
+	void Extruder::_extrudeBody(TriangleBuffer& buffer, const std::vector<const Shape*>& shapes, const std::vector<ProfileTable>& profiles,
+		const std::vector<Section>& sections, unsigned int bodyFirstRing, unsigned int bodyLastRing, unsigned int numThreads) const
+	{
+		// Each shape gets its vertices and indices up front, so that any thread can write any ring of any shape
+		size_t numRings = bodyLastRing-bodyFirstRing+1;
+		std::vector<size_t> firstVertices(shapes.size()+1), firstIndices(shapes.size()+1);
+		firstVertices[0] = buffer.getVertexCount();
+		firstIndices[0] = buffer.getIndexCount();
+		for (size_t s=0; s<shapes.size(); s++)
+		{
+			size_t numSegShape = shapes[s]->getSegCount();
+			firstVertices[s+1] = firstVertices[s] + (numSegShape+1)*numRings;
+			firstIndices[s+1] = firstIndices[s] + numSegShape*(numRings-1)*6;
+		}
+		size_t numVertices = firstVertices.back()-firstVertices[0];
+		buffer.extend(numVertices, firstIndices.back()-firstIndices[0]);
 
-			Vector3 newPoint = mExtrusionPath->getPoint(0)+qBegin*(scaleBegin*vp);
-			addPoint(buffer, newPoint,
-				qBegin*normal,
-				vp2);
+		// Threads share the rings of all the shapes, one after the other
+		size_t numShapeRings = shapes.size()*numRings;
+		size_t minRingsPerThread = 8192*numShapeRings/std::max<size_t>(numVertices, 1)+1;
+		Utils::_parallelFor(numShapeRings, numThreads, minRingsPerThread, [&](size_t first, size_t last)
+		{
+			for (size_t s=first/numRings; s*numRings<last; s++)
+			{
+				size_t firstRing = std::max(first, s*numRings) - s*numRings;
+				size_t lastRing = std::min(last, (s+1)*numRings) - s*numRings;
+				_extrudeBodyImpl(buffer, shapes[s], profiles[s], sections, bodyFirstRing, bodyLastRing, firstVertices[s], firstIndices[s],
+					bodyFirstRing+firstRing, bodyFirstRing+lastRing);
+			}
+		});
+	}
+	//-----------------------------------------------------------------------
+	void Extruder::addChunksToTriangleBuffers(std::vector<TriangleBuffer>& buffers) const
+	{
+		assert((mShapeToExtrude || mMultiShapeToExtrude) && "Either shape or multishape must be defined!");
+		assert(mExtrusionPath && "Path must not be null!");
+
+		std::vector<Section> sections;
+		Section caps[2];
+		_computeSections(sections, caps);
+
+		// A chunk ends as soon as it reaches its length or its number of segments.
+		// Chunk c goes from ring chunkRings[c] to ring chunkRings[c+1], which is also the first ring of the next chunk.
+		unsigned int numSegPath = sections.size()-1;
+		std::vector<unsigned int> chunkRings(1, 0);
+		Real length = 0, chunkStartLength = 0;
+		for (unsigned int i = 1; i < numSegPath; ++i)
+		{
+			length += sections[i].position.distance(sections[i-1].position);
+			if ((mChunkSegCount > 0 && i-chunkRings.back() >= mChunkSegCount) || (mChunkLength > 0 && length-chunkStartLength >= mChunkLength))
+			{
+				chunkRings.push_back(i);
+				chunkStartLength = length;
+			}
 		}
+		chunkRings.push_back(numSegPath);
+		size_t numChunks = chunkRings.size()-1;
+		size_t firstChunk = buffers.size();
+		buffers.resize(firstChunk+numChunks);
+
+		// The begin cap goes into the first chunk, and the end cap into the last one
+		if (!mExtrusionPath->isClosed() && mCapped)
+			_extrudeCapImpl(buffers[firstChunk], caps[0], buffers.back(), caps[1]);
+
+		std::vector<const Shape*> shapes;
+		std::vector<ProfileTable> profiles;
+		_readProfiles(shapes, profiles);
+		size_t ringVertexCount = 0;
+		for (size_t s=0; s<shapes.size(); s++)
+			ringVertexCount += shapes[s]->getSegCount()+1;
 
-		for (size_t i=0;i<indexBuffer.size()/3;i++)
+		// Each chunk is built by a single thread, into its own buffer
+		size_t minChunksPerThread = 8192*numChunks/std::max<size_t>(ringVertexCount*sections.size(), 1)+1;
+		Utils::_parallelFor(numChunks, mNumThreads, minChunksPerThread, [&](size_t first, size_t last)
+		{
+			for (size_t c=first; c<last; c++)
+				_extrudeBody(buffers[firstChunk+c], shapes, profiles, sections, chunkRings[c], chunkRings[c+1], 1);
+		});
+	}
+	//-----------------------------------------------------------------------
+	std::vector<MeshPtr> Extruder::realizeChunkMeshes(const std::string& name, const String& group) const
+	{
+		std::vector<TriangleBuffer> buffers;
+		addChunksToTriangleBuffers(buffers);
+		std::vector<MeshPtr> meshes;
+		for (size_t c=0; c<buffers.size(); c++)
+		{
+			if (name == "")
+				meshes.push_back(buffers[c].transformToMesh(Utils::getName(), group));
+			else
+				meshes.push_back(buffers[c].transformToMesh(name + "_" + StringConverter::toString(c), group));
+		}
+		return meshes;
+	}
+	//-----------------------------------------------------------------------
+	/**
+	 * Inserts the keys of a track among the points of a streamed path, as Path::mergeKeysWithTrack() does.
+	 * Points go straight through if there is no track, or if its keys don't make points.
+	 */
+	class TrackKeyMerger : public PathSource
+	{
+		PathSource& mSource;
+		const Track* mTrack;
+		size_t mKey;
+		bool mStarted;
+		bool mInSegment;
+		Vector3 mSegmentStart;
+		Vector3 mSegmentEnd;
+		Real mSegmentStartLength;
+		Real mSegmentEndLength;
+	public:
+		TrackKeyMerger(PathSource& source, const Track* track) : mSource(source), mTrack(track), mKey(0), mStarted(false), mInSegment(false),
+			mSegmentStartLength(0.), mSegmentEndLength(0.)
 		{
-			buffer.index(indexBuffer[i*3]);
-			buffer.index(indexBuffer[i*3+2]);
-			buffer.index(indexBuffer[i*3+1]);
+			if (mTrack && (!mTrack->isInsertPoint() || mTrack->getAddressingMode() == Track::AM_POINT))
+				mTrack = 0;
 		}
 
-		// end cap
-		buffer.rebaseOffset();
-		Quaternion qEnd = Utils::_computeQuaternion(mExtrusionPath->getDirectionBefore(mExtrusionPath->getSegCount()));
-		if (mRotationTrack)
+		bool nextPoint(Vector3& point)
 		{
-			Real angle = mRotationTrack->getLastValue();
-			qEnd = qEnd*Quaternion((Radian)angle, Vector3::UNIT_Z);
+			if (!mTrack)
+				return mSource.nextPoint(point);
+
+			// The keys inside the current segment come before its end
+			if (mInSegment)
+			{
+				if (mKey < mTrack->getKeyCount() && mTrack->getKey(mKey) < mSegmentEndLength)
+				{
+					Real t = (mTrack->getKey(mKey)-mSegmentStartLength)/(mSegmentEndLength-mSegmentStartLength);
+					point = mSegmentStart + t*(mSegmentEnd-mSegmentStart);
+					mKey++;
+					return true;
+				}
+				mInSegment = false;
+				point = mSegmentEnd;
+				return true;
+			}
+
+			Vector3 next;
+			if (!mSource.nextPoint(next))
+				return false;
+			if (!mStarted)
+			{
+				mStarted = true;
+				mSegmentEnd = point = next;
+				return true;
+			}
+			mSegmentStart = mSegmentEnd;
+			mSegmentStartLength = mSegmentEndLength;
+			mSegmentEnd = next;
+			mSegmentEndLength = mSegmentStartLength+(next-mSegmentStart).length();
+			while (mKey < mTrack->getKeyCount() && mTrack->getKey(mKey) <= mSegmentStartLength)
+				mKey++;
+			mInSegment = true;
+			return nextPoint(point);
+		}
+	};
+	//-----------------------------------------------------------------------
+	/// Keeps the points of a streamed path around the current one, with their lineic positions and their directions
+	class PathWindow
+	{
+		struct WindowPoint
+		{
+			Vector3 position;
+			Real length;
+			Vector3 direction;
+			bool hasDirection;
+		};
+		PathSource& mSource;
+		std::deque<WindowPoint> mPoints;
+		size_t mFirstIndex;
+		bool mEnded;
+	public:
+		PathWindow(PathSource& source) : mSource(source), mFirstIndex(0), mEnded(false) {}
+
+		/// Reads the path up to point i, and tells whether the path has that point
+		bool hasPoint(size_t i)
+		{
+			while (!mEnded && mFirstIndex+mPoints.size() <= i)
+			{
+				WindowPoint point;
+				if (!mSource.nextPoint(point.position))
+				{
+					mEnded = true;
+					break;
+				}
+				point.length = mPoints.empty()?0.f:mPoints.back().length+(point.position-mPoints.back().position).length();
+				point.hasDirection = false;
+				mPoints.push_back(point);
+			}
+			return i < mFirstIndex+mPoints.size();
 		}
-		Real scaleEnd=1.;
-		if (mScaleTrack)
-			scaleEnd = mScaleTrack->getLastValue();
 
-		for (size_t j =0;j<pointList.size();j++)
+		const Vector3& getPoint(size_t i) const
 		{
-			Vector2 vp2 = pointList[j];
-			Vector3 vp(vp2.x, vp2.y, 0);
-			Vector3 normal = Vector3::UNIT_Z;
+			return mPoints[i-mFirstIndex].position;
+		}
 
-			Vector3 newPoint = mExtrusionPath->getPoint(mExtrusionPath->getSegCount())+qEnd*(scaleEnd*vp);
-			addPoint(buffer, newPoint,
-				qEnd*normal,
-				vp2);
+		Real getLengthAtPoint(size_t i) const
+		{
+			return mPoints[i-mFirstIndex].length;
 		}
 
-		for (size_t i=0;i<indexBuffer.size()/3;i++)
+		/// Same as Path::getAvgDirection() on an open path : the next point is read if needed
+		const Vector3& getAvgDirection(size_t i)
 		{
-			buffer.index(indexBuffer[i*3]);
-			buffer.index(indexBuffer[i*3+1]);
-			buffer.index(indexBuffer[i*3+2]);
+			WindowPoint& point = mPoints[i-mFirstIndex];
+			if (!point.hasDirection)
+			{
+				Vector3 after = hasPoint(i+1)?(getPoint(i+1)-point.position).normalisedCopy():(point.position-getPoint(i-1)).normalisedCopy();
+				Vector3 before = (i>0)?(point.position-getPoint(i-1)).normalisedCopy():Vector3::ZERO;
+				point.direction = (after+before).normalisedCopy();
+				point.hasDirection = true;
+			}
+			return point.direction;
 		}
 
-	}
+		/// Forgets the points before point i
+		void dropPointsBefore(size_t i)
+		{
+			for (; mFirstIndex < i; mFirstIndex++)
+				mPoints.pop_front();
+		}
+	};
 	//-----------------------------------------------------------------------
-	void Extruder::addToTriangleBuffer(TriangleBuffer& buffer) const
+	size_t Extruder::streamChunks(PathSource& source, ExtrusionChunkSink& sink) const
 	{
 		assert((mShapeToExtrude || mMultiShapeToExtrude) && "Either shape or multishape must be defined!");
+		// The length of the path is only known at its end, too late to place relative lineic keys
+		if ((mRotationTrack && mRotationTrack->getAddressingMode() == Track::AM_RELATIVE_LINEIC)
+			|| (mScaleTrack && mScaleTrack->getAddressingMode() == Track::AM_RELATIVE_LINEIC))
+			throw std::runtime_error("Relative lineic tracks can't be streamed");
 
-		// Triangulate the begin and end caps
+		// Sections are placed on the keys of the tracks too, which are inserted while the points are read
+		TrackKeyMerger rotationKeys(source, mRotationTrack);
+		TrackKeyMerger scaleKeys(rotationKeys, mScaleTrack);
+		PathWindow path(scaleKeys);
+		if (!path.hasPoint(1))
+			return 0;
 
-		if (!mExtrusionPath->isClosed() && mCapped)
-			_extrudeCapImpl(buffer);
+		std::vector<const Shape*> shapes;
+		std::vector<ProfileTable> profiles;
+		_readProfiles(shapes, profiles);
 
-		if (mShapeToExtrude)
-			_extrudeBodyImpl(buffer, mShapeToExtrude);
-		else
+		// The caps are triangulated once, and placed when the first and the last chunks are built
+		std::vector<int> capTriangles;
+		PointList capPoints;
+		if (mCapped)
 		{
-			for (int i=0; i<mMultiShapeToExtrude->getShapeCount();i++)
-				_extrudeBodyImpl(buffer, &mMultiShapeToExtrude->getShape(i));
+			Triangulator t;
+			t.setCache(mTriangulationCache);
+			if (mShapeToExtrude)
+				t.setShapeToTriangulate(mShapeToExtrude);
+			else
+				t.setMultiShapeToTriangulate(mMultiShapeToExtrude);
+			t.triangulate(capTriangles, capPoints);
+		}
+
+		std::vector<Section> sections;
+		Section caps[2];
+		size_t numChunks = 0;
+		// Builds a chunk from the sections gathered so far, with the caps it holds, and hands it over
+		auto buildChunk = [&](bool lastChunk)
+		{
+			TriangleBuffer buffer;
+			const Section* capBegin = (mCapped && numChunks == 0)?&caps[0]:0;
+			const Section* capEnd = (mCapped && lastChunk)?&caps[1]:0;
+			if (capBegin || capEnd)
+			{
+				CapSink capSink(*this, capBegin?&buffer:0, capBegin, capEnd?&buffer:0, capEnd);
+				capSink.begin(capPoints.size(), capTriangles.size()/3);
+				for (size_t j=0; j<capPoints.size(); j++)
+					capSink.vertex(capPoints[j]);
+				for (size_t j=0; j+2<capTriangles.size(); j+=3)
+					capSink.triangle(capTriangles[j], capTriangles[j+1], capTriangles[j+2]);
+			}
+			_extrudeBody(buffer, shapes, profiles, sections, 0, sections.size()-1, mNumThreads);
+			sink.chunk(buffer, numChunks++);
+		};
+
+		// Each section is placed as soon as the points it depends on have been read,
+		// and the chunks are cut at the same sections as in addChunksToTriangleBuffers()
+		Vector3 y;
+		Real length = 0, chunkStartLength = 0;
+		size_t chunkFirstRing = 0;
+		unsigned int rotationCursor = 0, scaleCursor = 0;
+		for (size_t i = 0; path.hasPoint(i); ++i)
+		{
+			const Vector3& z = path.getAvgDirection(i);
+			if (i == 0)
+				y = _getFrameYAxis(z, true, Vector3::ZERO, Vector3::ZERO, Vector3::ZERO);
+			else
+				y = _getFrameYAxis(z, false, y, path.getAvgDirection(i-1), path.getPoint(i) - path.getPoint(i-1));
+			Quaternion frame(y.crossProduct(z), y, z);
+			bool lastPoint = !path.hasPoint(i+1);
+			if (mBanking != 0)
+			{
+				size_t previous = (i > 0)?i-1:i;
+				size_t next = lastPoint?i:i+1;
+				Real ds = path.getPoint(previous).distance(path.getPoint(i)) + path.getPoint(i).distance(path.getPoint(next));
+				frame = _bankFrame(frame, path.getAvgDirection(previous), path.getAvgDirection(next), ds);
+			}
+
+			Section section;
+			Real lineicPos = path.getLengthAtPoint(i);
+			section.position = path.getPoint(i);
+			section.orientation = frame;
+			section.scale = 1.;
+			section.u = lineicPos;
+			if (mRotationTrack)
+				section.orientation = frame*Quaternion((Radian)mRotationTrack->getValue(lineicPos, 0., i, rotationCursor), Vector3::UNIT_Z);
+			if (mScaleTrack)
+				section.scale = mScaleTrack->getValue(lineicPos, 0., i, scaleCursor);
+
+			// The caps take the first and last values of the tracks
+			if (i == 0 || lastPoint)
+			{
+				Section& cap = caps[lastPoint?1:0];
+				cap = section;
+				cap.orientation = frame;
+				cap.scale = 1.;
+				if (mRotationTrack)
+					cap.orientation = frame*Quaternion((Radian)(lastPoint?mRotationTrack->getLastValue():mRotationTrack->getFirstValue()), Vector3::UNIT_Z);
+				if (mScaleTrack)
+					cap.scale = lastPoint?mScaleTrack->getLastValue():mScaleTrack->getFirstValue();
+			}
+			sections.push_back(section);
+
+			if (i > 0)
+				length += sections.back().position.distance(sections[sections.size()-2].position);
+			if (lastPoint)
+				buildChunk(true);
+			else if (i > 0 && ((mChunkSegCount > 0 && i-chunkFirstRing >= mChunkSegCount) || (mChunkLength > 0 && length-chunkStartLength >= mChunkLength)))
+			{
+				// The last section of the chunk is also the first one of the next chunk
+				buildChunk(false);
+				sections.erase(sections.begin(), sections.end()-1);
+				chunkFirstRing = i;
+				chunkStartLength = length;
+			}
+			path.dropPointsBefore(i);
 		}
+		return numChunks;
 	}
 }
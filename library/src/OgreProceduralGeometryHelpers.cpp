@@ -147,5 +147,200 @@ Vector3 Line::shortestPathToPoint(const Vector3& point) const
 	Vector3 vec = -projection+point-mPoint;
 	return vec;
 }
+//-----------------------------------------------------------------------
+/// Tells on which side of the oriented line (a,b) point c stands
+static inline double _orient(const Vector2& a, const Vector2& b, const Vector2& c)
+{
+	return ((double)b.x-a.x)*((double)c.y-a.y)-((double)b.y-a.y)*((double)c.x-a.x);
+}
+//-----------------------------------------------------------------------
+/// Tells whether c, which is on the line (a,b), is on the segment [a,b]
+static inline bool _isInSegmentBox(const Vector2& a, const Vector2& b, const Vector2& c)
+{
+	return std::min(a.x, b.x)<=c.x && c.x<=std::max(a.x, b.x) && std::min(a.y, b.y)<=c.y && c.y<=std::max(a.y, b.y);
+}
+//-----------------------------------------------------------------------
+void SimplificationIndex::addPolyline(const std::vector<Vector2>& points, bool closed)
+{
+	int first = (int)mPoints.size();
+	int numPoints = (int)points.size();
+	mPolylineStarts.push_back(first);
+	mPoints.insert(mPoints.end(), points.begin(), points.end());
+	for (int i=0;i<numPoints;i++)
+	{
+		if (i>0)
+			mPrevious.push_back(first+i-1);
+		else
+			mPrevious.push_back((closed && numPoints>1)?first+numPoints-1:-1);
+		if (i<numPoints-1)
+			mNext.push_back(first+i+1);
+		else
+			mNext.push_back((closed && numPoints>1)?first:-1);
+	}
+}
+//-----------------------------------------------------------------------
+/// Compares points along one axis, to split the nodes of the tree
+struct PointAxisLess
+{
+	const std::vector<Vector2>& mPoints;
+	int mAxis;
+	PointAxisLess(const std::vector<Vector2>& points, int axis) : mPoints(points), mAxis(axis) {}
+	bool operator()(int a, int b) const
+	{
+		return mPoints[a][mAxis]<mPoints[b][mAxis];
+	}
+};
+//-----------------------------------------------------------------------
+/// Nodes with that many points or fewer aren't split
+static const int SIMPLIFICATION_LEAF_SIZE = 8;
+//-----------------------------------------------------------------------
+void SimplificationIndex::_buildNode(int node, int first, int last)
+{
+	if (node>=(int)mNodes.size())
+		mNodes.resize(node+1);
+	Node& n = mNodes[node];
+	n.min = n.max = mPoints[mOrder[first]];
+	for (int k=first+1;k<last;k++)
+	{
+		n.min.makeFloor(mPoints[mOrder[k]]);
+		n.max.makeCeil(mPoints[mOrder[k]]);
+	}
+	n.count = last-first;
+	if (last-first<=SIMPLIFICATION_LEAF_SIZE)
+		return;
+	// Splits the points in halves along the longest side of the box
+	int axis = (n.max.x-n.min.x>=n.max.y-n.min.y)?0:1;
+	int middle = (first+last)/2;
+	std::nth_element(mOrder.begin()+first, mOrder.begin()+middle, mOrder.begin()+last, PointAxisLess(mPoints, axis));
+	_buildNode(2*node+1, first, middle);
+	_buildNode(2*node+2, middle, last);
+}
+//-----------------------------------------------------------------------
+void SimplificationIndex::build()
+{
+	int numPoints = (int)mPoints.size();
+	mLeft.assign(numPoints, true);
+	mNodes.clear();
+	mOrder.resize(numPoints);
+	for (int i=0;i<numPoints;i++)
+		mOrder[i] = i;
+	if (numPoints>0)
+		_buildNode(0, 0, numPoints);
+	mPositions.resize(numPoints);
+	for (int k=0;k<numPoints;k++)
+		mPositions[mOrder[k]] = k;
+}
+//-----------------------------------------------------------------------
+bool SimplificationIndex::_hasPointInTriangle(int p, int i, int n)
+{
+	const Vector2& P = mPoints[p];
+	const Vector2& I = mPoints[i];
+	const Vector2& N = mPoints[n];
+	Vector2 triangleMin(std::min(std::min(P.x, I.x), N.x), std::min(std::min(P.y, I.y), N.y));
+	Vector2 triangleMax(std::max(std::max(P.x, I.x), N.x), std::max(std::max(P.y, I.y), N.y));
+	// Points on the sides count as inside, so do the points of a flat triangle's segment
+	double area = _orient(P, I, N);
+	double side = (area<0)?-1.:1.;
+	const Vector2* edges[3][2] = {{&P, &I}, {&I, &N}, {&N, &P}};
 
+	// Nodes are pushed with the range of points they cover
+	mStack.clear();
+	mStack.push_back(0);
+	mStack.push_back(0);
+	mStack.push_back((int)mPoints.size());
+	while (!mStack.empty())
+	{
+		int last = mStack.back(); mStack.pop_back();
+		int first = mStack.back(); mStack.pop_back();
+		int node = mStack.back(); mStack.pop_back();
+		const Node& box = mNodes[node];
+		if (box.count==0 || box.max.x<triangleMin.x || box.min.x>triangleMax.x || box.max.y<triangleMin.y || box.min.y>triangleMax.y)
+			continue;
+		// Boxes which are all outside of one side of the triangle are skipped
+		bool outside = false;
+		for (int e=0;e<3 && !outside && area!=0;e++)
+		{
+			const Vector2& a = *edges[e][0];
+			const Vector2& b = *edges[e][1];
+			outside = side*_orient(a, b, box.min)<0 && side*_orient(a, b, box.max)<0
+				&& side*_orient(a, b, Vector2(box.min.x, box.max.y))<0 && side*_orient(a, b, Vector2(box.max.x, box.min.y))<0;
+		}
+		if (outside)
+			continue;
+		if (last-first>SIMPLIFICATION_LEAF_SIZE)
+		{
+			int middle = (first+last)/2;
+			int children[6] = {2*node+1, first, middle, 2*node+2, middle, last};
+			mStack.insert(mStack.end(), children, children+6);
+			continue;
+		}
+		for (int k=first;k<last;k++)
+		{
+			int q = mOrder[k];
+			if (!mLeft[q] || q==p || q==i || q==n)
+				continue;
+			const Vector2& Q = mPoints[q];
+			if (Q.x<triangleMin.x || Q.x>triangleMax.x || Q.y<triangleMin.y || Q.y>triangleMax.y)
+				continue;
+			double o1 = side*_orient(P, I, Q);
+			double o2 = side*_orient(I, N, Q);
+			double o3 = side*_orient(N, P, Q);
+			if (area!=0?(o1>=0 && o2>=0 && o3>=0):(o1==0 && o2==0 && o3==0))
+				return true;
+		}
+	}
+	return false;
+}
+//-----------------------------------------------------------------------
+bool SimplificationIndex::canRemove(int polyline, int p, int i, int n)
+{
+	int start = mPolylineStarts[polyline];
+	p += start;
+	i += start;
+	n += start;
+	const Vector2& P = mPoints[p];
+	const Vector2& N = mPoints[n];
+
+	// The segments before and after the new one mustn't fold back onto it
+	int before = mPrevious[p];
+	if (before!=-1 && before!=n && _orient(P, N, mPoints[before])==0 && _isInSegmentBox(mPoints[before], P, N))
+		return false;
+	int after = mNext[n];
+	if (after!=-1 && after!=p && _orient(P, N, mPoints[after])==0 && _isInSegmentBox(N, mPoints[after], P))
+		return false;
+
+	return !_hasPointInTriangle(p, i, n);
+}
+//-----------------------------------------------------------------------
+void SimplificationIndex::remove(int polyline, int p, int i, int n)
+{
+	int start = mPolylineStarts[polyline];
+	p += start;
+	i += start;
+	n += start;
+	mNext[p] = n;
+	mPrevious[n] = p;
+	mLeft[i] = false;
+
+	// The point is no longer counted by the nodes on the way down to it
+	int position = mPositions[i];
+	int node = 0, first = 0, last = (int)mPoints.size();
+	while (true)
+	{
+		mNodes[node].count--;
+		if (last-first<=SIMPLIFICATION_LEAF_SIZE)
+			break;
+		int middle = (first+last)/2;
+		if (position<middle)
+		{
+			node = 2*node+1;
+			last = middle;
+		}
+		else
+		{
+			node = 2*node+2;
+			first = middle;
+		}
+	}
+}
 }
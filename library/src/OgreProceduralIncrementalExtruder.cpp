@@ -0,0 +1,492 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#include "OgreProceduralStableHeaders.h"
+#include "OgreProceduralIncrementalExtruder.h"
+#include "OgreProceduralTriangulator.h"
+#include <stdexcept>
+
+using namespace Ogre;
+
+namespace OgreProcedural
+{
+//-----------------------------------------------------------------------
+bool IncrementalExtruder::_isSameSection(const Extruder::Section& a, const Extruder::Section& b)
+{
+	return a.position==b.position && a.orientation==b.orientation && a.scale==b.scale;
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_readShapes()
+{
+	assert((mExtruder.mShapeToExtrude || mExtruder.mMultiShapeToExtrude) && "Either shape or multishape must be defined!");
+	std::vector<const Shape*> shapes;
+	mExtruder._getShapes(shapes);
+	mProfiles.clear();
+	mShapeSegCounts.clear();
+	mShapeOutSidesLeft.clear();
+	mRingVertexCount = mRingIndexCount = 0;
+	for (size_t s=0; s<shapes.size(); s++)
+	{
+		unsigned int numSegShape = shapes[s]->getSegCount();
+		mProfiles.push_back(ProfileTable(*shapes[s]));
+		mShapeSegCounts.push_back(numSegShape);
+		mShapeOutSidesLeft.push_back(shapes[s]->getOutSide() == SIDE_LEFT);
+		mRingVertexCount += numSegShape+1;
+		mRingIndexCount += numSegShape*6;
+	}
+	if (mRingVertexCount == 0)
+		throw std::runtime_error("The shapes to extrude have no points");
+
+	// The caps are triangulated once, then only placed at both ends of the path
+	mHasCaps = !mExtruder.mExtrusionPath->isClosed() && mExtruder.mCapped;
+	mCapPoints.clear();
+	mCapTriangles.clear();
+	if (mHasCaps)
+	{
+		Triangulator t;
+		t.setCache(mExtruder.mTriangulationCache);
+		if (mExtruder.mShapeToExtrude)
+			t.setShapeToTriangulate(mExtruder.mShapeToExtrude);
+		else
+			t.setMultiShapeToTriangulate(mExtruder.mMultiShapeToExtrude);
+		t.triangulate(mCapTriangles, mCapPoints);
+	}
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_placeSections()
+{
+	mChangedSections.clear();
+	const Path& path = *mExtruder.mExtrusionPath;
+
+	// With tracks, or on a closed path, sections depend on the whole path : they are all placed again, then compared
+	if (path.isClosed() || mExtruder.mRotationTrack || mExtruder.mScaleTrack)
+	{
+		std::vector<Extruder::Section> previousSections;
+		previousSections.swap(mSections);
+		mExtruder._computeSections(mSections, mCaps);
+		for (size_t i=0; i<mSections.size(); i++)
+			if (i >= previousSections.size() || !_isSameSection(mSections[i], previousSections[i]))
+				mChangedSections.push_back(i);
+		mPlacedSectionCount = mSections.size();
+		mPathPoints.clear();
+		mYAxes.clear();
+		return;
+	}
+
+	// Otherwise, the points which moved are found by comparing the path with its previous points
+	mPlacedSectionCount = 0;
+	if (mExtruder.mFrameMode != mFrameMode || mExtruder.mUpVector != mUpVector || mExtruder.mBanking != mBanking)
+	{
+		mPathPoints.clear();
+		mYAxes.clear();
+		mFrameMode = mExtruder.mFrameMode;
+		mUpVector = mExtruder.mUpVector;
+		mBanking = mExtruder.mBanking;
+	}
+	size_t numPoints = path.getSegCount()+1;
+	size_t numPreviousPoints = mPathPoints.size();
+	size_t firstPoint = 0;
+	while (firstPoint < std::min(numPoints, numPreviousPoints) && path.getPoint(firstPoint) == mPathPoints[firstPoint])
+		firstPoint++;
+	size_t lastPoint = numPoints;
+	if (numPoints == numPreviousPoints)
+	{
+		while (lastPoint > firstPoint && path.getPoint(lastPoint-1) == mPathPoints[lastPoint-1])
+			lastPoint--;
+		if (firstPoint == lastPoint)
+			return;
+	}
+	mPathPoints.resize(numPoints);
+	for (size_t i=firstPoint; i<lastPoint; i++)
+		mPathPoints[i] = path.getPoint(i);
+
+	// The direction of the path at a point depends on the points on both sides, and the frame goes on from the previous one.
+	// After the last point which moved, frames are placed again until they find their previous values,
+	// which they never do with FM_ROTATION_MINIMIZING.
+	size_t numPreviousFrames = mYAxes.size();
+	mYAxes.resize(numPoints);
+	size_t firstFrame = (firstPoint > 0)?firstPoint-1:0;
+	size_t lastFrame = firstFrame;
+	Vector3 previousZ = (firstFrame > 0)?path.getAvgDirection(firstFrame-1):Vector3::ZERO;
+	for (; lastFrame < numPoints; lastFrame++)
+	{
+		Vector3 z = path.getAvgDirection(lastFrame);
+		Vector3 y;
+		if (lastFrame == 0)
+			y = mExtruder._getFrameYAxis(z, true, Vector3::ZERO, Vector3::ZERO, Vector3::ZERO);
+		else
+			y = mExtruder._getFrameYAxis(z, false, mYAxes[lastFrame-1], previousZ, path.getPoint(lastFrame) - path.getPoint(lastFrame-1));
+		if (lastFrame > lastPoint && lastFrame < numPreviousFrames && y == mYAxes[lastFrame])
+			break;
+		mYAxes[lastFrame] = y;
+		previousZ = z;
+	}
+
+	// Banking looks at the directions of the path at the points around each section
+	size_t numPreviousSections = mSections.size();
+	mSections.resize(numPoints);
+	size_t firstSection = (firstFrame > 0)?firstFrame-1:0;
+	size_t lastSection = std::min(lastFrame+1, numPoints);
+	Real numSegPath = (Real)(numPoints-1);
+	for (size_t i=firstSection; i<lastSection; i++)
+	{
+		Extruder::Section section;
+		Vector3 z = path.getAvgDirection(i);
+		section.position = path.getPoint(i);
+		section.orientation = Quaternion(mYAxes[i].crossProduct(z), mYAxes[i], z);
+		if (mBanking != 0)
+		{
+			size_t previous = (i > 0)?i-1:i;
+			size_t next = (i+1 < numPoints)?i+1:i;
+			Real ds = path.getPoint(previous).distance(path.getPoint(i)) + path.getPoint(i).distance(path.getPoint(next));
+			section.orientation = mExtruder._bankFrame(section.orientation, path.getAvgDirection(previous), path.getAvgDirection(next), ds);
+		}
+		section.scale = 1.;
+		section.u = i/numSegPath;
+		if (i >= numPreviousSections || !_isSameSection(section, mSections[i]))
+			mChangedSections.push_back(i);
+		mSections[i] = section;
+	}
+	mPlacedSectionCount = lastSection-firstSection;
+	if (numPoints != numPreviousSections)
+		for (size_t i=0; i<numPoints; i++)
+			mSections[i].u = i/numSegPath;
+
+	// The caps take the placements of the first and last sections
+	for (int c=0; c<2; c++)
+	{
+		mCaps[c] = mSections[c==0?0:numPoints-1];
+		mCaps[c].u = (Real)c;
+	}
+}
+//-----------------------------------------------------------------------
+bool IncrementalExtruder::_shapesHaveChanged() const
+{
+	if (mHasCaps != (!mExtruder.mExtrusionPath->isClosed() && mExtruder.mCapped))
+		return true;
+	std::vector<const Shape*> shapes;
+	mExtruder._getShapes(shapes);
+	if (shapes.size() != mShapeSegCounts.size())
+		return true;
+	for (size_t s=0; s<shapes.size(); s++)
+		if (shapes[s]->getSegCount() != mShapeSegCounts[s] || (shapes[s]->getOutSide() == SIDE_LEFT) != mShapeOutSidesLeft[s])
+			return true;
+	return false;
+}
+//-----------------------------------------------------------------------
+size_t IncrementalExtruder::_getVertexFloatCount() const
+{
+	return mHasNormals?6:3;
+}
+//-----------------------------------------------------------------------
+size_t IncrementalExtruder::_getCapVertexCount() const
+{
+	return mHasCaps?2*mCapPoints.size():0;
+}
+//-----------------------------------------------------------------------
+size_t IncrementalExtruder::_getCapIndexCount() const
+{
+	return mHasCaps?2*mCapTriangles.size():0;
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_allocateBuffers(size_t ringCapacity)
+{
+	mRingCapacity = std::max<size_t>(ringCapacity, 2);
+	size_t numVertices = _getCapVertexCount() + mRingCapacity*mRingVertexCount;
+	size_t numIndices = _getCapIndexCount() + (mRingCapacity-1)*mRingIndexCount;
+	VertexData* vertexData = mSubMesh->vertexData;
+	HardwareBufferManager& manager = HardwareBufferManager::getSingleton();
+	mVertexBuffer = manager.createVertexBuffer(vertexData->vertexDeclaration->getVertexSize(0), numVertices, HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+	vertexData->vertexBufferBinding->setBinding(0, mVertexBuffer);
+	if (mTexCoordSetCount > 0)
+	{
+		mTexCoordBuffer = manager.createVertexBuffer(vertexData->vertexDeclaration->getVertexSize(1), numVertices, HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+		vertexData->vertexBufferBinding->setBinding(1, mTexCoordBuffer);
+	}
+	mIndexBuffer = manager.createIndexBuffer(HardwareIndexBuffer::IT_32BIT, numIndices, HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+	mSubMesh->indexData->indexBuffer = mIndexBuffer;
+	mIndexedRingCount = 0;
+
+	// The triangles of the caps never change : the begin cap faces backwards
+	if (mHasCaps)
+	{
+		uint32 numCapPoints = mCapPoints.size();
+		std::vector<uint32> indices;
+		indices.reserve(_getCapIndexCount());
+		for (size_t i=0; i<mCapTriangles.size(); i+=3)
+		{
+			indices.push_back(mCapTriangles[i]);
+			indices.push_back(mCapTriangles[i+2]);
+			indices.push_back(mCapTriangles[i+1]);
+		}
+		for (size_t i=0; i<mCapTriangles.size(); i++)
+			indices.push_back(numCapPoints + mCapTriangles[i]);
+		if (!indices.empty())
+			mIndexBuffer->writeData(0, indices.size()*sizeof(uint32), &indices[0]);
+	}
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_writeCaps()
+{
+	if (!mHasCaps || mCapPoints.empty())
+		return;
+	size_t numCapPoints = mCapPoints.size();
+	std::vector<float> vertices(2*numCapPoints*_getVertexFloatCount());
+	std::vector<float> texCoords(2*numCapPoints*2*mTexCoordSetCount);
+	float* vertex = &vertices[0];
+	float* texCoord = texCoords.empty()?0:&texCoords[0];
+	mCapBounds.setNull();
+	for (int c=0; c<2; c++)
+	{
+		const Extruder::Section& cap = mCaps[c];
+		Vector3 normal = cap.orientation * (c==0?-Vector3::UNIT_Z:Vector3::UNIT_Z);
+		for (size_t j=0; j<numCapPoints; j++)
+		{
+			const Vector2& point = mCapPoints[j];
+			Vector3 position = cap.position + cap.orientation*(cap.scale*Vector3(point.x, point.y, 0));
+			mCapBounds.merge(position);
+			*vertex++ = position.x;
+			*vertex++ = position.y;
+			*vertex++ = position.z;
+			if (mHasNormals)
+			{
+				*vertex++ = normal.x;
+				*vertex++ = normal.y;
+				*vertex++ = normal.z;
+			}
+			for (unsigned int t=0; t<mTexCoordSetCount; t++)
+			{
+				*texCoord++ = mExtruder.mUVOrigin.x + point.x*mExtruder.mUTile;
+				*texCoord++ = mExtruder.mUVOrigin.y + point.y*mExtruder.mVTile;
+			}
+		}
+	}
+	mVertexBuffer->writeData(0, vertices.size()*sizeof(float), &vertices[0]);
+	if (mTexCoordSetCount > 0)
+		mTexCoordBuffer->writeData(0, texCoords.size()*sizeof(float), &texCoords[0]);
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_writeRings(size_t firstRing, size_t lastRing)
+{
+	if (firstRing >= lastRing)
+		return;
+	size_t vertexFloatCount = _getVertexFloatCount();
+	std::vector<float> vertices((lastRing-firstRing)*mRingVertexCount*vertexFloatCount);
+	size_t maxProfileSize = 0;
+	for (size_t s=0; s<mProfiles.size(); s++)
+		maxProfileSize = std::max(maxProfileSize, mProfiles[s].getSize());
+
+	// Threads share the rings, and write them side by side before they are uploaded at once
+	Utils::_parallelFor(lastRing-firstRing, mExtruder.mNumThreads, 8192/mRingVertexCount+1, [&](size_t first, size_t last)
+	{
+		std::vector<Real> ring(6*maxProfileSize);
+		Real* positions[3] = {&ring[0], &ring[maxProfileSize], &ring[2*maxProfileSize]};
+		Real* normals[3] = {&ring[3*maxProfileSize], &ring[4*maxProfileSize], &ring[5*maxProfileSize]};
+		for (size_t r=first; r<last; r++)
+		{
+			const Extruder::Section& section = mSections[firstRing+r];
+			AxisAlignedBox bounds;
+			float* vertex = &vertices[r*mRingVertexCount*vertexFloatCount];
+			for (size_t s=0; s<mProfiles.size(); s++)
+			{
+				mProfiles[s].placeRing(section.position, section.orientation, section.scale, positions, normals);
+				for (size_t j=0; j<mProfiles[s].getSize(); j++)
+				{
+					bounds.merge(Vector3(positions[0][j], positions[1][j], positions[2][j]));
+					*vertex++ = positions[0][j];
+					*vertex++ = positions[1][j];
+					*vertex++ = positions[2][j];
+					if (mHasNormals)
+					{
+						*vertex++ = normals[0][j];
+						*vertex++ = normals[1][j];
+						*vertex++ = normals[2][j];
+					}
+				}
+			}
+			mRingBounds[firstRing+r] = bounds;
+		}
+	});
+	size_t vertexSize = mVertexBuffer->getVertexSize();
+	mVertexBuffer->writeData((_getCapVertexCount() + firstRing*mRingVertexCount)*vertexSize, vertices.size()*sizeof(float), &vertices[0]);
+	mUpdatedRingCount += lastRing-firstRing;
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_writeTextureCoords()
+{
+	if (mTexCoordSetCount == 0)
+		return;
+	size_t numRings = mSections.size();
+	std::vector<float> texCoords(numRings*mRingVertexCount*2*mTexCoordSetCount);
+	float* texCoord = &texCoords[0];
+	for (size_t i=0; i<numRings; i++)
+	{
+		Real u = mExtruder.mUVOrigin.x + mSections[i].u*mExtruder.mUTile;
+		for (size_t s=0; s<mProfiles.size(); s++)
+			for (size_t j=0; j<mProfiles[s].getSize(); j++)
+				for (unsigned int t=0; t<mTexCoordSetCount; t++)
+				{
+					*texCoord++ = u;
+					*texCoord++ = mExtruder.mUVOrigin.y + mProfiles[s].getV(j)*mExtruder.mVTile;
+				}
+	}
+	size_t vertexSize = mTexCoordBuffer->getVertexSize();
+	mTexCoordBuffer->writeData(_getCapVertexCount()*vertexSize, texCoords.size()*sizeof(float), &texCoords[0]);
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_writeIndices(size_t firstRing, size_t lastRing)
+{
+	if (firstRing >= lastRing)
+		return;
+	std::vector<uint32> indices((lastRing-firstRing)*mRingIndexCount);
+	uint32* index = &indices[0];
+	uint32 ringSize = mRingVertexCount;
+	for (size_t i=firstRing; i<lastRing; i++)
+	{
+		uint32 v = _getCapVertexCount() + i*mRingVertexCount;
+		for (size_t s=0; s<mShapeSegCounts.size(); s++, v++)
+			for (unsigned int j=0; j<mShapeSegCounts[s]; j++, v++)
+			{
+				if (mShapeOutSidesLeft[s])
+				{
+					*index++ = v + ringSize; *index++ = v + ringSize + 1; *index++ = v;
+					*index++ = v; *index++ = v + ringSize + 1; *index++ = v + 1;
+				}
+				else
+				{
+					*index++ = v + ringSize + 1; *index++ = v + ringSize; *index++ = v;
+					*index++ = v + ringSize + 1; *index++ = v; *index++ = v + 1;
+				}
+			}
+	}
+	mIndexBuffer->writeData((_getCapIndexCount() + firstRing*mRingIndexCount)*sizeof(uint32), indices.size()*sizeof(uint32), &indices[0]);
+	mIndexedRingCount = std::max(mIndexedRingCount, lastRing);
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_writeAll()
+{
+	mRingBounds.resize(mSections.size());
+	_writeCaps();
+	_writeRings(0, mSections.size());
+	_writeTextureCoords();
+	_writeIndices(0, mSections.size()-1);
+}
+//-----------------------------------------------------------------------
+void IncrementalExtruder::_updateBounds()
+{
+	AxisAlignedBox bounds;
+	if (mHasCaps)
+		bounds.merge(mCapBounds);
+	for (std::vector<AxisAlignedBox>::const_iterator it = mRingBounds.begin(); it!=mRingBounds.end(); it++)
+		bounds.merge(*it);
+	mMesh->_setBounds(bounds, false);
+	mMesh->_setBoundingSphereRadius(std::max(bounds.getMinimum().length(), bounds.getMaximum().length()));
+
+	mSubMesh->vertexData->vertexCount = _getCapVertexCount() + mSections.size()*mRingVertexCount;
+	mSubMesh->indexData->indexCount = _getCapIndexCount() + (mSections.size()-1)*mRingIndexCount;
+}
+//-----------------------------------------------------------------------
+MeshPtr IncrementalExtruder::realizeMesh(const std::string& name, const String& group)
+{
+	mMesh = MeshManager::getSingleton().createManual(name==""?Utils::getName():name, group);
+	mSubMesh = mMesh->createSubMesh();
+	mSubMesh->setMaterialName("BaseWhiteNoLighting");
+	mSubMesh->useSharedVertices = false;
+	mSubMesh->vertexData = OGRE_NEW VertexData();
+	// The vertex layout follows the settings of the extruder, as they are now
+	mHasNormals = mExtruder.mEnableNormals;
+	mTexCoordSetCount = mExtruder.mNumTexCoordSet;
+	VertexDeclaration* declaration = mSubMesh->vertexData->vertexDeclaration;
+	declaration->addElement(0, 0, VET_FLOAT3, VES_POSITION);
+	if (mHasNormals)
+		declaration->addElement(0, VertexElement::getTypeSize(VET_FLOAT3), VET_FLOAT3, VES_NORMAL);
+	for (unsigned int t=0; t<mTexCoordSetCount; t++)
+		declaration->addElement(1, t*VertexElement::getTypeSize(VET_FLOAT2), VET_FLOAT2, VES_TEXTURE_COORDINATES, t);
+	rebuild();
+	mMesh->load();
+	return mMesh;
+}
+//-----------------------------------------------------------------------
+IncrementalExtruder& IncrementalExtruder::rebuild()
+{
+	assert(!mMesh.isNull() && "The mesh must be realized first");
+	assert(mExtruder.mExtrusionPath && "Path must not be null!");
+	_readShapes();
+	mSections.clear();
+	mPathPoints.clear();
+	mYAxes.clear();
+	_placeSections();
+	mUpdatedRingCount = 0;
+	// Leave room for the path to grow
+	_allocateBuffers(mSections.size()*3/2);
+	_writeAll();
+	_updateBounds();
+	return *this;
+}
+//-----------------------------------------------------------------------
+IncrementalExtruder& IncrementalExtruder::update()
+{
+	assert(!mMesh.isNull() && "The mesh must be realized first");
+	assert(mExtruder.mExtrusionPath && "Path must not be null!");
+	if (_shapesHaveChanged())
+		return rebuild();
+
+	// Every ring depends on its section only, so the sections tell which rings have to be written again
+	Extruder::Section previousCaps[2] = {mCaps[0], mCaps[1]};
+	size_t previousNumRings = mSections.size();
+	_placeSections();
+	mUpdatedRingCount = 0;
+	size_t numRings = mSections.size();
+	if (numRings > mRingCapacity)
+	{
+		_allocateBuffers(numRings*3/2);
+		_writeAll();
+		_updateBounds();
+		return *this;
+	}
+
+	// Changed rings are written by runs of consecutive rings
+	mRingBounds.resize(numRings);
+	for (size_t k=0; k<mChangedSections.size();)
+	{
+		size_t first = mChangedSections[k];
+		size_t last = first+1;
+		for (k++; k<mChangedSections.size() && mChangedSections[k] == last; k++)
+			last++;
+		_writeRings(first, last);
+	}
+	if (numRings != previousNumRings)
+		_writeTextureCoords();
+	// The triangles between two rings only depend on their place, so they are kept when the path gets shorter
+	if (numRings-1 > mIndexedRingCount)
+		_writeIndices(mIndexedRingCount, numRings-1);
+	if (!_isSameSection(mCaps[0], previousCaps[0]) || !_isSameSection(mCaps[1], previousCaps[1]))
+		_writeCaps();
+	_updateBounds();
+	return *this;
+}
+}
@@ -27,6 +27,7 @@ THE SOFTWARE.
 */
 #include "OgreProceduralStableHeaders.h"
 #include "OgreProceduralLathe.h"
+#include "OgreProceduralProfileTable.h"
 
 using namespace Ogre;
 
@@ -37,46 +38,49 @@ void Lathe::addToTriangleBuffer(TriangleBuffer& buffer) const
 		assert( mShapeToExtrude && "Shape must not be null!");
 		int numSegShape = mShapeToExtrude->getSegCount();
 		assert(numSegShape>1 && "Shape must contain at least two points");
-		int offset =0;
 
-		buffer.rebaseOffset();
-		buffer.estimateIndexCount(mNumSeg*numSegShape*6);
-		buffer.estimateVertexCount((numSegShape+1)*(mNumSeg+1));
+		// The points and normals of the shape are the same for every angular step.
+		// Lathe normals point away from the out side of the shape.
+		ProfileTable profile(*mShapeToExtrude, true);
 
-		for (int i=0;i<=mNumSeg;i++)
+		// Each angular step writes its own range of vertices and indices, so the steps can be shared by several threads
+		size_t firstVertex = buffer.getVertexCount();
+		size_t firstIndex = buffer.getIndexCount();
+		buffer.extend((numSegShape+1)*(mNumSeg+1), mNumSeg*numSegShape*6);
+		Utils::_parallelFor(mNumSeg+1, mNumThreads, 8192/(numSegShape+1)+1, [&](size_t first, size_t last)
 		{
-			Real angle = i/(Real)mNumSeg*Math::TWO_PI;
-			Quaternion q;
-			q.FromAngleAxis((Radian)angle,Vector3::UNIT_Y);
-
-			for (int j=0;j<=numSegShape;j++)
+			std::vector<Real> ring(6*(numSegShape+1));
+			Real* positions[3] = {&ring[0], &ring[numSegShape+1], &ring[2*(numSegShape+1)]};
+			Real* normals[3] = {&ring[3*(numSegShape+1)], &ring[4*(numSegShape+1)], &ring[5*(numSegShape+1)]};
+			for (int i=first;i<(int)last;i++)
 			{
-				Vector2 v0 = mShapeToExtrude->getPoint(j);
-				Vector3 vp(v0.x,v0.y,0);
-				Vector2 vp2direction = mShapeToExtrude->getAvgDirection(j);
-				Vector2 vp2normal = vp2direction.perpendicular();
-				Vector3 normal(vp2normal.x, vp2normal.y, 0);
-				normal.normalise();
-				if (mShapeToExtrude->getOutSide() == SIDE_LEFT)
-				{
-					normal = -normal;
-				}
+				Real angle = i/(Real)mNumSeg*Math::TWO_PI;
+				Quaternion q;
+				q.FromAngleAxis((Radian)angle,Vector3::UNIT_Y);
+				profile.placeRing(Vector3::ZERO, q, 1., positions, normals);
+				int offset = firstVertex + i*(numSegShape+1);
+				size_t index = firstIndex + i*numSegShape*6;
 
-				addPoint(buffer, q*vp,
-								 q*normal,
-								 Vector2(i/(Real)mNumSeg, j/(Real)numSegShape));
-
-				if (j <numSegShape && i <mNumSeg)
+				for (int j=0;j<=numSegShape;j++)
 				{
-					buffer.index(offset + numSegShape + 2);
-					buffer.index(offset);
-					buffer.index(offset + numSegShape + 1);
-					buffer.index(offset + numSegShape + 2);
-					buffer.index(offset + 1);
-					buffer.index(offset);
+					setPoint(buffer, offset,
+									 Vector3(positions[0][j], positions[1][j], positions[2][j]),
+									 Vector3(normals[0][j], normals[1][j], normals[2][j]),
+									 Vector2(i/(Real)mNumSeg, profile.getV(j)));
+
+					if (j <numSegShape && i <mNumSeg)
+					{
+						buffer.setIndex(index, offset + numSegShape + 2);
+						buffer.setIndex(index+1, offset);
+						buffer.setIndex(index+2, offset + numSegShape + 1);
+						buffer.setIndex(index+3, offset + numSegShape + 2);
+						buffer.setIndex(index+4, offset + 1);
+						buffer.setIndex(index+5, offset);
+						index += 6;
+					}
+					offset ++;
 				}
-				offset ++;
 			}
-		}
+		});
 	}
 }
@@ -28,6 +28,9 @@ THE SOFTWARE.
 #include "OgreProceduralStableHeaders.h"
 #include "OgreProceduralMultiShape.h"
 #include "OgreProceduralShape.h"
+#include "OgreProceduralGeometryHelpers.h"
+#include <map>
+#include <stdexcept>
 
 using namespace Ogre;
 
@@ -57,12 +60,52 @@ namespace OgreProcedural
 	std::vector<Vector2> MultiShape::getPoints() const
 	{
 		std::vector<Vector2> result;
-		for (size_t i = 0;i<mShapes.size(); i++)
+		result.reserve(getPointCount());
+		result.insert(result.end(), pointsBegin(), pointsEnd());
+		return result;
+	}
+//-----------------------------------------------------------------------
+	size_t MultiShape::getPointCount() const
+	{
+		size_t numPoints = 0;
+		for (std::vector<Shape>::const_iterator it = mShapes.begin(); it!=mShapes.end(); it++)
+			numPoints += it->getPointCount();
+		return numPoints;
+	}
+//-----------------------------------------------------------------------
+	void MultiShape::PointIterator::_skipEmptyShapes()
+	{
+		while (mShapeIndex<mShapes->size() && mPointIndex>=(*mShapes)[mShapeIndex].getPointCount())
 		{
-			std::vector<Vector2> points = mShapes[i].getPoints();
-			result.insert(result.end(), points.begin(), points.end());
+			mShapeIndex++;
+			mPointIndex = 0;
 		}
-		return result;
+	}
+//-----------------------------------------------------------------------
+	const Vector2& MultiShape::PointIterator::operator*() const
+	{
+		return (*mShapes)[mShapeIndex].getPointsReference()[mPointIndex];
+	}
+//-----------------------------------------------------------------------
+	MultiShape& MultiShape::translate(const Vector2& translation)
+	{
+		for (std::vector<Shape>::iterator it = mShapes.begin(); it!=mShapes.end(); it++)
+			it->translate(translation);
+		return *this;
+	}
+//-----------------------------------------------------------------------
+	MultiShape& MultiShape::rotate(Radian angle)
+	{
+		for (std::vector<Shape>::iterator it = mShapes.begin(); it!=mShapes.end(); it++)
+			it->rotate(angle);
+		return *this;
+	}
+//-----------------------------------------------------------------------
+	MultiShape& MultiShape::scale(Real scaleX, Real scaleY)
+	{
+		for (std::vector<Shape>::iterator it = mShapes.begin(); it!=mShapes.end(); it++)
+			it->scale(scaleX, scaleY);
+		return *this;
 	}
 //-----------------------------------------------------------------------
 	bool MultiShape::isPointInside(const Vector2& point) const
@@ -86,7 +129,7 @@ namespace OgreProcedural
 				if (A.y!=B.y && (A.y-point.y)*(B.y-point.y)<=0.)
 				{
 					Vector2 intersect(A.x+(point.y-A.y)*(B.x-A.x)/(B.y-A.y), point.y);
-					float dist = abs(point.x-intersect.x);
+					Real dist = Math::Abs(point.x-intersect.x);
 					if (dist<closestSegmentDistance)
 					{
 						closestSegmentIndex = i;
@@ -122,4 +165,718 @@ namespace OgreProcedural
 		return true;
 	}
 
+//-----------------------------------------------------------------------
+	/// Point of a boolean operation, in double precision so that grid coordinates stay exact
+	struct BooleanPoint
+	{
+		double x, y;
+		BooleanPoint() {}
+		BooleanPoint(double _x, double _y) : x(_x), y(_y) {}
+		bool operator==(const BooleanPoint& other) const
+		{
+			return x==other.x && y==other.y;
+		}
+		bool operator!=(const BooleanPoint& other) const
+		{
+			return x!=other.x || y!=other.y;
+		}
+		bool operator<(const BooleanPoint& other) const
+		{
+			if (x!=other.x)
+				return x<other.x;
+			return y<other.y;
+		}
+	};
+//-----------------------------------------------------------------------
+	/// Contour edge going into a boolean operation, with the points where it has to be split
+	struct BooleanInputEdge
+	{
+		BooleanPoint a, b;
+		int operand;
+		/// Whether the edge hasn't been checked against the other edges yet
+		bool isNew;
+		double minX, maxX, minY, maxY;
+		std::vector<std::pair<double, BooleanPoint> > splits;
+		BooleanInputEdge() : operand(0), isNew(true), minX(0.), maxX(0.), minY(0.), maxY(0.) {}
+		bool operator<(const BooleanInputEdge& other) const
+		{
+			return minX<other.minX;
+		}
+	};
+//-----------------------------------------------------------------------
+	/// Edge of the planar graph made of all the split contour edges, going from its lowest vertex index to its highest
+	struct BooleanGraphEdge
+	{
+		int v[2];
+		/// How much the winding number of each operand increases when crossing that edge from its right to its left
+		int winding[2];
+	};
+//-----------------------------------------------------------------------
+	struct BooleanSplitLess
+	{
+		bool operator()(const std::pair<double, BooleanPoint>& a, const std::pair<double, BooleanPoint>& b) const
+		{
+			return a.first<b.first;
+		}
+	};
+//-----------------------------------------------------------------------
+	/// Sorts directions counter-clockwise, starting from the X axis
+	struct BooleanAngleLess
+	{
+		static int _halfPlane(const BooleanPoint& d)
+		{
+			return (d.y<0. || (d.y==0. && d.x<0.))?1:0;
+		}
+		bool operator()(const std::pair<BooleanPoint, int>& a, const std::pair<BooleanPoint, int>& b) const
+		{
+			int halfA = _halfPlane(a.first);
+			int halfB = _halfPlane(b.first);
+			if (halfA!=halfB)
+				return halfA<halfB;
+			return a.first.x*b.first.y-a.first.y*b.first.x>0.;
+		}
+	};
+//-----------------------------------------------------------------------
+	/// Tells on which side of the oriented line (a,b) point c stands. Exact for grid coordinates.
+	static inline double _orient(const BooleanPoint& a, const BooleanPoint& b, const BooleanPoint& c)
+	{
+		return (b.x-a.x)*(c.y-a.y) - (b.y-a.y)*(c.x-a.x);
+	}
+//-----------------------------------------------------------------------
+	static inline double _squaredDistance(const BooleanPoint& a, const BooleanPoint& b)
+	{
+		return (b.x-a.x)*(b.x-a.x) + (b.y-a.y)*(b.y-a.y);
+	}
+//-----------------------------------------------------------------------
+	/// Splits edge e where point p lies on it. Returns true if p touches e.
+	static bool _splitOnPoint(BooleanInputEdge& e, const BooleanPoint& p)
+	{
+		if (p==e.a || p==e.b)
+			return true;
+		if (_orient(e.a, e.b, p)!=0.)
+			return false;
+		double dx = e.b.x-e.a.x;
+		double dy = e.b.y-e.a.y;
+		double t = ((p.x-e.a.x)*dx + (p.y-e.a.y)*dy)/(dx*dx+dy*dy);
+		if (t<=0. || t>=1.)
+			return false;
+		e.splits.push_back(std::make_pair(t, p));
+		return true;
+	}
+//-----------------------------------------------------------------------
+	/// Records the points where edges e and f have to be split so that they only meet at their ends
+	static void _splitEdges(BooleanInputEdge& e, BooleanInputEdge& f)
+	{
+		// an edge end lying on the other edge (this also covers collinear overlaps)
+		bool touching = _splitOnPoint(e, f.a);
+		touching = _splitOnPoint(e, f.b) || touching;
+		touching = _splitOnPoint(f, e.a) || touching;
+		touching = _splitOnPoint(f, e.b) || touching;
+		if (touching)
+			return;
+
+		// proper crossing, rounded to the closest grid point
+		double o1 = _orient(e.a, e.b, f.a);
+		double o2 = _orient(e.a, e.b, f.b);
+		double o3 = _orient(f.a, f.b, e.a);
+		double o4 = _orient(f.a, f.b, e.b);
+		if (((o1>0. && o2<0.) || (o1<0. && o2>0.)) && ((o3>0. && o4<0.) || (o3<0. && o4>0.)))
+		{
+			double t = o3/(o3-o4);
+			BooleanPoint p(floor(e.a.x+t*(e.b.x-e.a.x)+.5), floor(e.a.y+t*(e.b.y-e.a.y)+.5));
+			e.splits.push_back(std::make_pair(t, p));
+			f.splits.push_back(std::make_pair(o1/(o1-o2), p));
+		}
+	}
+//-----------------------------------------------------------------------
+	static int _findRoot(std::vector<int>& parents, int i)
+	{
+		while (parents[i]!=i)
+		{
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::booleanUnion(const MultiShape& other, WindingRule windingRule, Real gridResolution) const
+	{
+		return _booleanOperation(other, BOT_UNION, windingRule, gridResolution);
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::booleanIntersect(const MultiShape& other, WindingRule windingRule, Real gridResolution) const
+	{
+		return _booleanOperation(other, BOT_INTERSECTION, windingRule, gridResolution);
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::booleanDifference(const MultiShape& other, WindingRule windingRule, Real gridResolution) const
+	{
+		return _booleanOperation(other, BOT_DIFFERENCE, windingRule, gridResolution);
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::booleanXor(const MultiShape& other, WindingRule windingRule, Real gridResolution) const
+	{
+		return _booleanOperation(other, BOT_XOR, windingRule, gridResolution);
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::_booleanUnion(const MultiShape& other, WindingRule windingRule, Real gridResolution, unsigned int maxSweepPasses) const
+	{
+		return _booleanOperation(other, BOT_UNION, windingRule, gridResolution, maxSweepPasses);
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::_booleanOperation(const MultiShape& other, BooleanOperationType opType, WindingRule windingRule, Real gridResolution, size_t maxSweepPasses) const
+	{
+		// Gather the edges of all contours, oriented so that the inside of each contour is on their left
+		const MultiShape* operands[2] = {this, &other};
+		std::vector<BooleanInputEdge> inputEdges;
+		double magnitude = 0.;
+		for (int op=0;op<2;op++)
+			for (size_t k=0;k<operands[op]->mShapes.size();k++)
+			{
+				const Shape& shape = operands[op]->mShapes[k];
+				assert(shape.isClosed() && "Boolean operations only work on closed shapes");
+				for (size_t i=0;i<shape.getSegCount();i++)
+				{
+					BooleanInputEdge e;
+					const Vector2& a = shape.getPoint(i);
+					const Vector2& b = shape.getPoint(i+1);
+					e.a = BooleanPoint(a.x, a.y);
+					e.b = BooleanPoint(b.x, b.y);
+					if (shape.getOutSide()==SIDE_LEFT)
+						std::swap(e.a, e.b);
+					e.operand = op;
+					magnitude = std::max(magnitude, std::max(std::max(fabs(e.a.x), fabs(e.a.y)), std::max(fabs(e.b.x), fabs(e.b.y))));
+					inputEdges.push_back(e);
+				}
+			}
+		MultiShape result;
+		if (magnitude==0.)
+			return result;
+
+		// All the computations run on whole numbers of grid steps, so that the predicates are exact.
+		// Without a grid resolution, the grid is about as fine as the float precision of the shapes.
+		double gridStep = gridResolution;
+		if (gridStep<=0.)
+		{
+			int exponent;
+			frexp(magnitude, &exponent);
+			gridStep = ldexp(1., exponent-24);
+		}
+		// Products of grid coordinates must fit in the mantissa of a double, so a grid too fine for the size of the shapes is coarsened
+		gridStep = std::max(gridStep, ldexp(magnitude, -25));
+
+		// Sweep the edges along X to find the ones which meet, and split them there.
+		// Crossings are rounded to the grid, which can make the split edges meet other edges :
+		// the split edges go through the sweep again, until no edge meets another one.
+		// Should the rounded crossings keep making new meets for as many passes as there are edges,
+		// the sweep starts over on a grid twice as coarse, and after a few of them, the operation fails.
+		const int maxGridCoarsenings = 8;
+		if (maxSweepPasses==0)
+			maxSweepPasses = inputEdges.size()+1;
+		std::vector<BooleanInputEdge> sourceEdges;
+		sourceEdges.swap(inputEdges);
+		std::vector<int> active[2];
+		std::vector<BooleanInputEdge> splitEdges;
+		for (int coarsening=0;;coarsening++)
+		{
+			if (coarsening>maxGridCoarsenings)
+				throw std::runtime_error("Boolean operation : the edges keep meeting where their crossings are rounded to the grid");
+			inputEdges.clear();
+			for (size_t i=0;i<sourceEdges.size();i++)
+			{
+				BooleanInputEdge e = sourceEdges[i];
+				e.a = BooleanPoint(floor(e.a.x/gridStep+.5), floor(e.a.y/gridStep+.5));
+				e.b = BooleanPoint(floor(e.b.x/gridStep+.5), floor(e.b.y/gridStep+.5));
+				if (e.a!=e.b)
+					inputEdges.push_back(e);
+			}
+
+			bool hasSplits = true;
+			for (size_t pass=0;hasSplits && pass<maxSweepPasses;pass++)
+			{
+				for (size_t i=0;i<inputEdges.size();i++)
+				{
+					BooleanInputEdge& e = inputEdges[i];
+					e.minX = std::min(e.a.x, e.b.x);
+					e.maxX = std::max(e.a.x, e.b.x);
+					e.minY = std::min(e.a.y, e.b.y);
+					e.maxY = std::max(e.a.y, e.b.y);
+				}
+				std::sort(inputEdges.begin(), inputEdges.end());
+				// active edges are kept apart depending on whether they are new, so that old edges only scan new ones
+				active[0].clear();
+				active[1].clear();
+				for (size_t i=0;i<inputEdges.size();i++)
+				{
+					BooleanInputEdge& e = inputEdges[i];
+					for (int n=e.isNew?0:1;n<2;n++)
+						for (size_t a=0;a<active[n].size();)
+						{
+							BooleanInputEdge& f = inputEdges[active[n][a]];
+							if (f.maxX<e.minX)
+							{
+								active[n][a] = active[n].back();
+								active[n].pop_back();
+								continue;
+							}
+							if (f.maxY>=e.minY && f.minY<=e.maxY)
+								_splitEdges(e, f);
+							a++;
+						}
+					active[e.isNew?1:0].push_back(i);
+				}
+
+				hasSplits = false;
+				splitEdges.clear();
+				for (size_t i=0;i<inputEdges.size();i++)
+				{
+					BooleanInputEdge& e = inputEdges[i];
+					if (e.splits.empty())
+					{
+						e.isNew = false;
+						splitEdges.push_back(e);
+						continue;
+					}
+					hasSplits = true;
+					std::sort(e.splits.begin(), e.splits.end(), BooleanSplitLess());
+					BooleanInputEdge part;
+					part.operand = e.operand;
+					part.a = e.a;
+					for (size_t j=0;j<=e.splits.size();j++)
+					{
+						part.b = (j<e.splits.size())?e.splits[j].second:e.b;
+						if (part.a!=part.b)
+						{
+							splitEdges.push_back(part);
+							part.a = part.b;
+						}
+					}
+				}
+				inputEdges.swap(splitEdges);
+			}
+			if (!hasSplits)
+				break;
+			gridStep *= 2.;
+		}
+
+		// Build the planar graph : identical points become the same vertex, and overlapping edges the same edge
+		std::vector<BooleanPoint> vertices;
+		std::map<BooleanPoint, int> vertexIndices;
+		std::vector<BooleanGraphEdge> edges;
+		std::map<std::pair<int, int>, int> edgeIndices;
+		for (size_t i=0;i<inputEdges.size();i++)
+		{
+			int v[2];
+			for (int k=0;k<2;k++)
+			{
+				const BooleanPoint& p = (k==0)?inputEdges[i].a:inputEdges[i].b;
+				std::map<BooleanPoint, int>::iterator it = vertexIndices.find(p);
+				if (it==vertexIndices.end())
+				{
+					v[k] = vertices.size();
+					vertexIndices[p] = v[k];
+					vertices.push_back(p);
+				}
+				else
+					v[k] = it->second;
+			}
+			std::pair<int, int> key(std::min(v[0], v[1]), std::max(v[0], v[1]));
+			std::map<std::pair<int, int>, int>::iterator it = edgeIndices.find(key);
+			if (it==edgeIndices.end())
+			{
+				BooleanGraphEdge edge;
+				edge.v[0] = key.first;
+				edge.v[1] = key.second;
+				edge.winding[0] = edge.winding[1] = 0;
+				it = edgeIndices.insert(std::make_pair(key, (int)edges.size())).first;
+				edges.push_back(edge);
+			}
+			edges[it->second].winding[inputEdges[i].operand] += (v[0]<v[1])?1:-1;
+		}
+		// Edges whose contours cancel each other don't separate anything
+		size_t numEdges = 0;
+		for (size_t i=0;i<edges.size();i++)
+			if (edges[i].winding[0]!=0 || edges[i].winding[1]!=0)
+				edges[numEdges++] = edges[i];
+		edges.resize(numEdges);
+		if (edges.empty())
+			return result;
+
+		// Half-edge 2i goes along edge i, half-edge 2i+1 goes backwards.
+		// Outgoing half-edges are sorted counter-clockwise around each vertex.
+		size_t numHalfEdges = 2*edges.size();
+		std::vector<int> firstOutgoing(vertices.size()+1, 0);
+		for (size_t h=0;h<numHalfEdges;h++)
+			firstOutgoing[edges[h/2].v[h%2]+1]++;
+		for (size_t v=0;v<vertices.size();v++)
+			firstOutgoing[v+1] += firstOutgoing[v];
+		std::vector<std::pair<BooleanPoint, int> > outgoing(numHalfEdges);
+		std::vector<int> fill(firstOutgoing.begin(), firstOutgoing.end()-1);
+		for (size_t h=0;h<numHalfEdges;h++)
+		{
+			const BooleanPoint& p0 = vertices[edges[h/2].v[h%2]];
+			const BooleanPoint& p1 = vertices[edges[h/2].v[1-h%2]];
+			outgoing[fill[edges[h/2].v[h%2]]++] = std::make_pair(BooleanPoint(p1.x-p0.x, p1.y-p0.y), (int)h);
+		}
+		std::vector<int> positions(numHalfEdges);
+		for (size_t v=0;v<vertices.size();v++)
+		{
+			std::sort(outgoing.begin()+firstOutgoing[v], outgoing.begin()+firstOutgoing[v+1], BooleanAngleLess());
+			for (int j=firstOutgoing[v];j<firstOutgoing[v+1];j++)
+				positions[outgoing[j].second] = j;
+		}
+		// the next half-edge around the face on the left is the one just clockwise of the twin
+		std::vector<int> nextHalfEdges(numHalfEdges);
+		for (size_t h=0;h<numHalfEdges;h++)
+		{
+			int v = edges[h/2].v[1-h%2];
+			int j = positions[h^1]-1;
+			if (j<firstOutgoing[v])
+				j = firstOutgoing[v+1]-1;
+			nextHalfEdges[h] = outgoing[j].second;
+		}
+
+		// Find the faces, their area, and the connected components they belong to
+		std::vector<int> components(vertices.size());
+		for (size_t v=0;v<vertices.size();v++)
+			components[v] = v;
+		for (size_t i=0;i<edges.size();i++)
+			components[_findRoot(components, edges[i].v[0])] = _findRoot(components, edges[i].v[1]);
+		std::vector<int> faces(numHalfEdges, -1);
+		std::vector<double> faceAreas;
+		std::vector<int> faceComponents;
+		std::vector<int> faceFirstHalfEdges;
+		for (size_t h0=0;h0<numHalfEdges;h0++)
+		{
+			if (faces[h0]!=-1)
+				continue;
+			int f = faceAreas.size();
+			double area = 0.;
+			int h = h0;
+			do
+			{
+				faces[h] = f;
+				const BooleanPoint& p0 = vertices[edges[h/2].v[h%2]];
+				const BooleanPoint& p1 = vertices[edges[h/2].v[1-h%2]];
+				area += p0.x*p1.y-p1.x*p0.y;
+				h = nextHalfEdges[h];
+			} while (h!=(int)h0);
+			faceAreas.push_back(area);
+			faceComponents.push_back(_findRoot(components, edges[h0/2].v[0]));
+			faceFirstHalfEdges.push_back(h0);
+		}
+
+		// Index the edges by rows, to cast horizontal rays through them
+		double minY = vertices[0].y, maxY = vertices[0].y;
+		for (size_t v=1;v<vertices.size();v++)
+		{
+			minY = std::min(minY, vertices[v].y);
+			maxY = std::max(maxY, vertices[v].y);
+		}
+		size_t numRows = std::max<size_t>(1, (size_t)sqrt((double)edges.size()));
+		double rowScale = (maxY>minY)?(numRows-1e-3)/(maxY-minY):0.;
+		std::vector<std::vector<int> > rows(numRows);
+		for (size_t i=0;i<edges.size();i++)
+		{
+			double y0 = vertices[edges[i].v[0]].y;
+			double y1 = vertices[edges[i].v[1]].y;
+			size_t r0 = (size_t)((std::min(y0, y1)-minY)*rowScale);
+			size_t r1 = (size_t)((std::max(y0, y1)-minY)*rowScale);
+			for (size_t r=r0;r<=r1 && r<numRows;r++)
+				rows[r].push_back(i);
+		}
+
+		// Compute the winding numbers of every face, starting from the outer face of each component.
+		// The outer face of a component is surrounded by the other components only, so its winding numbers
+		// are found by casting a ray from the leftmost vertex of the component, and counting the edges of other components it crosses.
+		std::vector<int> componentLeftmostVertices(vertices.size(), -1);
+		std::vector<int> componentOuterFaces(vertices.size(), -1);
+		for (size_t v=0;v<vertices.size();v++)
+		{
+			int c = _findRoot(components, v);
+			int& leftmost = componentLeftmostVertices[c];
+			if (leftmost==-1 || vertices[v]<vertices[leftmost])
+				leftmost = v;
+		}
+		for (size_t f=0;f<faceAreas.size();f++)
+		{
+			int& outer = componentOuterFaces[faceComponents[f]];
+			if (outer==-1 || faceAreas[f]<faceAreas[outer])
+				outer = f;
+		}
+		std::vector<int> faceWindings(2*faceAreas.size(), 0);
+		std::vector<bool> faceVisited(faceAreas.size(), false);
+		std::vector<int> stack;
+		for (size_t c=0;c<vertices.size();c++)
+		{
+			int outerFace = componentOuterFaces[c];
+			if (outerFace==-1)
+				continue;
+			const BooleanPoint& p = vertices[componentLeftmostVertices[c]];
+			int winding[2] = {0, 0};
+			const std::vector<int>& row = rows[std::min(numRows-1, (size_t)((p.y-minY)*rowScale))];
+			for (std::vector<int>::const_iterator it = row.begin(); it!=row.end(); it++)
+			{
+				const BooleanGraphEdge& edge = edges[*it];
+				if (_findRoot(components, edge.v[0])==(int)c)
+					continue;
+				const BooleanPoint& a = vertices[edge.v[0]];
+				const BooleanPoint& b = vertices[edge.v[1]];
+				if ((a.y<=p.y) == (b.y<=p.y))
+					continue;
+				double x = a.x+(p.y-a.y)*(b.x-a.x)/(b.y-a.y);
+				if (x>=p.x)
+					continue;
+				// going from left to right across an upward edge means going from its left side to its right side
+				int sign = (a.y<b.y)?-1:1;
+				winding[0] += sign*edge.winding[0];
+				winding[1] += sign*edge.winding[1];
+			}
+			faceWindings[2*outerFace] = winding[0];
+			faceWindings[2*outerFace+1] = winding[1];
+			faceVisited[outerFace] = true;
+			stack.push_back(outerFace);
+			while (!stack.empty())
+			{
+				int f = stack.back();
+				stack.pop_back();
+				int h = faceFirstHalfEdges[f];
+				do
+				{
+					int g = faces[h^1];
+					if (!faceVisited[g])
+					{
+						// the face on the right of h has the winding of the face on its left, minus the winding of h
+						int sign = (h%2==0)?1:-1;
+						faceWindings[2*g] = faceWindings[2*f]-sign*edges[h/2].winding[0];
+						faceWindings[2*g+1] = faceWindings[2*f+1]-sign*edges[h/2].winding[1];
+						faceVisited[g] = true;
+						stack.push_back(g);
+					}
+					h = nextHalfEdges[h];
+				} while (h!=faceFirstHalfEdges[f]);
+			}
+		}
+
+		// Tell which faces belong to the result
+		std::vector<bool> faceInside(faceAreas.size());
+		for (size_t f=0;f<faceAreas.size();f++)
+		{
+			bool inside[2];
+			for (int op=0;op<2;op++)
+			{
+				if (windingRule==WR_EVENODD)
+					inside[op] = (faceWindings[2*f+op]%2)!=0;
+				else if (windingRule==WR_POSITIVE)
+					inside[op] = faceWindings[2*f+op]>0;
+				else
+					inside[op] = faceWindings[2*f+op]!=0;
+			}
+			if (opType==BOT_UNION)
+				faceInside[f] = inside[0] || inside[1];
+			else if (opType==BOT_INTERSECTION)
+				faceInside[f] = inside[0] && inside[1];
+			else if (opType==BOT_DIFFERENCE)
+				faceInside[f] = inside[0] && !inside[1];
+			else
+				faceInside[f] = inside[0] != inside[1];
+		}
+
+		// Output the half-edges which have the result on their left and nothing on their right.
+		// At each vertex, the contour goes on with the first such half-edge found clockwise of where it came from.
+		std::vector<bool> isOnContour(numHalfEdges);
+		for (size_t h=0;h<numHalfEdges;h++)
+			isOnContour[h] = faceInside[faces[h]] && !faceInside[faces[h^1]];
+		std::vector<BooleanPoint> contour;
+		for (size_t h0=0;h0<numHalfEdges;h0++)
+		{
+			if (!isOnContour[h0])
+				continue;
+			contour.clear();
+			int h = h0;
+			do
+			{
+				isOnContour[h] = false;
+				contour.push_back(vertices[edges[h/2].v[h%2]]);
+				int v = edges[h/2].v[1-h%2];
+				int j = positions[h^1];
+				do
+				{
+					j--;
+					if (j<firstOutgoing[v])
+						j = firstOutgoing[v+1]-1;
+				} while (!isOnContour[outgoing[j].second] && outgoing[j].second!=(int)h0);
+				h = outgoing[j].second;
+			} while (h!=(int)h0);
+
+			// Drop the points where the contour goes straight on, such as the ends of edges it was split on
+			Shape shape;
+			for (size_t i=0;i<contour.size();i++)
+			{
+				const BooleanPoint& previous = contour[(i+contour.size()-1)%contour.size()];
+				const BooleanPoint& next = contour[(i+1)%contour.size()];
+				if (_orient(previous, contour[i], next)!=0. || (contour[i].x-previous.x)*(next.x-contour[i].x)+(contour[i].y-previous.y)*(next.y-contour[i].y)<=0.)
+				{
+					shape.addPoint((Real)(contour[i].x*gridStep), (Real)(contour[i].y*gridStep));
+				}
+			}
+			shape.close();
+			result.addShape(shape);
+		}
+		return result;
+	}
+
+//-----------------------------------------------------------------------
+	/**
+	 * Appends the offset of a corner to a raw offset contour.
+	 * The contour has its inside on the left, and is offset towards its right.
+	 * @arg p The corner
+	 * @arg d0 The unit direction of the edge going into the corner
+	 * @arg d1 The unit direction of the edge going out of the corner
+	 * @arg isEnd If true, the corner is the end of an open shape, and is capped
+	 */
+	static void _addOffsetCorner(std::vector<Vector2>& output, const Vector2& p, const Vector2& d0, const Vector2& d1, Real amount,
+		JoinType joinType, Real miterLimit, unsigned int numSegCircle, bool isEnd)
+	{
+		Vector2 n0(d0.y, -d0.x);
+		Vector2 n1(d1.y, -d1.x);
+		Real cross = d0.crossProduct(d1);
+		Real dot = d0.dotProduct(d1);
+		bool isStraight = Math::Abs(cross)<1e-6f;
+		if (isStraight && dot>0.)
+		{
+			output.push_back(p+amount*n0);
+			return;
+		}
+		bool isUTurn = isStraight || isEnd;
+		if (isUTurn?amount<0.:cross*amount<0.)
+		{
+			// Offset edges overlap there : going through the corner keeps the winding consistent, and the overlap is merged later
+			output.push_back(p+amount*n0);
+			output.push_back(p);
+			output.push_back(p+amount*n1);
+			return;
+		}
+		if (isEnd && joinType==JT_MITER)
+		{
+			// flat cap
+			output.push_back(p+amount*n0);
+			output.push_back(p+amount*n1);
+			return;
+		}
+
+		Real absAmount = Math::Abs(amount);
+		if (joinType==JT_ROUND)
+		{
+			Real angle = isUTurn?Math::PI:Math::ATan2(n0.crossProduct(n1), n0.dotProduct(n1)).valueRadians();
+			unsigned int numSteps = std::max(1, (int)Math::Ceil(Math::Abs(angle)/Math::TWO_PI*numSegCircle));
+			for (unsigned int i=0;i<=numSteps;i++)
+			{
+				Real a = angle*i/numSteps;
+				Real c = Math::Cos(a);
+				Real s = Math::Sin(a);
+				output.push_back(p+amount*Vector2(c*n0.x-s*n0.y, s*n0.x+c*n0.y));
+			}
+			return;
+		}
+
+		// Square corners are cut at the offset distance, miter corners at the miter limit if they go further
+		Vector2 bisector = isUTurn?d0:(n0+n1).normalisedCopy()*(amount>0.?1.f:-1.f);
+		Real cosHalfAngle = isUTurn?0.f:(n0+n1).length()*.5f;
+		Real cutDistance = (joinType==JT_MITER)?miterLimit*absAmount:absAmount;
+		if (joinType==JT_MITER && absAmount<=cutDistance*cosHalfAngle)
+		{
+			output.push_back(p+amount/(1.f+n0.dotProduct(n1))*(n0+n1));
+			return;
+		}
+		Real extension = cutDistance-absAmount*cosHalfAngle;
+		output.push_back(p+amount*n0+extension/d0.dotProduct(bisector)*d0);
+		output.push_back(p+amount*n1+extension/d1.dotProduct(bisector)*d1);
+	}
+//-----------------------------------------------------------------------
+	/**
+	 * Builds the raw offset of a polyline, which may intersect itself.
+	 * If the polyline is open, it goes forth and back, so that the raw offset surrounds it.
+	 */
+	static void _addRawOffset(MultiShape& output, const std::vector<Vector2>& points, bool closed, Real amount,
+		JoinType joinType, Real miterLimit, unsigned int numSegCircle)
+	{
+		std::vector<Vector2> path;
+		for (size_t i=0;i<points.size();i++)
+			if (path.empty() || points[i]!=path.back())
+				path.push_back(points[i]);
+		if (closed && path.size()>1 && path.front()==path.back())
+			path.pop_back();
+		if (path.size()<2)
+			return;
+		size_t numForward = path.size();
+		if (!closed)
+			for (size_t i=numForward-2;i>0;i--)
+				path.push_back(path[i]);
+
+		std::vector<Vector2> contour;
+		size_t n = path.size();
+		for (size_t i=0;i<n;i++)
+		{
+			Vector2 d0 = (path[i]-path[(i+n-1)%n]).normalisedCopy();
+			Vector2 d1 = (path[(i+1)%n]-path[i]).normalisedCopy();
+			bool isEnd = !closed && (i==0 || i==numForward-1);
+			_addOffsetCorner(contour, path[i], d0, d1, amount, joinType, miterLimit, numSegCircle, isEnd);
+		}
+		Shape shape;
+		for (size_t i=0;i<contour.size();i++)
+			shape.addPoint(contour[i]);
+		shape.close();
+		output.addShape(shape);
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::offset(Real amount, JoinType joinType, Real miterLimit, unsigned int numSegCircle, Real gridResolution) const
+	{
+		return _offset(amount, false, joinType, miterLimit, numSegCircle, gridResolution);
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::thicken(Real amount, JoinType joinType, Real miterLimit, unsigned int numSegCircle, Real gridResolution) const
+	{
+		return _offset(amount, true, joinType, miterLimit, numSegCircle, gridResolution);
+	}
+//-----------------------------------------------------------------------
+	MultiShape& MultiShape::simplify(Real tolerance)
+	{
+		// All the shapes share an index, so that none of them can be simplified across another one
+		SimplificationIndex index;
+		for (std::vector<Shape>::const_iterator it = mShapes.begin(); it!=mShapes.end(); it++)
+			index.addPolyline(it->getPointsReference(), it->isClosed());
+		index.build();
+		for (size_t i=0;i<mShapes.size();i++)
+			mShapes[i]._simplify(tolerance, index, (int)i);
+		return *this;
+	}
+//-----------------------------------------------------------------------
+	MultiShape MultiShape::_offset(Real amount, bool thicken, JoinType joinType, Real miterLimit, unsigned int numSegCircle, Real gridResolution) const
+	{
+		// Each shape gets a raw offset contour, with its inside on the left.
+		// The raw contours go through a union which only keeps what they positively wind around,
+		// removing the loops made where the offset edges cross each other.
+		MultiShape rawContours;
+		std::vector<Vector2> points;
+		for (std::vector<Shape>::const_iterator it = mShapes.begin(); it!=mShapes.end(); it++)
+		{
+			points = it->getPointsReference();
+			if (it->getOutSide()==SIDE_LEFT)
+				std::reverse(points.begin(), points.end());
+			if (!it->isClosed())
+				_addRawOffset(rawContours, points, false, Math::Abs(amount), joinType, miterLimit, numSegCircle);
+			else if (!thicken)
+				_addRawOffset(rawContours, points, true, amount, joinType, miterLimit, numSegCircle);
+			else
+			{
+				// a thickened closed shape is a band between the shape grown and the shape shrunk, reversed
+				_addRawOffset(rawContours, points, true, Math::Abs(amount), joinType, miterLimit, numSegCircle);
+				std::reverse(points.begin(), points.end());
+				_addRawOffset(rawContours, points, true, Math::Abs(amount), joinType, miterLimit, numSegCircle);
+			}
+		}
+		return rawContours.booleanUnion(MultiShape(), WR_POSITIVE, gridResolution);
+	}
+
 }
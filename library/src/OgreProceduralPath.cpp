@@ -62,38 +62,90 @@ namespace OgreProcedural
 		}
 	}*/
 
-	Path Path::mergeKeysWithTrack(const Track& track)
+	Path& Path::setPoint(unsigned int i, const Vector3& pt)
 	{
-		if (!track.isInsertPoint() || track.getAddressingMode() == Track::AM_POINT)
+		mPoints[i] = pt;
+		for (size_t k = std::max(i, 1u); k < mPoints.size(); k++)
+			mLengths[k] = mLengths[k-1]+(mPoints[k]-mPoints[k-1]).length();
+		return *this;
+	}
+
+	Path Path::mergeKeysWithTrack(const Track& track) const
+	{
+		if (!track.isInsertPoint() || track.getAddressingMode() == Track::AM_POINT || mPoints.empty())
 			return *this;
 		Real totalLength=getTotalLength();
+		if (totalLength<=0.)
+			return *this;
+		// keys are converted to lineic positions along the path
+		Real keyScale = (track.getAddressingMode()==Track::AM_RELATIVE_LINEIC)?totalLength:1.;
 
-		Real lineicPos = 0;
-		Real pathLineicPos = 0;
+		// keys and segments are both sorted, so they are gone through together
 		Path outputPath;
-		outputPath.addPoint(getPoint(0));
-		for (unsigned int i = 1; i < mPoints.size(); )
+		size_t key = 0;
+		for (int i = 0; i < getSegCount(); i++)
 		{
-			Real nextLineicPos = pathLineicPos + (mPoints[i] - mPoints[i-1]).length();
+			outputPath.addPoint(mPoints[i]);
+			Real segmentStart = getLengthAtPoint(i);
+			Real segmentEnd = getLengthAtPoint(i+1);
+			while (key < track.getKeyCount() && track.getKey(key) <= segmentStart/keyScale)
+				key++;
+			for (; key < track.getKeyCount() && track.getKey(key)*keyScale < segmentEnd; key++)
+				outputPath.addPoint(getPosition(i, (track.getKey(key)*keyScale-segmentStart)/(segmentEnd-segmentStart)));
+		}
+		if (mClosed)
+			outputPath.close();
+		else
+			outputPath.addPoint(mPoints.back());
+		return outputPath;
+	}
 
-			std::map<Real,Real>::const_iterator it = track._getKeyValueAfter(lineicPos, lineicPos/totalLength, i-1);
-			if (nextLineicPos<=it->first || lineicPos>=it->first)
-			{
-				outputPath.addPoint(mPoints[i]);
-				i++;
-				lineicPos = nextLineicPos;
-				pathLineicPos = nextLineicPos;
-			}
+	Path& Path::simplify(Real tolerance, const Track* track, const Track* otherTrack)
+	{
+		std::vector<bool> locked;
+		if (track)
+			_lockTrackKeys(*track, locked);
+		if (otherTrack)
+			_lockTrackKeys(*otherTrack, locked);
+		std::vector<bool> kept;
+		_simplifyPolyline(mPoints, mClosed, tolerance, locked, kept);
+
+		size_t numKept = 0;
+		for (size_t i=0;i<mPoints.size();i++)
+			if (kept[i])
+				mPoints[numKept++] = mPoints[i];
+		mPoints.resize(numKept);
+		mLengths.resize(numKept);
+		for (size_t i=1;i<numKept;i++)
+			mLengths[i] = mLengths[i-1]+(mPoints[i]-mPoints[i-1]).length();
+		return *this;
+	}
+
+	void Path::_lockTrackKeys(const Track& track, std::vector<bool>& locked) const
+	{
+		if (mPoints.empty() || track.getKeyCount() == 0)
+			return;
+		locked.resize(mPoints.size(), false);
+		if (track.getAddressingMode() == Track::AM_POINT)
+		{
+			// indices of the points must not change up to the last key
+			int lastKey = (int)track.getKey(track.getKeyCount()-1);
+			for (int i=0;i<=std::min(lastKey, (int)mPoints.size()-1);i++)
+				locked[i] = true;
+			return;
+		}
+		Real keyScale = (track.getAddressingMode()==Track::AM_RELATIVE_LINEIC)?getTotalLength():1.;
+		unsigned int cursor = 0;
+		for (size_t key = 0; key < track.getKeyCount(); key++)
+		{
+			// the closest point to the key is kept
+			Real keyPos = track.getKey(key)*keyScale;
+			getPosition(keyPos, cursor);
+			if (getLengthAtPoint(cursor+1)-keyPos < keyPos-getLengthAtPoint(cursor))
+				locked[(cursor+1)%mPoints.size()] = true;
 			else
-			{
-				Real trackLineicPos = it->first;
-				if (track.getAddressingMode()==Track::AM_RELATIVE_LINEIC)
-					trackLineicPos*=totalLength;
-				outputPath.addPoint(getPosition(i-1, (trackLineicPos-pathLineicPos)/(nextLineicPos-pathLineicPos)));
-				lineicPos = trackLineicPos;
-			}
+				locked[cursor] = true;
 		}
-		return outputPath;
 	}
 
 	Ogre::MeshPtr Path::realizeMesh(const std::string& name)
@@ -116,30 +168,54 @@ namespace OgreProcedural
 		return mesh;
 	}
 
+	unsigned int Path::_findSegment(Ogre::Real coord) const
+	{
+		// the segment starts at the last point whose lineic position isn't beyond coord
+		unsigned int i = std::upper_bound(mLengths.begin(), mLengths.end(), coord) - mLengths.begin();
+		i = (i==0)?0:i-1;
+		return std::min(i, (unsigned int)getSegCount()-1);
+	}
+
 	Ogre::Vector3 Path::getPosition(Ogre::Real coord) const
+	{
+		unsigned int cursor = 0;
+		return getPosition(coord, cursor);
+	}
+
+	Ogre::Vector3 Path::getPosition(Ogre::Real coord, unsigned int& cursor) const
 	{
 		assert(mPoints.size()>=2 && "The path must at least contain 2 points");
-		unsigned int i = 0;
-		while(true)
+		Real totalLength = getTotalLength();
+		if (mClosed && totalLength>0.)
 		{
-			Ogre::Real nextLen = (getPoint(i+1) - getPoint(i)).length();
-			if (coord>nextLen)
-				coord-=nextLen;
-			else
-				return getPosition(i, coord/nextLen);
-			if (!mClosed && i>= mPoints.size() - 2)
-				return mPoints.back();
-			i++;
+			coord = fmod(coord, totalLength);
+			if (coord<0.)
+				coord += totalLength;
 		}
-	}
+		else
+			coord = Math::Clamp(coord, (Real)0., totalLength);
 
-	Ogre::Real Path::getTotalLength() const
-	{
-		Ogre::Real length = 0;
-		for (unsigned int i = 0; i < mPoints.size() - 1; ++i)
-			length+=(mPoints[i+1]-mPoints[i]).length();
-		if (mClosed)
-			length+=(mPoints.back()-*mPoints.begin()).length();
-		return length;
+		// Walk from the cursor if it's close enough, otherwise go for a binary search
+		unsigned int numSegs = getSegCount();
+		if (cursor>=numSegs)
+			cursor = 0;
+		for (int steps=0;;steps++)
+		{
+			if (steps==8)
+			{
+				cursor = _findSegment(coord);
+				break;
+			}
+			if (coord<getLengthAtPoint(cursor))
+				cursor--;
+			else if (cursor+1<numSegs && coord>=getLengthAtPoint(cursor+1))
+				cursor++;
+			else
+				break;
+		}
+		Real segmentLength = getLengthAtPoint(cursor+1)-getLengthAtPoint(cursor);
+		if (segmentLength<=0.)
+			return getPoint(cursor);
+		return getPosition(cursor, std::min((Real)1., (coord-getLengthAtPoint(cursor))/segmentLength));
 	}
 }
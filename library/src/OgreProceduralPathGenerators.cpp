@@ -33,8 +33,8 @@ namespace OgreProcedural
 //-----------------------------------------------------------------------
 Path CatmullRomSpline3::realizePath()
 	{
-		Path path;
-
+		// A Catmull-Rom spline is a Hermite spline whose tangents go from the previous point to the next one
+		std::vector<HermiteCurve<Ogre::Vector3> > curves;
 		unsigned int numPoints = mClosed ? mPoints.size() : (mPoints.size()-1);
 		for (unsigned int i=0; i < numPoints; ++i)
 		{
@@ -42,24 +42,8 @@ Path CatmullRomSpline3::realizePath()
 			const Ogre::Vector3& P2 = safeGetPoint(i);
 			const Ogre::Vector3& P3 = safeGetPoint(i+1);
 			const Ogre::Vector3& P4 = safeGetPoint(i+2);
-
-			for (unsigned int j = 0; j < mNumSeg; ++j)
-			{
-				Ogre::Real t = (Ogre::Real)j/(Ogre::Real)mNumSeg;
-				Ogre::Real t2 = t*t;
-				Ogre::Real t3 = t*t2;
-				Ogre::Vector3 P = 0.5f*((-t3+2.f*t2-t)*P1 + (3.f*t3-5.f*t2+2.f)*P2 + (-3.f*t3+4.f*t2+t)*P3 + (t3-t2)*P4);
-				path.addPoint(P);
-			}
-			if (i == mPoints.size() - 2 && !mClosed)
-			{
-				path.addPoint(P3);
-			}
-
+			curves.push_back(HermiteCurve<Ogre::Vector3>(P2, 0.5f*(P3-P1), P3, 0.5f*(P4-P2)));
 		}
-		if (mClosed)
-			path.close();
-
-		return path;
+		return _realizePath(curves);
 	}
 }
@@ -0,0 +1,195 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#include "OgreProceduralStableHeaders.h"
+#include "OgreProceduralPointInsideIndex.h"
+
+using namespace Ogre;
+
+namespace OgreProcedural
+{
+//-----------------------------------------------------------------------
+PointInsideIndex& PointInsideIndex::build(const MultiShape& multiShape)
+{
+	// Horizontal segments never cross the horizontal line of a point, so they are left out
+	mSegments.clear();
+	for (int k=0;k<multiShape.getShapeCount();k++)
+	{
+		const Shape& shape = multiShape.getShape(k);
+		for (size_t i=0;i<shape.getSegCount();i++)
+		{
+			Segment segment;
+			segment.a = shape.getPoint(i);
+			segment.b = shape.getPoint(i+1);
+			if (segment.a.y==segment.b.y)
+				continue;
+			segment.normalA = shape.getAvgNormal(i);
+			segment.normalB = shape.getAvgNormal(i+1);
+			segment.normal = shape.getNormalAfter(i);
+			mSegments.push_back(segment);
+		}
+	}
+	// the shapes must not contradict each other about outside, so just ask the first shape
+	mOutsideIsInside = multiShape.getShapeCount()>0 && multiShape.getShape(0).findRealOutSide()!=multiShape.getShape(0).getOutSide();
+	mCellStarts.clear();
+	mCellSegments.clear();
+	mNumColumns = mNumRows = 0;
+	if (mSegments.empty())
+		return *this;
+
+	// Choose square cells, so that there are about mCellsPerSegment cells per segment
+	mMin = mMax = mSegments[0].a;
+	for (std::vector<Segment>::const_iterator it = mSegments.begin(); it!=mSegments.end(); it++)
+	{
+		mMin.makeFloor(it->a);
+		mMin.makeFloor(it->b);
+		mMax.makeCeil(it->a);
+		mMax.makeCeil(it->b);
+	}
+	Vector2 size = mMax-mMin;
+	Real numCells = std::max((Real)1., mCellsPerSegment*mSegments.size());
+	Real maxCellsPerAxis = std::min(numCells, (Real)4096.);
+	if (size.x>0.)
+	{
+		Real cellSize = Math::Sqrt(size.x*size.y/numCells);
+		mNumColumns = (int)Math::Clamp(Math::Ceil(size.x/cellSize), (Real)1., maxCellsPerAxis);
+		mNumRows = (int)Math::Clamp(Math::Ceil(size.y/cellSize), (Real)1., maxCellsPerAxis);
+	}
+	else
+	{
+		mNumColumns = 1;
+		mNumRows = (int)maxCellsPerAxis;
+	}
+	mCellScale = Vector2(size.x>0.?mNumColumns/size.x:0., mNumRows/size.y);
+
+	// Find the cells crossed by each segment, row by row.
+	// Rows and columns are slightly enlarged so that rounding errors can't leave a segment out of a cell it touches.
+	std::vector<std::pair<int, int> > cellsAndSegments;
+	Real marginX = size.x*1e-5f;
+	Real marginY = size.y*1e-5f;
+	for (size_t s=0;s<mSegments.size();s++)
+	{
+		const Segment& segment = mSegments[s];
+		Real segmentMinY = std::min(segment.a.y, segment.b.y);
+		Real segmentMaxY = std::max(segment.a.y, segment.b.y);
+		int lastRow = _getRow(segmentMaxY);
+		for (int r=_getRow(segmentMinY);r<=lastRow;r++)
+		{
+			Real y0 = std::max(segmentMinY, mMin.y+r/mCellScale.y-marginY);
+			Real y1 = std::min(segmentMaxY, mMin.y+(r+1)/mCellScale.y+marginY);
+			Real x0 = segment.a.x+(y0-segment.a.y)*(segment.b.x-segment.a.x)/(segment.b.y-segment.a.y);
+			Real x1 = segment.a.x+(y1-segment.a.y)*(segment.b.x-segment.a.x)/(segment.b.y-segment.a.y);
+			int lastColumn = _getColumn(std::max(x0, x1)+marginX);
+			for (int c=_getColumn(std::min(x0, x1)-marginX);c<=lastColumn;c++)
+				cellsAndSegments.push_back(std::make_pair(r*mNumColumns+c, (int)s));
+		}
+	}
+	std::sort(cellsAndSegments.begin(), cellsAndSegments.end());
+	mCellStarts.assign((size_t)mNumColumns*mNumRows+1, 0);
+	mCellSegments.resize(cellsAndSegments.size());
+	for (size_t i=0;i<cellsAndSegments.size();i++)
+	{
+		mCellStarts[cellsAndSegments[i].first+1]++;
+		mCellSegments[i] = cellsAndSegments[i].second;
+	}
+	for (size_t c=0;c+1<mCellStarts.size();c++)
+		mCellStarts[c+1] += mCellStarts[c];
+	return *this;
+}
+//-----------------------------------------------------------------------
+bool PointInsideIndex::isPointInside(const Vector2& point) const
+{
+	if (mSegments.empty() || point.y<mMin.y || point.y>mMax.y)
+		return mOutsideIsInside;
+
+	// Look for the closest intersection of the horizontal line with the segments,
+	// going through the cells of the row of the point, from the closest to the farthest.
+	// Equally close intersections are settled by the order of the segments, as MultiShape::isPointInside() does.
+	int row = _getRow(point.y);
+	int column = _getColumn(point.x);
+	int closestSegmentIndex = -1;
+	Real closestSegmentDistance = std::numeric_limits<Real>::max();
+	Vector2 closestSegmentIntersection;
+	Real margin = (mMax.x-mMin.x)*1e-5f;
+	for (int d=0;column-d>=0 || column+d<mNumColumns;d++)
+	{
+		for (int side=0;side<2;side++)
+		{
+			int c = (side==0)?column-d:column+d;
+			if (c<0 || c>=mNumColumns || (side==1 && d==0))
+				continue;
+			size_t cell = (size_t)row*mNumColumns+c;
+			for (size_t i=mCellStarts[cell];i<mCellStarts[cell+1];i++)
+			{
+				int s = mCellSegments[i];
+				const Vector2& A = mSegments[s].a;
+				const Vector2& B = mSegments[s].b;
+				if ((A.y-point.y)*(B.y-point.y)<=0.)
+				{
+					Vector2 intersect(A.x+(point.y-A.y)*(B.x-A.x)/(B.y-A.y), point.y);
+					Real dist = Math::Abs(point.x-intersect.x);
+					if (dist<closestSegmentDistance || (dist==closestSegmentDistance && s<closestSegmentIndex))
+					{
+						closestSegmentIndex = s;
+						closestSegmentDistance = dist;
+						closestSegmentIntersection = intersect;
+					}
+				}
+			}
+		}
+		// Stop as soon as the cells left to visit are farther than the closest intersection
+		if (closestSegmentIndex!=-1)
+		{
+			Real reach = std::numeric_limits<Real>::max();
+			if (column-d>0)
+				reach = std::min(reach, point.x-(mMin.x+(column-d)/mCellScale.x));
+			if (column+d+1<mNumColumns)
+				reach = std::min(reach, mMin.x+(column+d+1)/mCellScale.x-point.x);
+			if (closestSegmentDistance<reach-margin)
+				break;
+		}
+	}
+	if (closestSegmentIndex==-1)
+		return mOutsideIsInside;
+	const Segment& segment = mSegments[closestSegmentIndex];
+	if (closestSegmentIntersection.squaredDistance(segment.a)<1e-8)
+		return (segment.normalA.x * (point.x-closestSegmentIntersection.x)<0);
+	if (closestSegmentIntersection.squaredDistance(segment.b)<1e-8)
+		return (segment.normalB.x * (point.x-closestSegmentIntersection.x)<0);
+	return (segment.normal.x * (point.x-closestSegmentIntersection.x)<0);
+}
+//-----------------------------------------------------------------------
+void PointInsideIndex::isPointInside(const Vector2* points, size_t numPoints, bool* results, unsigned int numThreads) const
+{
+	// Each thread tests a contiguous range of points
+	Utils::_parallelFor(numPoints, numThreads, 4096, [=](size_t first, size_t last)
+	{
+		for (size_t i=first;i<last;i++)
+			results[i] = isPointInside(points[i]);
+	});
+}
+}
@@ -0,0 +1,84 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#include "OgreProceduralStableHeaders.h"
+#include "OgreProceduralProfileTable.h"
+
+using namespace Ogre;
+
+namespace OgreProcedural
+{
+//-----------------------------------------------------------------------
+ProfileTable::ProfileTable(const Shape& shape, bool flipNormals)
+{
+	size_t numSeg = shape.getSegCount();
+	mX.resize(numSeg+1);
+	mY.resize(numSeg+1);
+	mNormalX.resize(numSeg+1);
+	mNormalY.resize(numSeg+1);
+	mV.resize(numSeg+1);
+	for (size_t j=0;j<=numSeg;j++)
+	{
+		Vector2 point = shape.getPoint(j);
+		Vector2 normal = shape.getAvgNormal(j);
+		if (flipNormals)
+			normal = -normal;
+		mX[j] = point.x;
+		mY[j] = point.y;
+		mNormalX[j] = normal.x;
+		mNormalY[j] = normal.y;
+		mV[j] = j/(Real)numSeg;
+	}
+}
+//-----------------------------------------------------------------------
+void ProfileTable::placeRing(const Vector3& position, const Quaternion& orientation, Real scale,
+	Real* const positions[3], Real* const normals[3]) const
+{
+	// The profile lies in the XY plane, so only the first two columns of the rotation are needed
+	Vector3 xAxis = orientation.xAxis();
+	Vector3 yAxis = orientation.yAxis();
+	size_t size = mX.size();
+	const Real* x = &mX[0];
+	const Real* y = &mY[0];
+	const Real* normalX = &mNormalX[0];
+	const Real* normalY = &mNormalY[0];
+	for (int k=0;k<3;k++)
+	{
+		Real origin = position[k];
+		Real ax = scale*xAxis[k];
+		Real ay = scale*yAxis[k];
+		Real nx = xAxis[k];
+		Real ny = yAxis[k];
+		Real* p = positions[k];
+		Real* n = normals[k];
+		for (size_t j=0;j<size;j++)
+			p[j] = origin + ax*x[j] + ay*y[j];
+		for (size_t j=0;j<size;j++)
+			n[j] = nx*normalX[j] + ny*normalY[j];
+	}
+}
+}
@@ -37,9 +37,10 @@ namespace OgreProcedural
 //-----------------------------------------------------------------------
 Side Shape::findRealOutSide() const
 {
+	_applyTransform();
 	float x = mPoints[0].x;
 	int index=0;
-	for (unsigned short i=1;i<mPoints.size();i++)
+	for (size_t i=1;i<mPoints.size();i++)
 	{
 		if (x<mPoints[i].x)
 		{
@@ -55,59 +56,133 @@ Side Shape::findRealOutSide() const
 		return SIDE_LEFT;
 }
 //-----------------------------------------------------------------------
-void Shape::_findAllIntersections(const Shape& other, std::vector<IntersectionInShape>& intersections) const
+void Shape::_findAllIntersections(const Shape& other, BooleanWorkspace& ws) const
 {
-	for (unsigned short i=0; i<getSegCount(); i++)
+	std::vector<IntersectionInShape>& intersections = ws.mIntersections;
+	std::vector<SweepSegment>& segments = ws.mSweepSegments;
+	std::vector<std::pair<int, int> >& candidates = ws.mCandidatePairs;
+	intersections.clear();
+	segments.clear();
+	candidates.clear();
+
+	// Only segments overlapping both shapes' bounding boxes can intersect
+	const Shape* shapes[2] = {this, &other};
+	Vector2 boxMin[2], boxMax[2];
+	for (int k=0;k<2;k++)
 	{
-		Segment2D seg1(getPoint(i), getPoint(i+1));
+		boxMin[k] = boxMax[k] = shapes[k]->mPoints[0];
+		for (size_t i=1;i<shapes[k]->mPoints.size();i++)
+		{
+			boxMin[k].makeFloor(shapes[k]->mPoints[i]);
+			boxMax[k].makeCeil(shapes[k]->mPoints[i]);
+		}
+	}
+	Vector2 overlapMin = boxMin[0], overlapMax = boxMax[0];
+	overlapMin.makeCeil(boxMin[1]);
+	overlapMax.makeFloor(boxMax[1]);
+	if (overlapMin.x>overlapMax.x || overlapMin.y>overlapMax.y)
+		return;
 
-		for (unsigned short j=0; j<other.getSegCount(); j++)
+	for (int k=0;k<2;k++)
+	{
+		const Shape& shape = *shapes[k];
+		for (size_t i=0;i<shape.getSegCount();i++)
 		{
-			Segment2D seg2(other.getPoint(j), other.getPoint(j+1));
+			const Vector2& a = shape.getPoint(i);
+			const Vector2& b = shape.getPoint(i+1);
+			SweepSegment seg;
+			seg.minX = std::min(a.x, b.x);
+			seg.maxX = std::max(a.x, b.x);
+			seg.minY = std::min(a.y, b.y);
+			seg.maxY = std::max(a.y, b.y);
+			if (seg.maxX<overlapMin.x || seg.minX>overlapMax.x || seg.maxY<overlapMin.y || seg.minY>overlapMax.y)
+				continue;
+			seg.shape = k;
+			seg.index = i;
+			segments.push_back(seg);
+		}
+	}
 
-			Vector2 intersect;
-			if (seg1.findIntersect(seg2, intersect))
+	// Sweep along X : each segment is tested against the segments of the other shape it overlaps on X
+	std::sort(segments.begin(), segments.end());
+	ws.mActiveSegments[0].clear();
+	ws.mActiveSegments[1].clear();
+	for (size_t s=0;s<segments.size();s++)
+	{
+		const SweepSegment& seg = segments[s];
+		std::vector<int>& active = ws.mActiveSegments[1-seg.shape];
+		for (size_t a=0;a<active.size();)
+		{
+			const SweepSegment& activeSeg = segments[active[a]];
+			if (activeSeg.maxX<seg.minX)
 			{
-				IntersectionInShape inter(i, j, intersect);
-				// check if intersection is "borderline" : too near to a vertex
-				if (seg1.getA().squaredDistance(intersect)<1e-8)
-				{
-					inter.onVertex[0] = true;
-				}
-				if (seg1.getB().squaredDistance(intersect)<1e-8)
-				{
-					inter.onVertex[0] = true;
-					inter.index[0]++;
-				}
-				if (seg2.getA().squaredDistance(intersect)<1e-8)
-				{
-					inter.onVertex[1] = true;
-				}
-				if (seg2.getB().squaredDistance(intersect)<1e-8)
-				{
-					inter.onVertex[1] = true;
-					inter.index[1]++;
-				}
+				// the sweep line has left that segment
+				active[a] = active.back();
+				active.pop_back();
+				continue;
+			}
+			if (activeSeg.maxY>=seg.minY && activeSeg.minY<=seg.maxY)
+			{
+				if (seg.shape==0)
+					candidates.push_back(std::make_pair(seg.index, activeSeg.index));
+				else
+					candidates.push_back(std::make_pair(activeSeg.index, seg.index));
+			}
+			a++;
+		}
+		ws.mActiveSegments[seg.shape].push_back(s);
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	for (std::vector<std::pair<int, int> >::iterator it = candidates.begin(); it!=candidates.end(); it++)
+	{
+		int i = it->first;
+		int j = it->second;
+		Segment2D seg1(getPoint(i), getPoint(i+1));
+		Segment2D seg2(other.getPoint(j), other.getPoint(j+1));
 
-				intersections.push_back(inter);
+		Vector2 intersect;
+		if (seg1.findIntersect(seg2, intersect))
+		{
+			IntersectionInShape inter(i, j, intersect);
+			// check if intersection is "borderline" : too near to a vertex
+			if (seg1.getA().squaredDistance(intersect)<1e-8)
+			{
+				inter.onVertex[0] = true;
 			}
+			if (seg1.getB().squaredDistance(intersect)<1e-8)
+			{
+				inter.onVertex[0] = true;
+				inter.index[0]++;
+			}
+			if (seg2.getA().squaredDistance(intersect)<1e-8)
+			{
+				inter.onVertex[1] = true;
+			}
+			if (seg2.getB().squaredDistance(intersect)<1e-8)
+			{
+				inter.onVertex[1] = true;
+				inter.index[1]++;
+			}
+
+			intersections.push_back(inter);
 		}
 	}
 }
 //-----------------------------------------------------------------------
-MultiShape Shape::booleanUnion(const Shape& other) const
+MultiShape Shape::booleanUnion(const Shape& other, BooleanWorkspace* workspace) const
 {
-	return _booleanOperation(other, BOT_UNION);
+	return _booleanOperation(other, BOT_UNION, workspace);
 }
 //-----------------------------------------------------------------------
-MultiShape Shape::booleanIntersect(const Shape& other) const
+MultiShape Shape::booleanIntersect(const Shape& other, BooleanWorkspace* workspace) const
 {
-	return _booleanOperation(other, BOT_INTERSECTION);
+	return _booleanOperation(other, BOT_INTERSECTION, workspace);
 }
 //-----------------------------------------------------------------------
-MultiShape Shape::booleanDifference(const Shape& other) const
+MultiShape Shape::booleanDifference(const Shape& other, BooleanWorkspace* workspace) const
 {
-	return _booleanOperation(other, BOT_DIFFERENCE);
+	return _booleanOperation(other, BOT_DIFFERENCE, workspace);
 }
 //-----------------------------------------------------------------------
 bool Shape::_isLookingForOutside(BooleanOperationType opType, char shapeSelector) const
@@ -222,14 +297,39 @@ bool Shape::_findWhereToGo(const Shape* inputShapes[], BooleanOperationType opTy
 	}
 }
 //-----------------------------------------------------------------------
-MultiShape Shape::_booleanOperation(const Shape& other, BooleanOperationType opType) const
+void Shape::findIntersections(const Shape& other, std::vector<Vector2>& intersections, BooleanWorkspace* workspace) const
+{
+	intersections.clear();
+	if (mPoints.size()<2 || other.mPoints.size()<2)
+		return;
+	BooleanWorkspace localWorkspace;
+	BooleanWorkspace& ws = workspace?*workspace:localWorkspace;
+	_applyTransform();
+	other._applyTransform();
+	_findAllIntersections(other, ws);
+	for (std::vector<IntersectionInShape>::const_iterator it = ws.mIntersections.begin(); it!=ws.mIntersections.end(); it++)
+		intersections.push_back(it->position);
+	ws._endCall();
+}
+MultiShape Shape::_booleanOperation(const Shape& other, BooleanOperationType opType, BooleanWorkspace* workspace) const
+{
+	BooleanWorkspace localWorkspace;
+	BooleanWorkspace& ws = workspace?*workspace:localWorkspace;
+	MultiShape result = _booleanOperationImpl(other, opType, ws);
+	ws._endCall();
+	return result;
+}
+//-----------------------------------------------------------------------
+MultiShape Shape::_booleanOperationImpl(const Shape& other, BooleanOperationType opType, BooleanWorkspace& ws) const
 {
 	assert(mClosed && other.mClosed);
+	_applyTransform();
+	other._applyTransform();
 	assert(mPoints.size()>1 && other.mPoints.size()>1);
 
 	// Compute the intersection between the 2 shapes
-	std::vector<IntersectionInShape> intersections;
-	_findAllIntersections(other, intersections);
+	_findAllIntersections(other, ws);
+	std::vector<IntersectionInShape>& intersections = ws.mIntersections;
 
 	// Build the resulting shape
 	if (intersections.empty())
@@ -286,9 +386,13 @@ MultiShape Shape::_booleanOperation(const Shape& other, BooleanOperationType opT
 	inputShapes[0]=this;
 	inputShapes[1]=&other;
 
+	// Output points are gathered in the workspace, and then copied to the resulting shape in one go
+	Shape outputShape;
+	outputShape.mPoints.swap(ws.mOutputPoints);
 	while (!intersections.empty())
 	{
-		Shape outputShape;
+		outputShape.reset();
+		outputShape.mClosed = false;
 		uint8 shapeSelector = 0; // 0 : first shape, 1 : second shape
 
 		Vector2 currentPosition = intersections.begin()->position;
@@ -376,9 +480,94 @@ MultiShape Shape::_booleanOperation(const Shape& other, BooleanOperationType opT
 
 		outputMultiShape.addShape(outputShape);
 	}
+	outputShape.mPoints.swap(ws.mOutputPoints);
 	return outputMultiShape;
 }
 //-----------------------------------------------------------------------
+void Shape::_updateLengths() const
+{
+	mLengths.resize(mPoints.size());
+	Real length = 0.;
+	for (size_t i=0;i<mPoints.size();i++)
+	{
+		if (i>0)
+			length += (mPoints[i]-mPoints[i-1]).length();
+		mLengths[i] = length;
+	}
+}
+//-----------------------------------------------------------------------
+void Shape::_flushTransform() const
+{
+	// Threads which read the shape at the same time wait for the first one to apply the transform
+	std::lock_guard<std::mutex> lock(mTransformMutex);
+	if (!mHasTransform)
+		return;
+	const Real xx = mTransformX.x, xy = mTransformX.y;
+	const Real yx = mTransformY.x, yy = mTransformY.y;
+	const Real ox = mTransformOffset.x, oy = mTransformOffset.y;
+	for (std::vector<Vector2>::iterator it = mPoints.begin(); it!=mPoints.end(); it++)
+	{
+		Real x = it->x;
+		Real y = it->y;
+		it->x = xx * x + yx * y + ox;
+		it->y = xy * x + yy * y + oy;
+	}
+	if (!mTransformKeepsLengths)
+		_updateLengths();
+	mHasTransform = false;
+}
+//-----------------------------------------------------------------------
+unsigned int Shape::_findSegment(Real coord) const
+{
+	// the segment starts at the last point whose lineic position isn't beyond coord
+	unsigned int i = std::upper_bound(mLengths.begin(), mLengths.end(), coord) - mLengths.begin();
+	i = (i==0)?0:i-1;
+	return std::min(i, (unsigned int)getSegCount()-1);
+}
+//-----------------------------------------------------------------------
+Vector2 Shape::getPosition(Real coord) const
+{
+	unsigned int cursor = 0;
+	return getPosition(coord, cursor);
+}
+//-----------------------------------------------------------------------
+Vector2 Shape::getPosition(Real coord, unsigned int& cursor) const
+{
+	assert(mPoints.size()>=2 && "The shape must at least contain 2 points");
+	Real totalLength = getTotalLength();
+	if (mClosed && totalLength>0.)
+	{
+		coord = fmod(coord, totalLength);
+		if (coord<0.)
+			coord += totalLength;
+	}
+	else
+		coord = Math::Clamp(coord, (Real)0., totalLength);
+
+	// Walk from the cursor if it's close enough, otherwise go for a binary search
+	unsigned int numSegs = getSegCount();
+	if (cursor>=numSegs)
+		cursor = 0;
+	for (int steps=0;;steps++)
+	{
+		if (steps==8)
+		{
+			cursor = _findSegment(coord);
+			break;
+		}
+		if (coord<getLengthAtPoint(cursor))
+			cursor--;
+		else if (cursor+1<numSegs && coord>=getLengthAtPoint(cursor+1))
+			cursor++;
+		else
+			break;
+	}
+	Real segmentLength = getLengthAtPoint(cursor+1)-getLengthAtPoint(cursor);
+	if (segmentLength<=0.)
+		return getPoint(cursor);
+	return getPosition(cursor, std::min((Real)1., (coord-getLengthAtPoint(cursor))/segmentLength));
+}
+//-----------------------------------------------------------------------
 bool Shape::isPointInside(const Vector2& point) const
 {
 	// Draw a horizontal lines that goes through "point"
@@ -394,7 +583,7 @@ bool Shape::isPointInside(const Vector2& point) const
 		if (A.y!=B.y && (A.y-point.y)*(B.y-point.y)<=0.)
 		{
 			Vector2 intersect(A.x+(point.y-A.y)*(B.x-A.x)/(B.y-A.y), point.y);
-			float dist = abs(point.x-intersect.x);
+			Real dist = Math::Abs(point.x-intersect.x);
 			if (dist<closestSegmentDistance)
 			{
 				closestSegmentIndex = i;
@@ -435,41 +624,44 @@ MeshPtr Shape::realizeMesh(const std::string& name)
 //-----------------------------------------------------------------------
 void Shape::_appendToManualObject(ManualObject* manual)
 {
+	_applyTransform();
 	for (std::vector<Vector2>::iterator itPos = mPoints.begin(); itPos != mPoints.end();itPos++)
 		manual->position(Vector3(itPos->x, itPos->y, 0.f));
 	if (mClosed)
 		manual->position(Vector3(mPoints.begin()->x, mPoints.begin()->y, 0.f));
 }
 //-----------------------------------------------------------------------
-MultiShape Shape::thicken(Real amount)
-	{
-		if (!mClosed)
-		{
-			Shape s;
-			s.setOutSide(mOutSide);
-			for (unsigned int i=0;i<mPoints.size();i++)
-				s.addPoint(mPoints[i]+amount*getAvgNormal(i));
-			for (int i=mPoints.size()-1;i>=0;i--)
-				s.addPoint(mPoints[i]-amount*getAvgNormal(i));
-			s.close();
-			return MultiShape().addShape(s);
-		}
-		else
-		{
-			MultiShape ms;
-			Shape s1;
-			for (unsigned int i=0;i<mPoints.size();i++)
-				s1.addPoint(mPoints[i]+amount*getAvgNormal(i));
-			s1.close();
-			s1.setOutSide(mOutSide);
-			ms.addShape(s1);
-			Shape s2;
-			for (unsigned int i=0;i<mPoints.size();i++)
-				s2.addPoint(mPoints[i]-amount*getAvgNormal(i));
-			s2.close();
-			s2.setOutSide(mOutSide==SIDE_LEFT?SIDE_RIGHT:SIDE_LEFT);
-			ms.addShape(s2);
-			return ms;
-		}
-	}
+Shape& Shape::simplify(Real tolerance)
+{
+	_applyTransform();
+	SimplificationIndex index;
+	index.addPolyline(mPoints, mClosed);
+	index.build();
+	_simplify(tolerance, index, 0);
+	return *this;
+}
+//-----------------------------------------------------------------------
+void Shape::_simplify(Real tolerance, SimplificationIndex& index, int polyline)
+{
+	_applyTransform();
+	std::vector<bool> kept;
+	SimplificationIndex::PolylineCheck check(index, polyline);
+	_simplifyPolyline(mPoints, mClosed, tolerance, std::vector<bool>(), kept, check);
+	size_t numKept = 0;
+	for (size_t i=0;i<mPoints.size();i++)
+		if (kept[i])
+			mPoints[numKept++] = mPoints[i];
+	mPoints.resize(numKept);
+	_updateLengths();
+}
+//-----------------------------------------------------------------------
+MultiShape Shape::thicken(Real amount, JoinType joinType, Real miterLimit, unsigned int numSegCircle) const
+{
+	return MultiShape(*this).thicken(amount, joinType, miterLimit, numSegCircle);
+}
+//-----------------------------------------------------------------------
+MultiShape Shape::offset(Real amount, JoinType joinType, Real miterLimit, unsigned int numSegCircle) const
+{
+	return MultiShape(*this).offset(amount, joinType, miterLimit, numSegCircle);
+}
 }
@@ -33,40 +33,17 @@ namespace OgreProcedural
 //-----------------------------------------------------------------------
 Shape CubicHermiteSpline2::realizeShape()
 	{
-	Shape shape;
-
+		std::vector<HermiteCurve<Ogre::Vector2> > curves;
 		unsigned int numPoints = mClosed ? mPoints.size() : (mPoints.size() - 1);
 		for (unsigned int i = 0; i < numPoints; ++i)
-		{
-			const Ogre::Vector2& p0 = mPoints[i].position;
-			const Ogre::Vector2& m0 = mPoints[i].tangentAfter;
-			const Ogre::Vector2& p1 = safeGetPoint(i+1).position;
-			const Ogre::Vector2& m1 = safeGetPoint(i+1).tangentBefore;
-
-			for (unsigned int j = 0; j < mNumSeg; ++j)
-			{
-				Ogre::Real t = (Ogre::Real)j/(Ogre::Real)mNumSeg;
-				Ogre::Real t2 = t*t;
-				Ogre::Real t3 = t2*t;
-				Ogre::Vector2 P = (2*t3-3*t2+1)*p0+(t3-2*t2+t)*m0+(-2*t3+3*t2)*p1+(t3-t2)*m1;
-				shape.addPoint(P);
-			}
-			if (i == mPoints.size() - 2 && !mClosed)
-			{
-				shape.addPoint(p1);
-			}
-		}
-		if (mClosed)
-			shape.close();
-		shape.setOutSide(mOutSide);
-
-		return shape;
+			curves.push_back(HermiteCurve<Ogre::Vector2>(mPoints[i].position, mPoints[i].tangentAfter, safeGetPoint(i+1).position, safeGetPoint(i+1).tangentBefore));
+		return _realizeShape(curves);
 	}
 //-----------------------------------------------------------------------
 Shape CatmullRomSpline2::realizeShape()
 	{
-		Shape shape;
-
+		// A Catmull-Rom spline is a Hermite spline whose tangents go from the previous point to the next one
+		std::vector<HermiteCurve<Ogre::Vector2> > curves;
 		unsigned int numPoints = mClosed ? mPoints.size() : (mPoints.size() - 1);
 		for (unsigned int i = 0; i < numPoints; ++i)
 		{
@@ -74,32 +51,14 @@ Shape CatmullRomSpline2::realizeShape()
 			const Ogre::Vector2& P2 = safeGetPoint(i);
 			const Ogre::Vector2& P3 = safeGetPoint(i+1);
 			const Ogre::Vector2& P4 = safeGetPoint(i+2);
-
-			for (unsigned int j = 0;j < mNumSeg; ++j)
-			{
-				Ogre::Real t = (Ogre::Real)j/(Ogre::Real)mNumSeg;
-				Ogre::Real t2 = t*t;
-				Ogre::Real t3 = t*t2;
-				Ogre::Vector2 P = 0.5f*((-t3+2.f*t2-t)*P1 + (3.f*t3-5.f*t2+2.f)*P2 + (-3.f*t3+4.f*t2+t)*P3 + (t3-t2)*P4);
-				shape.addPoint(P);
-			}
-			if (i == mPoints.size() - 2 && !mClosed)
-			{
-				shape.addPoint(P3);
-			}
-
+			curves.push_back(HermiteCurve<Ogre::Vector2>(P2, 0.5f*(P3-P1), P3, 0.5f*(P4-P2)));
 		}
-		if (mClosed)
-			shape.close();
-		shape.setOutSide(mOutSide);
-
-		return shape;
+		return _realizeShape(curves);
 	}
 //-----------------------------------------------------------------------
 	Shape KochanekBartelsSpline2::realizeShape()
 	{
-		Shape shape;
-
+		std::vector<HermiteCurve<Ogre::Vector2> > curves;
 		unsigned int numPoints = mClosed ? mPoints.size() : (mPoints.size() - 1);
 		for (unsigned int i = 0; i < numPoints; ++i)
 		{
@@ -110,23 +69,8 @@ Shape CatmullRomSpline2::realizeShape()
 
 			Ogre::Vector2 m0 = (1-p0.tension)*(1+p0.bias)*(1+p0.continuity)/2.f*(p0.position-pm1.position)+(1-p0.tension)*(1-p0.bias)*(1-p0.continuity)/2.f*(p1.position-p0.position);
 			Ogre::Vector2 m1 = (1-p1.tension)*(1+p1.bias)*(1-p1.continuity)/2.f*(p1.position-p0.position)+(1-p1.tension)*(1-p1.bias)*(1+p1.continuity)/2.f*(p2.position-p1.position);
-
-			for (unsigned int j = 0; j < mNumSeg; ++j)
-			{
-				Ogre::Real t = (Ogre::Real)j/(Ogre::Real)mNumSeg;
-				Ogre::Real t2 = t*t;
-				Ogre::Real t3 = t2*t;
-				Ogre::Vector2 P = (2*t3-3*t2+1)*p0.position+(t3-2*t2+t)*m0+(-2*t3+3*t2)*p1.position+(t3-t2)*m1;
-				shape.addPoint(P);
-			}
-			if (i==mPoints.size()-2 && !mClosed)
-			{
-				shape.addPoint(p1.position);
-			}
+			curves.push_back(HermiteCurve<Ogre::Vector2>(p0.position, m0, p1.position, m1));
 		}
-		if (mClosed)
-			shape.close();
-		shape.setOutSide(mOutSide);
-		return shape;
+		return _realizeShape(curves);
 	}
 }
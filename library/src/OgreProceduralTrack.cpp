@@ -32,66 +32,157 @@ using namespace Ogre;
 
 namespace OgreProcedural
 {
-	Real Track::getValue(Real pos) const
+	Track& Track::addKeyFrame(Real pos, Real value)
 	{
-		std::map<Real, Real>::const_iterator itAfter = _getKeyValueAfter(pos);
-		std::map<Real, Real>::const_iterator itBefore = _getKeyValueBefore(pos);
-
-		if (itAfter==itBefore)
-			return itBefore->second;
-		if (itAfter==mKeyFrames.begin())
-			return itAfter->second;
-
-		Real x1 = itBefore->first;
-		Real y1 = itBefore->second;
-		Real x2 = itAfter->first;
-		Real y2 = itAfter->second;
-		return (pos-x1)/(x2-x1)*(y2-y1)+y1;
+		// Keys are usually added in order, so look for the place of the new key from the end
+		std::vector<Real>::iterator it = mKeys.end();
+		if (!mKeys.empty() && pos<=mKeys.back())
+			it = std::lower_bound(mKeys.begin(), mKeys.end(), pos);
+		size_t i = it-mKeys.begin();
+		if (it!=mKeys.end() && *it==pos)
+			mValues[i] = value;
+		else
+		{
+			mKeys.insert(it, pos);
+			mValues.insert(mValues.begin()+i, value);
+		}
+		mCoefficientsDirty = true;
+		mLookupTable.clear();
+		return *this;
 	}
 
-	std::map<Real, Real>::const_iterator Track::_getKeyValueBefore(Real pos) const
+	void Track::_updateCoefficients() const
 	{
-		std::map<Real, Real>::const_iterator it = mKeyFrames.upper_bound(pos);
-		if (it==mKeyFrames.begin())
-			return it;
-		else
-			return --it;
+		mCoefficientsDirty = false;
+		mCoefficients.clear();
+		if (mInterpolationMode==IM_LINEAR || mKeys.size()<2)
+			return;
+
+		// Slopes of the segments, then slopes at the keys
+		size_t numSeg = mKeys.size()-1;
+		std::vector<Real> secants(numSeg);
+		for (size_t i=0;i<numSeg;i++)
+			secants[i] = (mValues[i+1]-mValues[i])/(mKeys[i+1]-mKeys[i]);
+		std::vector<Real> slopes(numSeg+1);
+		slopes[0] = secants[0];
+		slopes[numSeg] = secants[numSeg-1];
+		for (size_t i=1;i<numSeg;i++)
+		{
+			if (mInterpolationMode==IM_CATMULL_ROM)
+				slopes[i] = (mValues[i+1]-mValues[i-1])/(mKeys[i+1]-mKeys[i-1]);
+			else if (secants[i-1]*secants[i]<=0)
+				slopes[i] = 0;
+			else
+				slopes[i] = (secants[i-1]+secants[i])/2;
+		}
+		if (mInterpolationMode==IM_MONOTONIC_CUBIC)
+		{
+			// Fritsch-Carlson : slopes are limited so that each segment stays monotonic
+			for (size_t i=0;i<numSeg;i++)
+			{
+				if (secants[i]==0)
+				{
+					slopes[i] = slopes[i+1] = 0;
+					continue;
+				}
+				Real alpha = slopes[i]/secants[i];
+				Real beta = slopes[i+1]/secants[i];
+				Real norm = alpha*alpha+beta*beta;
+				if (norm>9)
+				{
+					Real tau = 3/Math::Sqrt(norm);
+					slopes[i] = tau*alpha*secants[i];
+					slopes[i+1] = tau*beta*secants[i];
+				}
+			}
+		}
+
+		// Hermite basis, expanded into polynomial coefficients
+		mCoefficients.resize(4*numSeg);
+		for (size_t i=0;i<numSeg;i++)
+		{
+			Real h = mKeys[i+1]-mKeys[i];
+			Real y0 = mValues[i];
+			Real y1 = mValues[i+1];
+			Real m0 = slopes[i]*h;
+			Real m1 = slopes[i+1]*h;
+			mCoefficients[4*i] = y0;
+			mCoefficients[4*i+1] = m0;
+			mCoefficients[4*i+2] = 3*(y1-y0)-2*m0-m1;
+			mCoefficients[4*i+3] = 2*(y0-y1)+m0+m1;
+		}
 	}
 
-	std::map<Real, Real>::const_iterator Track::_getKeyValueAfter(Real pos) const
+	Real Track::_interpolate(Real pos, unsigned int segment) const
 	{
-		std::map<Real, Real>::const_iterator it = mKeyFrames.upper_bound(pos);
-		if (it==mKeyFrames.end())
-			return --it;
-		else
-			return it;
+		if (pos<=mKeys[segment])
+			return mValues[segment];
+		if (segment+1>=mKeys.size() || pos>=mKeys[segment+1])
+			return mValues.back();
+
+		Real x1 = mKeys[segment];
+		Real y1 = mValues[segment];
+		Real x2 = mKeys[segment+1];
+		Real y2 = mValues[segment+1];
+		if (mInterpolationMode==IM_LINEAR)
+			return (pos-x1)/(x2-x1)*(y2-y1)+y1;
+
+		if (mCoefficientsDirty)
+			_updateCoefficients();
+		Real t = (pos-x1)/(x2-x1);
+		const Real* c = &mCoefficients[4*segment];
+		return c[0]+t*(c[1]+t*(c[2]+t*c[3]));
 	}
 
-	Real Track::getValue(Real absPos, Real relPos, int index) const
+	Track& Track::bakeLookupTable(unsigned int numSamples)
 	{
-		if (mAddressingMode == AM_ABSOLUTE_LINEIC)
-			return getValue(absPos);
-		if (mAddressingMode == AM_RELATIVE_LINEIC)
-			return getValue(relPos);
-		return getValue(index);
+		assert(!mKeys.empty() && numSamples>=2 && "The track must have keys, and the table at least 2 samples");
+		mLookupTable.clear();
+		Real range = mKeys.back()-mKeys.front();
+		if (range<=0)
+			return *this;
+		std::vector<Real> table(numSamples);
+		unsigned int cursor = 0;
+		for (unsigned int i=0;i<numSamples;i++)
+			table[i] = getValue(mKeys.front()+range*i/(numSamples-1), cursor);
+		mLookupTable.swap(table);
+		mLookupTableScale = (numSamples-1)/range;
+		return *this;
 	}
 
-	std::map<Real, Real>::const_iterator Track::_getKeyValueBefore(Real absPos, Real relPos, int index) const
+	Real Track::getValue(Real pos) const
 	{
-		if (mAddressingMode == AM_ABSOLUTE_LINEIC)
-			return _getKeyValueBefore(absPos);
-		if (mAddressingMode == AM_RELATIVE_LINEIC)
-			return _getKeyValueBefore(relPos);
-		return _getKeyValueBefore(index);
+		unsigned int cursor = 0;
+		return getValue(pos, cursor);
+	}
+
+	Real Track::getValue(Real pos, unsigned int& cursor) const
+	{
+		assert(!mKeys.empty() && "The track must have keys");
+		if (!mLookupTable.empty())
+		{
+			Real u = Math::Clamp((pos-mKeys.front())*mLookupTableScale, (Real)0., (Real)(mLookupTable.size()-1));
+			size_t i = std::min((size_t)u, mLookupTable.size()-2);
+			Real t = u-i;
+			return mLookupTable[i]+t*(mLookupTable[i+1]-mLookupTable[i]);
+		}
+		cursor = _findSegment(pos, cursor);
+		return _interpolate(pos, cursor);
+	}
+
+	Real Track::getValue(Real absPos, Real relPos, int index) const
+	{
+		unsigned int cursor = 0;
+		return getValue(absPos, relPos, index, cursor);
 	}
 
-	std::map<Real, Real>::const_iterator Track::_getKeyValueAfter(Real absPos, Real relPos, int index) const
+	Real Track::getValue(Real absPos, Real relPos, int index, unsigned int& cursor) const
 	{
 		if (mAddressingMode == AM_ABSOLUTE_LINEIC)
-			return _getKeyValueAfter(absPos);
+			return getValue(absPos, cursor);
 		if (mAddressingMode == AM_RELATIVE_LINEIC)
-			return _getKeyValueAfter(relPos);
-		return _getKeyValueAfter(index);
+			return getValue(relPos, cursor);
+		return getValue((Real)index, cursor);
 	}
 
 }
@@ -0,0 +1,142 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#include "OgreProceduralStableHeaders.h"
+#include "OgreProceduralTriangulationCache.h"
+#include <cstring>
+
+using namespace Ogre;
+
+namespace OgreProcedural
+{
+//-----------------------------------------------------------------------
+void TriangulationCache::_buildKey(const MultiShape& multiShape, std::vector<Real>& key)
+{
+	size_t size = 0;
+	for (int k=0;k<multiShape.getShapeCount();k++)
+		size += 3 + 2*multiShape.getShape(k).getPointCount();
+	key.clear();
+	key.reserve(size);
+	for (int k=0;k<multiShape.getShapeCount();k++)
+	{
+		const Shape& shape = multiShape.getShape(k);
+		key.push_back((Real)shape.getPointCount());
+		key.push_back(shape.isClosed()?1.f:0.f);
+		key.push_back(shape.getOutSide()==SIDE_LEFT?0.f:1.f);
+		const std::vector<Vector2>& points = shape.getPointsReference();
+		for (std::vector<Vector2>::const_iterator it = points.begin(); it!=points.end(); it++)
+		{
+			key.push_back(it->x);
+			key.push_back(it->y);
+		}
+	}
+}
+//-----------------------------------------------------------------------
+size_t TriangulationCache::_computeHash(const std::vector<Real>& key)
+{
+	// FNV-1a over the bits of the key
+	Ogre::uint64 hash = 14695981039346656037ULL;
+	for (std::vector<Real>::const_iterator it = key.begin(); it!=key.end(); it++)
+	{
+		unsigned char bytes[sizeof(Real)];
+		memcpy(bytes, &*it, sizeof(Real));
+		for (size_t i=0;i<sizeof(Real);i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return (size_t)(hash ^ (hash>>32));
+}
+//-----------------------------------------------------------------------
+void TriangulationCache::_trim()
+{
+	while (mEntries.size()>mMaxEntries)
+	{
+		mEntriesByHash.erase(mEntries.back().hash);
+		mEntries.pop_back();
+	}
+}
+//-----------------------------------------------------------------------
+TriangulationCache::IndexListPtr TriangulationCache::find(const MultiShape& multiShape)
+{
+	// The key is built outside of the lock, so that concurrent lookups don't wait for each other
+	std::vector<Real> key;
+	_buildKey(multiShape, key);
+	size_t hash = _computeHash(key);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::map<size_t, EntryList::iterator>::iterator it = mEntriesByHash.find(hash);
+	if (it==mEntriesByHash.end() || it->second->key!=key)
+	{
+		mMissCount++;
+		return IndexListPtr();
+	}
+	mHitCount++;
+	mEntries.splice(mEntries.begin(), mEntries, it->second);
+	return it->second->indices;
+}
+//-----------------------------------------------------------------------
+void TriangulationCache::insert(const MultiShape& multiShape, const std::vector<int>& indices)
+{
+	Entry entry;
+	_buildKey(multiShape, entry.key);
+	entry.hash = _computeHash(entry.key);
+	entry.indices = IndexListPtr(new std::vector<int>(indices));
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mMaxEntries==0)
+		return;
+	// Entries sharing the same hash replace each other
+	std::map<size_t, EntryList::iterator>::iterator it = mEntriesByHash.find(entry.hash);
+	if (it!=mEntriesByHash.end())
+		mEntries.erase(it->second);
+	mEntries.push_front(Entry());
+	mEntries.front().hash = entry.hash;
+	mEntries.front().key.swap(entry.key);
+	mEntries.front().indices = entry.indices;
+	mEntriesByHash[entry.hash] = mEntries.begin();
+	_trim();
+}
+//-----------------------------------------------------------------------
+TriangulationCache& TriangulationCache::setMaxEntries(size_t maxEntries)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMaxEntries = maxEntries;
+	_trim();
+	return *this;
+}
+//-----------------------------------------------------------------------
+void TriangulationCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEntries.clear();
+	mEntriesByHash.clear();
+	mHitCount = 0;
+	mMissCount = 0;
+}
+}
@@ -28,12 +28,44 @@ THE SOFTWARE.
 #include "OgreProceduralStableHeaders.h"
 #include "OgreProceduralTriangulator.h"
 #include "OgreProceduralGeometryHelpers.h"
+#include "OgreProceduralTriangulationCache.h"
+#include "OgreProceduralPointInsideIndex.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
 
 using namespace Ogre;
 
 namespace OgreProcedural
 {
 //-----------------------------------------------------------------------
+/// Tells on which side of the oriented line (a,b) point c stands : >0 on the left, <0 on the right
+static inline double _orient(const Vector2& a, const Vector2& b, const Vector2& c)
+{
+	return ((double)b.x-a.x)*((double)c.y-a.y) - ((double)b.y-a.y)*((double)c.x-a.x);
+}
+//-----------------------------------------------------------------------
+/// Positive if d is inside the circumcircle of the counter-clockwise triangle (a,b,c)
+static inline double _inCircle(const Vector2& a, const Vector2& b, const Vector2& c, const Vector2& d)
+{
+	double adx = (double)a.x-d.x, ady = (double)a.y-d.y;
+	double bdx = (double)b.x-d.x, bdy = (double)b.y-d.y;
+	double cdx = (double)c.x-d.x, cdy = (double)c.y-d.y;
+	double ad = adx*adx+ady*ady;
+	double bd = bdx*bdx+bdy*bdy;
+	double cd = cdx*cdx+cdy*cdy;
+	return adx*(bdy*cd-bd*cdy) - ady*(bdx*cd-bd*cdx) + ad*(bdx*cdy-bdy*cdx);
+}
+//-----------------------------------------------------------------------
+/// Points that were merged with an identical point are stored as -2-(index of the other point)
+static inline int _resolveDuplicate(int i, const std::vector<int>& vertexTriangles)
+{
+	while (vertexTriangles[i] < -1)
+		i = -2-vertexTriangles[i];
+	return i;
+}
+//-----------------------------------------------------------------------
 void Triangulator::Triangle::setVertices(int i0, int i1, int i2)
 {
 	i[0] = i0;
@@ -52,239 +84,494 @@ int Triangulator::Triangle::findSegNumber(int i0, int i1) const
 		throw std::runtime_error("we should not be here!");
 	}
 //-----------------------------------------------------------------------
-bool Triangulator::Triangle::isPointInside(const Vector2& point)
-	{
-		// Compute vectors
-		Vector2 v0 = p(2) - p(0);
-		Vector2 v1 = p(1) - p(0);
-		Vector2 v2 = point - p(0);
-
-		// Compute dot products
-		Real dot00 = v0.squaredLength();
-		Real dot01 = v0.dotProduct(v1);
-		Real dot02 = v0.dotProduct(v2);
-		Real dot11 = v1.squaredLength();
-		Real dot12 = v1.dotProduct(v2);
-
-		// Compute barycentric coordinates
-		Real invDenom = 1 / (dot00 * dot11 - dot01 * dot01);
-		Real u = (dot11 * dot02 - dot01 * dot12) * invDenom;
-		Real v = (dot00 * dot12 - dot01 * dot02) * invDenom;
-
-		// Check if point is in triangle
-		return (u >= 0) && (v >= 0) && (u + v - 1 <= 0);
-	}
+bool Triangulator::Triangle::isPointInsideCircumcircle(const Vector2& pt, const PointList& pl) const
+{
+	return _inCircle(p(0, pl), p(1, pl), p(2, pl), pt) > 0;
+}
 //-----------------------------------------------------------------------
-bool Triangulator::Triangle::isPointInsideCircumcircle(const Vector2& pt)
+void Triangulator::Triangle::makeDirectIfNeeded(const PointList& pl)
 {
-	Vector2 v0=p(0);
-	Vector2 v1=p(1);
-	Vector2 v2=p(2);
-	Matrix4 m (v0.x, v0.y, v0.squaredLength(), 1.,
-		       v1.x, v1.y, v1.squaredLength(), 1.,
-			   v2.x, v2.y, v2.squaredLength(), 1.,
-			   pt.x, pt.y, pt.squaredLength(), 1.);
-	Real det = m.determinant();
-	return det>=0;
+	if (_orient(p(0, pl), p(1, pl), p(2, pl))<0)
+	{
+		std::swap(i[0], i[1]);
+	}
 }
 //-----------------------------------------------------------------------
 // Triangulation by insertion
-void Triangulator::delaunay(PointList& pointList, DelaunayTriangleBuffer& tbuffer) const
+void Triangulator::delaunay(Workspace& ws) const
 {
+	PointList& pointList = ws.mPoints;
+	DelaunayTriangleBuffer& tbuffer = ws.mTriangles;
+	std::vector<int>& vertexTriangles = ws.mVertexTriangles;
+	size_t numPoints = pointList.size();
+
 	// Compute super triangle
-	float maxTriangleSize = 0.f;
+	Vector2 minPoint = Vector2::ZERO;
+	Vector2 maxPoint = Vector2::ZERO;
+	if (numPoints>0)
+		minPoint = maxPoint = pointList[0];
 	for (PointList::iterator it = pointList.begin(); it!=pointList.end();it++)
 	{
-		maxTriangleSize = std::max<float>(maxTriangleSize,fabs(it->x));
-		maxTriangleSize = std::max<float>(maxTriangleSize,fabs(it->y));
-	}
-	int maxTriangleIndex=pointList.size();
-	pointList.push_back(Vector2(-3*maxTriangleSize,-3*maxTriangleSize));
-	pointList.push_back(Vector2(3*maxTriangleSize,-3*maxTriangleSize));
-	pointList.push_back(Vector2(0.,3*maxTriangleSize));
-	Triangle superTriangle(&pointList);
-	superTriangle.i[0]= maxTriangleIndex;
-	superTriangle.i[1]= maxTriangleIndex+1;
-	superTriangle.i[2]= maxTriangleIndex+2;
+		minPoint = Utils::min(minPoint, *it);
+		maxPoint = Utils::max(maxPoint, *it);
+	}
+	Vector2 center = .5f*(minPoint+maxPoint);
+	Real size = std::max(maxPoint.x-minPoint.x, maxPoint.y-minPoint.y);
+	if (size<=0.f)
+		size = 1.f;
+	int maxTriangleIndex=numPoints;
+	pointList.push_back(center+Vector2(-20*size,-20*size));
+	pointList.push_back(center+Vector2(20*size,-20*size));
+	pointList.push_back(center+Vector2(0.,20*size));
+	Triangle superTriangle;
+	superTriangle.setVertices(maxTriangleIndex, maxTriangleIndex+1, maxTriangleIndex+2);
+	tbuffer.clear();
+	tbuffer.reserve(2*numPoints+1);
 	tbuffer.push_back(superTriangle);
+	vertexTriangles.assign(numPoints+3, -1);
+	vertexTriangles[maxTriangleIndex] = vertexTriangles[maxTriangleIndex+1] = vertexTriangles[maxTriangleIndex+2] = 0;
+
+	// Biased randomized insertion order : points are shuffled, then split in rounds of doubling size.
+	// Inside a round, points are sorted along a snake-like path on a grid, so that each point is inserted next to the previous one.
+	// Randomization avoids the huge cavities that appear when inserting points in the order of a contour.
+	std::vector<int>& shuffledPoints = ws.mShuffledPoints;
+	shuffledPoints.resize(numPoints);
+	for (size_t i=0;i<numPoints;i++)
+		shuffledPoints[i] = i;
+	unsigned int seed = 12345;
+	for (size_t i=numPoints;i>1;i--)
+	{
+		seed = seed*1664525u + 1013904223u;
+		std::swap(shuffledPoints[i-1], shuffledPoints[(seed>>8)%i]);
+	}
+	int gridSize = std::max(1, (int)Math::Sqrt(numPoints/8.f));
+	std::vector<std::pair<int, int> >& insertionOrder = ws.mInsertionOrder;
+	insertionOrder.resize(numPoints);
+	int round = 0;
+	for (size_t n=0;n<numPoints;n++)
+	{
+		if (n+1 >= (2u<<round))
+			round++;
+		int i = shuffledPoints[n];
+		int cellX = std::min(gridSize-1, (int)((pointList[i].x-minPoint.x)/size*gridSize));
+		int cellY = std::min(gridSize-1, (int)((pointList[i].y-minPoint.y)/size*gridSize));
+		if (cellY%2==1)
+			cellX = gridSize-1-cellX;
+		insertionOrder[n] = std::make_pair((round*gridSize+cellY)*gridSize+cellX, i);
+	}
+	std::sort(insertionOrder.begin(), insertionOrder.end());
 
 	// Point insertion loop
-	for (unsigned short i=0;i<pointList.size()-3;i++)
+	std::vector<int>& cavity = ws.mCavity;
+	std::vector<int>& stack = ws.mStack;
+	std::vector<int>& freeTriangles = ws.mFreeTriangles;
+	std::vector<HalfEdge>& cavityEdges = ws.mInnerEdges;
+	freeTriangles.clear();
+	int lastTriangle = 0;
+	for (size_t n=0;n<numPoints;n++)
 	{
-		// Insert 1 point, find all triangles for which the point is in circumcircle
-		Vector2& p = pointList[i];
-		std::set<DelaunaySegment> segments;
-		for (DelaunayTriangleBuffer::iterator it = tbuffer.begin(); it!=tbuffer.end();)
+		int i = insertionOrder[n].second;
+		const Vector2& p = pointList[i];
+
+		// Walk from the last created triangle to the triangle containing the point
+		int t = lastTriangle;
+		size_t steps = 0;
+		while (true)
 		{
-			if (it->isPointInsideCircumcircle(p))
+			const Triangle& tri = tbuffer[t];
+			int next = -1;
+			for (int e=0;e<3;e++)
 			{
-				for (int k=0;k<3;k++)
+				int k = (e+steps)%3;
+				if (tri.n[k]>=0 && _orient(tri.p((k+1)%3, pointList), tri.p((k+2)%3, pointList), p)<0)
 				{
-					DelaunaySegment d1(it->i[k], it->i[(k+1)%3]);
-					if (segments.find(d1)!=segments.end())
-						segments.erase(d1);
-					else if (segments.find(d1.inverse())!=segments.end())
-						segments.erase(d1.inverse());
-					else
-						segments.insert(d1);
+					next = tri.n[k];
+					break;
+				}
+			}
+			if (next==-1)
+				break;
+			t = next;
+			if (++steps>tbuffer.size())
+			{
+				// Precision issue : the walk is going round in circles, so look at every triangle
+				for (size_t j=0;j<tbuffer.size();j++)
+				{
+					const Triangle& candidate = tbuffer[j];
+					if (!candidate.isDead &&
+						_orient(candidate.p(0, pointList), candidate.p(1, pointList), p)>=0 &&
+						_orient(candidate.p(1, pointList), candidate.p(2, pointList), p)>=0 &&
+						_orient(candidate.p(2, pointList), candidate.p(0, pointList), p)>=0)
+					{
+						t = j;
+						break;
+					}
 				}
-				it=tbuffer.erase(it);
-			} else
-				it++;
+				break;
+			}
 		}
+
+		// Points that are already in the triangulation are skipped
+		int duplicate = -1;
+		for (int k=0;k<3;k++)
+			if (tbuffer[t].p(k, pointList) == p)
+				duplicate = tbuffer[t].i[k];
+		if (duplicate!=-1)
+		{
+			vertexTriangles[i] = -2-duplicate;
+			continue;
+		}
+
+		// Find all the triangles for which the point is in circumcircle
+		cavity.clear();
+		stack.clear();
+		tbuffer[t].mark = i;
+		cavity.push_back(t);
+		stack.push_back(t);
+		while (!stack.empty())
+		{
+			int c = stack.back();
+			stack.pop_back();
+			for (int k=0;k<3;k++)
+			{
+				int nb = tbuffer[c].n[k];
+				if (nb<0 || tbuffer[nb].mark==i)
+					continue;
+				if (tbuffer[nb].isPointInsideCircumcircle(p, pointList))
+				{
+					tbuffer[nb].mark = i;
+					cavity.push_back(nb);
+					stack.push_back(nb);
+				}
+			}
+		}
+
 		// Find all the non-interior edges
-		for (std::set<DelaunaySegment>::iterator it = segments.begin(); it!=segments.end();it++)
+		cavityEdges.clear();
+		for (std::vector<int>::iterator it = cavity.begin(); it!=cavity.end(); it++)
+		{
+			const Triangle& tri = tbuffer[*it];
+			for (int k=0;k<3;k++)
+				if (tri.n[k]<0 || tbuffer[tri.n[k]].mark!=i)
+					cavityEdges.push_back(HalfEdge(tri.i[(k+1)%3], tri.i[(k+2)%3], tri.n[k], k));
+		}
+
+		// Build a new triangle for each of those edges, recycling the triangles of the cavity
+		freeTriangles.insert(freeTriangles.end(), cavity.begin(), cavity.end());
+		for (std::vector<HalfEdge>::iterator it = cavityEdges.begin(); it!=cavityEdges.end(); it++)
 		{
-			Triangle dt(&pointList);
+			int nt;
+			if (freeTriangles.empty())
+			{
+				nt = tbuffer.size();
+				tbuffer.push_back(Triangle());
+			}
+			else
+			{
+				nt = freeTriangles.back();
+				freeTriangles.pop_back();
+				tbuffer[nt] = Triangle();
+			}
+			int outer = it->triangle;
+			Triangle& dt = tbuffer[nt];
 			dt.setVertices(it->i1, it->i2, i);
-			dt.makeDirectIfNeeded();
-			tbuffer.push_back(dt);
+			dt.n[2] = outer;
+			if (outer>=0)
+				tbuffer[outer].n[tbuffer[outer].findSegNumber(it->i1, it->i2)] = nt;
+			it->triangle = nt;
+			vertexTriangles[it->i1] = nt;
+			vertexTriangles[it->i2] = nt;
+		}
+		for (std::vector<int>::iterator it = freeTriangles.begin(); it!=freeTriangles.end(); it++)
+			tbuffer[*it].isDead = true;
 
+		// Link new triangles together : edge (i2, p) of a triangle is shared with the triangle starting at i2
+		std::sort(cavityEdges.begin(), cavityEdges.end());
+		for (std::vector<HalfEdge>::iterator it = cavityEdges.begin(); it!=cavityEdges.end(); it++)
+		{
+			std::vector<HalfEdge>::iterator itNext = std::lower_bound(cavityEdges.begin(), cavityEdges.end(), HalfEdge(it->i2, -1, -1, -1));
+			if (itNext!=cavityEdges.end() && itNext->i1==it->i2)
+			{
+				tbuffer[it->triangle].n[0] = itNext->triangle;
+				tbuffer[itNext->triangle].n[1] = it->triangle;
+			}
+		}
+		if (!cavityEdges.empty())
+		{
+			lastTriangle = cavityEdges.front().triangle;
+			vertexTriangles[i] = lastTriangle;
 		}
 	}
-
-	//Remove super triangle
-	TouchSuperTriangle touchSuperTriangle(maxTriangleIndex, maxTriangleIndex+1,maxTriangleIndex+2);
-	tbuffer.remove_if(touchSuperTriangle);
-	pointList.pop_back();
-	pointList.pop_back();
-	pointList.pop_back();
 }
 //-----------------------------------------------------------------------
-void Triangulator::addConstraints(const MultiShape& multiShape, DelaunayTriangleBuffer& tbuffer, const PointList& pl) const
+bool Triangulator::addConstraints(const MultiShape& multiShape, Workspace& ws) const
 {
-	std::vector<DelaunaySegment> segList;
+	const PointList& pl = ws.mPoints;
+	DelaunayTriangleBuffer& tbuffer = ws.mTriangles;
 	size_t shapeOffset = 0;
-	// First, list all the segments that are not already in one of the delaunay triangles
+	// marks below pl.size() are used by the point insertion
+	int mark = pl.size();
+	bool allConstraintsInserted = true;
 	for (int k=0;k<multiShape.getShapeCount();k++)
 	{
 		const Shape& shape = multiShape.getShape(k);
-		// Determine which segments should be added
-		for (unsigned short i = 0; i<shape.getPoints().size()-1; i++)
+		size_t numPoints = shape.getPointCount();
+		if (numPoints>1)
 		{
-			bool isAlreadyIn = false;
-			for (DelaunayTriangleBuffer::iterator it = tbuffer.begin(); it!=tbuffer.end();it++)
-			{
-				if (it->containsSegment(shapeOffset+i,shapeOffset+i+1))
-				{
-					isAlreadyIn = true;
-					break;
-				}
-			}
-			// only do something for segments not already in DT
-			if (!isAlreadyIn)
+			for (size_t i = 0; i<shape.getSegCount(); i++)
 			{
-				segList.push_back(DelaunaySegment(i, i+1));
+				if (!_insertConstraint(shapeOffset+i, shapeOffset+(i+1)%numPoints, mark++, ws))
+					allConstraintsInserted = false;
 			}
 		}
-		shapeOffset+=shape.getPoints().size();
+		shapeOffset+=numPoints;
 	}
 
-	// Re-Triangulate according to the new segments
-	for (std::vector<DelaunaySegment>::iterator itSeg=segList.begin();itSeg!=segList.end();itSeg++)
+	// Clean up triangles outside of multishape
+	if (multiShape.isClosed())
 	{
-		// Remove all triangles intersecting the segment and keep a list of outside edges
-		std::set<DelaunaySegment> segments;
-		Segment2D seg1(pl[itSeg->i1], pl[itSeg->i2]);
-		for (DelaunayTriangleBuffer::iterator itTri = tbuffer.begin(); itTri!=tbuffer.end(); )
+		int superTriangleIndex = pl.size()-3;
+		if (allConstraintsInserted)
 		{
-			bool isTriangleIntersected = false;
-			for (int i=0;i<3;i++)
-			{
-				Segment2D seg2(itTri->p(i), itTri->p((i+1)%3));
-				if (seg1.intersects(seg2))
+			// Flood fill from the super triangle : crossing a constrained edge switches between outside and inside
+			std::vector<int>& depth = ws.mDepth;
+			std::vector<int>& stack = ws.mStack;
+			depth.assign(tbuffer.size(), -1);
+			stack.clear();
+			for (size_t t=0;t<tbuffer.size();t++)
+				if (!tbuffer[t].isDead && (tbuffer[t].i[0]>=superTriangleIndex || tbuffer[t].i[1]>=superTriangleIndex || tbuffer[t].i[2]>=superTriangleIndex))
 				{
-					isTriangleIntersected = true;
-					break;
+					depth[t] = 0;
+					stack.push_back(t);
 				}
-			}
-			if (isTriangleIntersected)
+			while (!stack.empty())
 			{
+				int t = stack.back();
+				stack.pop_back();
 				for (int k=0;k<3;k++)
 				{
-					DelaunaySegment d1(itTri->i[k], itTri->i[(k+1)%3]);
-					if (segments.find(d1)!=segments.end())
-						segments.erase(d1);
-					else if (segments.find(d1.inverse())!=segments.end())
-						segments.erase(d1.inverse());
-					else
-						segments.insert(d1);
+					int nb = tbuffer[t].n[k];
+					if (nb>=0 && depth[nb]==-1)
+					{
+						depth[nb] = depth[t] + (tbuffer[t].constrained[k]?1:0);
+						stack.push_back(nb);
+					}
 				}
-				itTri=tbuffer.erase(itTri);
 			}
-			else
-				itTri++;
+			for (size_t t=0;t<tbuffer.size();t++)
+				if (depth[t]%2==0)
+					tbuffer[t].isDead = true;
 		}
-		// Divide the list of points (coming from remaining segments) in 2 groups : "up"side and "down"side
-		std::vector<int> pointsAbove;
-		std::vector<int> pointsBelow;
-		int pt = itSeg->i1;
-		bool isAbove= true;
-		while (segments.size()>0)
+		else
 		{
-		//find next point
-		for (std::set<DelaunaySegment>::iterator it = segments.begin(); it!=segments.end();it++)
+			// Some constraints could not be inserted (the shapes are crossing each other), so test every triangle
+			PointInsideIndex index(multiShape);
+			for (DelaunayTriangleBuffer::iterator it = tbuffer.begin(); it!=tbuffer.end();it++)
+			{
+				if (!it->isDead && !index.isPointInside(it->getMidPoint(pl)))
+					it->isDead = true;
+			}
+		}
+	}
+	return allConstraintsInserted;
+}
+//-----------------------------------------------------------------------
+/// Marks the edge (i0, i1) of triangle t, and of its neighbour, as being constrained
+void Triangulator::_setConstrained(DelaunayTriangleBuffer& tbuffer, int t, int i0, int i1)
+{
+	int k = tbuffer[t].findSegNumber(i0, i1);
+	tbuffer[t].constrained[k] = true;
+	int nb = tbuffer[t].n[k];
+	if (nb>=0)
+		tbuffer[nb].constrained[tbuffer[nb].findSegNumber(i0, i1)] = true;
+}
+//-----------------------------------------------------------------------
+bool Triangulator::_insertConstraint(int i1, int i2, int mark, Workspace& ws) const
+{
+	const PointList& pl = ws.mPoints;
+	DelaunayTriangleBuffer& tbuffer = ws.mTriangles;
+	std::vector<int>& vertexTriangles = ws.mVertexTriangles;
+	int a = _resolveDuplicate(i1, vertexTriangles);
+	int b = _resolveDuplicate(i2, vertexTriangles);
+	std::vector<int>& crossed = ws.mCrossed;
+	std::vector<int>& pointsAbove = ws.mPointsAbove;
+	std::vector<int>& pointsBelow = ws.mPointsBelow;
+	std::vector<HalfEdge>& outerEdges = ws.mOuterEdges;
+	std::vector<HalfEdge>& innerEdges = ws.mInnerEdges;
+	DelaunayTriangleBuffer& newTriangles = ws.mNewTriangles;
+	while (a!=b)
+	{
+		// Turn around a to find the triangle through which the segment leaves a
+		int start = vertexTriangles[a];
+		int t = start;
+		int left = -1, right = -1, next = -1;
+		do
 		{
-			if (it->i1==pt || it->i2==pt)
+			const Triangle& tri = tbuffer[t];
+			int k = tri.findVertex(a);
+			int v1 = tri.i[(k+1)%3];
+			int v2 = tri.i[(k+2)%3];
+			if (v1==b || v2==b)
 			{
-				if (it->i1==pt)
-					pt = it->i2;
-				else
-					pt = it->i1;
-				segments.erase(it);
-				if (pt==itSeg->i2)
-					isAbove=false;
-				else if (pt!=itSeg->i1)
-				{
-					if (isAbove)
-						pointsAbove.push_back(pt);
-					else
-						pointsBelow.push_back(pt);
-				}
+				// segment is already in the triangulation
+				_setConstrained(tbuffer, t, a, b);
+				return true;
+			}
+			Vector2 direction = pl[b]-pl[a];
+			if (_orient(pl[a], pl[b], pl[v1])==0 && direction.dotProduct(pl[v1]-pl[a])>0)
+			{
+				next = v1;
+				break;
+			}
+			if (_orient(pl[a], pl[b], pl[v2])==0 && direction.dotProduct(pl[v2]-pl[a])>0)
+			{
+				next = v2;
 				break;
 			}
+			if (_orient(pl[a], pl[b], pl[v1])<0 && _orient(pl[a], pl[b], pl[v2])>0)
+			{
+				right = v1;
+				left = v2;
+				break;
+			}
+			t = tri.n[(k+1)%3];
+		} while (t!=start && t>=0);
+
+		if (next!=-1)
+		{
+			// segment goes through a vertex : constrain the first part, then carry on with the rest
+			_setConstrained(tbuffer, t, a, next);
+			a = next;
+			continue;
+		}
+		if (right==-1)
+			return false;
+
+		// Walk along the segment, and list all the triangles it crosses
+		crossed.clear();
+		pointsAbove.clear();
+		pointsBelow.clear();
+		crossed.push_back(t);
+		pointsAbove.push_back(left);
+		pointsBelow.push_back(right);
+		int end = -1;
+		while (end==-1)
+		{
+			const Triangle& tri = tbuffer[t];
+			int k = tri.findSegNumber(right, left);
+			if (tri.constrained[k] || tri.n[k]<0)
+				return false;
+			t = tri.n[k];
+			crossed.push_back(t);
+			int w = tbuffer[t].i[tbuffer[t].findSegNumber(right, left)];
+			double side = _orient(pl[a], pl[b], pl[w]);
+			if (w==b || side==0)
+				end = w;
+			else if (side>0)
+			{
+				pointsAbove.push_back(w);
+				left = w;
+			}
+			else
+			{
+				pointsBelow.push_back(w);
+				right = w;
+			}
 		}
+
+		// Remove the crossed triangles, and keep a list of outside edges
+		for (std::vector<int>::iterator it = crossed.begin(); it!=crossed.end(); it++)
+			tbuffer[*it].mark = mark;
+		outerEdges.clear();
+		for (std::vector<int>::iterator it = crossed.begin(); it!=crossed.end(); it++)
+		{
+			const Triangle& tri = tbuffer[*it];
+			for (int k=0;k<3;k++)
+				if (tri.n[k]<0 || tbuffer[tri.n[k]].mark!=mark)
+					outerEdges.push_back(HalfEdge(tri.i[(k+1)%3], tri.i[(k+2)%3], tri.n[k], k, tri.constrained[k]));
 		}
+		std::sort(outerEdges.begin(), outerEdges.end());
 
 		// Recursively triangulate both polygons
-		_recursiveTriangulatePolygon(*itSeg, pointsAbove, tbuffer, pl);
-		_recursiveTriangulatePolygon(*itSeg, pointsBelow, tbuffer, pl);
-	}
-	// Clean up segments outside of multishape
-	if (multiShape.isClosed())
-	{
-		for (DelaunayTriangleBuffer::iterator it = tbuffer.begin(); it!=tbuffer.end();)
+		DelaunaySegment cuttingSeg(a, end);
+		newTriangles.clear();
+		_recursiveTriangulatePolygon(cuttingSeg, pointsAbove, 0, pointsAbove.size(), newTriangles, pl);
+		_recursiveTriangulatePolygon(cuttingSeg, pointsBelow, 0, pointsBelow.size(), newTriangles, pl);
+
+		// Put the new triangles in place of the old ones
+		innerEdges.clear();
+		for (size_t j=0;j<std::max(newTriangles.size(), crossed.size());j++)
 		{
-			bool isTriangleOut = !multiShape.isPointInside(it->getMidPoint());
+			if (j>=newTriangles.size())
+			{
+				tbuffer[crossed[j]].isDead = true;
+				continue;
+			}
+			int nt;
+			if (j<crossed.size())
+				nt = crossed[j];
+			else
+			{
+				nt = tbuffer.size();
+				tbuffer.push_back(Triangle());
+			}
+			tbuffer[nt] = newTriangles[j];
+			for (int k=0;k<3;k++)
+			{
+				innerEdges.push_back(HalfEdge(newTriangles[j].i[(k+1)%3], newTriangles[j].i[(k+2)%3], nt, k));
+				vertexTriangles[newTriangles[j].i[k]] = nt;
+			}
+		}
+		std::sort(innerEdges.begin(), innerEdges.end());
 
-			if (isTriangleOut)
-				it = tbuffer.erase(it);
-			 else
-				it++;
+		// Link them with their neighbours
+		for (std::vector<HalfEdge>::iterator it = innerEdges.begin(); it!=innerEdges.end(); it++)
+		{
+			Triangle& tri = tbuffer[it->triangle];
+			std::vector<HalfEdge>::iterator itOuter = std::lower_bound(outerEdges.begin(), outerEdges.end(), *it);
+			if (itOuter!=outerEdges.end() && itOuter->i1==it->i1 && itOuter->i2==it->i2)
+			{
+				tri.n[it->k] = itOuter->triangle;
+				tri.constrained[it->k] = itOuter->constrained;
+				if (itOuter->triangle>=0)
+					tbuffer[itOuter->triangle].n[tbuffer[itOuter->triangle].findSegNumber(it->i1, it->i2)] = it->triangle;
+				continue;
+			}
+			std::vector<HalfEdge>::iterator itInner = std::lower_bound(innerEdges.begin(), innerEdges.end(), HalfEdge(it->i2, it->i1, -1, -1));
+			if (itInner!=innerEdges.end() && itInner->i1==it->i2 && itInner->i2==it->i1)
+			{
+				tri.n[it->k] = itInner->triangle;
+				tri.constrained[it->k] = (it->i1==a && it->i2==end) || (it->i1==end && it->i2==a);
+			}
 		}
+		a = end;
 	}
+	return true;
 }
 //-----------------------------------------------------------------------
-void Triangulator::_recursiveTriangulatePolygon(const DelaunaySegment& cuttingSeg, std::vector<int> inputPoints, DelaunayTriangleBuffer& tbuffer, const PointList&  pointList) const
+void Triangulator::_recursiveTriangulatePolygon(const DelaunaySegment& cuttingSeg, const std::vector<int>& inputPoints, size_t first, size_t last, DelaunayTriangleBuffer& tbuffer, const PointList&  pointList) const
 {
-	if (inputPoints.size() ==1)
+	if (last-first==1)
 	{
-		Triangle t(&pointList);
-		t.setVertices(cuttingSeg.i1, cuttingSeg.i2, *inputPoints.begin());
-		t.makeDirectIfNeeded();
+		Triangle t;
+		t.setVertices(cuttingSeg.i1, cuttingSeg.i2, inputPoints[first]);
+		t.makeDirectIfNeeded(pointList);
 		tbuffer.push_back(t);
 		return;
 	}
 	// Find a point which, when associated with seg.i1 and seg.i2, builds a Delaunay triangle
-	std::vector<int>::iterator currentPoint = inputPoints.begin();
+	size_t currentPoint = first;
 	bool found = false;
-	while (!found)
+	// the number of tries is bounded, in case of degenerated (flat) triangles
+	for (size_t tries = first; !found && tries<=last; tries++)
 	{
 		bool isDelaunay = true;
-		Circle c(pointList[*currentPoint], pointList[cuttingSeg.i1], pointList[cuttingSeg.i2]);
-		for (std::vector<int>::iterator it = inputPoints.begin();it!=inputPoints.end();it++)
+		Triangle t;
+		t.setVertices(inputPoints[currentPoint], cuttingSeg.i1, cuttingSeg.i2);
+		t.makeDirectIfNeeded(pointList);
+		for (size_t it = first;it<last;it++)
 		{
-			if (c.isPointInside(pointList[*it]) )
+			if (it!=currentPoint && t.isPointInsideCircumcircle(pointList[inputPoints[it]], pointList))
 			{
 				isDelaunay = false;
 				currentPoint = it;
@@ -296,99 +583,751 @@ void Triangulator::_recursiveTriangulatePolygon(const DelaunaySegment& cuttingSe
 	}
 
 	// Insert current triangle
-	Triangle t(&pointList);
-	t.setVertices(*currentPoint, cuttingSeg.i1, cuttingSeg.i2);
+	Triangle t;
+	t.setVertices(inputPoints[currentPoint], cuttingSeg.i1, cuttingSeg.i2);
+	t.makeDirectIfNeeded(pointList);
 	tbuffer.push_back(t);
 
 	// Recurse
-	DelaunaySegment newCut1(cuttingSeg.i1, *currentPoint);
-	DelaunaySegment newCut2(cuttingSeg.i2, *currentPoint);
-	std::vector<int> set1(inputPoints.begin(), currentPoint);
-	std::vector<int> set2(currentPoint+1, inputPoints.end());
-
-	if (!set1.empty())
-	_recursiveTriangulatePolygon(newCut1, set1, tbuffer, pointList);
-	if (!set2.empty())
-	_recursiveTriangulatePolygon(newCut2, set2, tbuffer, pointList);
+	DelaunaySegment newCut1(cuttingSeg.i1, inputPoints[currentPoint]);
+	DelaunaySegment newCut2(inputPoints[currentPoint], cuttingSeg.i2);
+
+	if (currentPoint>first)
+	_recursiveTriangulatePolygon(newCut1, inputPoints, first, currentPoint, tbuffer, pointList);
+	if (currentPoint+1<last)
+	_recursiveTriangulatePolygon(newCut2, inputPoints, currentPoint+1, last, tbuffer, pointList);
 }
 //-----------------------------------------------------------------------
-void Triangulator::triangulate(std::vector<int>& output, PointList& outputVertices) const
+size_t Triangulator::Workspace::_computeMemoryUsage() const
+{
+	return mPoints.capacity()*sizeof(Vector2)
+		+ (mTriangles.capacity()+mNewTriangles.capacity())*sizeof(Triangle)
+		+ (mVertexTriangles.capacity()+mShuffledPoints.capacity()+mCavity.capacity()+mStack.capacity()+mFreeTriangles.capacity()
+			+ mCrossed.capacity()+mPointsAbove.capacity()+mPointsBelow.capacity()+mDepth.capacity())*sizeof(int)
+		+ mInsertionOrder.capacity()*sizeof(std::pair<int, int>)
+		+ (mInnerEdges.capacity()+mOuterEdges.capacity())*sizeof(HalfEdge);
+}
+//-----------------------------------------------------------------------
+void Triangulator::Workspace::_endCall()
+{
+	mCallCount++;
+	size_t memoryUsage = _computeMemoryUsage();
+	if (memoryUsage>mMemoryUsage)
+		mGrowthCount++;
+	mMemoryUsage = memoryUsage;
+}
+//-----------------------------------------------------------------------
+void Triangulator::Workspace::clear()
+{
+	// swapping with empty containers is the only way to actually release their memory
+	PointList().swap(mPoints);
+	DelaunayTriangleBuffer().swap(mTriangles);
+	DelaunayTriangleBuffer().swap(mNewTriangles);
+	std::vector<int>().swap(mVertexTriangles);
+	std::vector<int>().swap(mShuffledPoints);
+	std::vector<std::pair<int, int> >().swap(mInsertionOrder);
+	std::vector<int>().swap(mCavity);
+	std::vector<int>().swap(mStack);
+	std::vector<int>().swap(mFreeTriangles);
+	std::vector<int>().swap(mCrossed);
+	std::vector<int>().swap(mPointsAbove);
+	std::vector<int>().swap(mPointsBelow);
+	std::vector<int>().swap(mDepth);
+	std::vector<HalfEdge>().swap(mInnerEdges);
+	std::vector<HalfEdge>().swap(mOuterEdges);
+	mShapeWrapper = MultiShape();
+	mMemoryUsage = 0;
+}
+//-----------------------------------------------------------------------
+/// Fills a point list with the points of every shape, reusing its memory
+static void _getPoints(const MultiShape& multiShape, PointList& pointList)
+{
+	// room is left for the super triangle
+	pointList.clear();
+	pointList.reserve(multiShape.getPointCount()+3);
+	pointList.insert(pointList.end(), multiShape.pointsBegin(), multiShape.pointsEnd());
+}
+//-----------------------------------------------------------------------
+size_t Triangulator::_triangulate(const MultiShape& multiShape, Workspace& ws, bool* allConstraintsInserted) const
 {
-	assert((mShapeToTriangulate || mMultiShapeToTriangulate) && "Either shape or multishape must be defined");
-
 	// Do the Delaunay triangulation
-	if (mShapeToTriangulate)
-		outputVertices = mShapeToTriangulate->getPoints();
-	else
-		outputVertices = mMultiShapeToTriangulate->getPoints();
-	DelaunayTriangleBuffer dtb;
-	delaunay(outputVertices, dtb);
+	_getPoints(multiShape, ws.mPoints);
+	delaunay(ws);
 
 	// Add contraints
-	if (mMultiShapeToTriangulate)
-		addConstraints(*mMultiShapeToTriangulate, dtb, outputVertices);
-	else
-		addConstraints(*mShapeToTriangulate, dtb, outputVertices);
+	bool inserted = addConstraints(multiShape, ws);
+	if (allConstraintsInserted)
+		*allConstraintsInserted = inserted;
 
-	//Outputs index buffer
-	for (DelaunayTriangleBuffer::iterator it = dtb.begin(); it!=dtb.end();it++)
+	// Remove the triangles which touch the super triangle, and the super triangle itself
+	int superTriangleIndex = ws.mPoints.size()-3;
+	ws.mPoints.resize(superTriangleIndex);
+	size_t numTriangles = 0;
+	for (DelaunayTriangleBuffer::iterator it = ws.mTriangles.begin(); it!=ws.mTriangles.end();it++)
 	{
-		output.push_back(it->i[0]);
-		output.push_back(it->i[1]);
-		output.push_back(it->i[2]);
+		if (it->i[0]>=superTriangleIndex || it->i[1]>=superTriangleIndex || it->i[2]>=superTriangleIndex)
+			it->isDead = true;
+		if (!it->isDead)
+			numTriangles++;
 	}
+	ws._endCall();
+	return numTriangles;
 }
 //-----------------------------------------------------------------------
-void Triangulator::addToTriangleBuffer(TriangleBuffer& buffer) const
+/// Tells whether a point is in the area enclosed by a contour, whatever its outside is
+static bool _isInsideContour(const Shape& shape, const Vector2& point)
+{
+	bool inside = false;
+	for (size_t i=0;i<shape.getSegCount();i++)
 	{
-	assert((mShapeToTriangulate || mMultiShapeToTriangulate) && "Either shape or multishape must be defined");
-	if (mShapeToTriangulate)
+		const Vector2& a = shape.getPoint(i);
+		const Vector2& b = shape.getPoint(i+1);
+		if ((a.y>point.y) != (b.y>point.y) && point.x < a.x+(point.y-a.y)*(b.x-a.x)/(b.y-a.y))
+			inside = !inside;
+	}
+	return inside;
+}
+//-----------------------------------------------------------------------
+void Triangulator::_findComponents(const MultiShape& multiShape, std::vector<std::vector<int> >& components)
+{
+	int numShapes = multiShape.getShapeCount();
+
+	// Bounding boxes quickly reject most pairs of contours
+	std::vector<Vector2> minPoints(numShapes, Vector2::ZERO);
+	std::vector<Vector2> maxPoints(numShapes, Vector2::ZERO);
+	for (int k=0;k<numShapes;k++)
 	{
-		PointList pointList;
-		std::vector<int> indexBuffer;
-		triangulate(indexBuffer, pointList);
-		for (size_t j =0;j<=mShapeToTriangulate->getSegCount();j++)
-			{
-				Ogre::Vector2 vp2 = mShapeToTriangulate->getPoint(j);
-				Ogre::Vector3 vp(vp2.x, vp2.y, 0);
-				Ogre::Vector3 normal = -Ogre::Vector3::UNIT_Z;
-
-				Ogre::Vector3 newPoint = vp;
-				buffer.position(newPoint);
-				buffer.normal(normal);
-				buffer.textureCoord(vp2.x, vp2.y);
-			}
+		const Shape& shape = multiShape.getShape(k);
+		if (shape.getPointCount()==0)
+			continue;
+		minPoints[k] = maxPoints[k] = shape.getPoint(0);
+		for (size_t i=1;i<shape.getPointCount();i++)
+		{
+			minPoints[k] = Utils::min(minPoints[k], shape.getPoint(i));
+			maxPoints[k] = Utils::max(maxPoints[k], shape.getPoint(i));
+		}
+	}
 
-			for (size_t i=0;i<indexBuffer.size()/3;i++)
+	// Depth of a contour is the number of contours around it : even contours are outer contours, odd ones are holes.
+	// Contours are swept by increasing min x, so that each one is only tested against the contours
+	// which start before it and still reach it along x, instead of every other contour.
+	std::vector<int> sweepOrder;
+	for (int k=0;k<numShapes;k++)
+		if (multiShape.getShape(k).getPointCount()>0)
+			sweepOrder.push_back(k);
+	std::sort(sweepOrder.begin(), sweepOrder.end(), [&](int a, int b) { return minPoints[a].x<minPoints[b].x; });
+	std::vector<std::vector<int> > containers(numShapes);
+	std::vector<int> activeContours;
+	size_t nextContour = 0;
+	for (size_t n=0;n<sweepOrder.size();n++)
+	{
+		int k = sweepOrder[n];
+		for (;nextContour<sweepOrder.size() && minPoints[sweepOrder[nextContour]].x<=minPoints[k].x;nextContour++)
+			if (multiShape.getShape(sweepOrder[nextContour]).getPointCount()>=3)
+				activeContours.push_back(sweepOrder[nextContour]);
+		const Vector2& p = multiShape.getShape(k).getPoint(0);
+		for (size_t a=0;a<activeContours.size();)
+		{
+			int j = activeContours[a];
+			if (maxPoints[j].x<minPoints[k].x)
 			{
-				buffer.index(indexBuffer[i*3]);
-				buffer.index(indexBuffer[i*3+2]);
-				buffer.index(indexBuffer[i*3+1]);
+				// no contour left to sweep starts before the end of this one
+				activeContours[a] = activeContours.back();
+				activeContours.pop_back();
+				continue;
 			}
+			if (j!=k && minPoints[j].y<=minPoints[k].y && maxPoints[j].x>=maxPoints[k].x && maxPoints[j].y>=maxPoints[k].y
+				&& _isInsideContour(multiShape.getShape(j), p))
+				containers[k].push_back(j);
+			a++;
+		}
 	}
-	else
+
+	// Each outer contour makes a component, and each hole goes with the contour directly around it
+	std::vector<int> componentIndex(numShapes, -1);
+	for (int k=0;k<numShapes;k++)
 	{
-		PointList pointList;
-		std::vector<int> indexBuffer;
-		triangulate(indexBuffer, pointList);
-		for (size_t j =0;j<pointList.size();j++)
-			{
-				Ogre::Vector2 vp2 = pointList[j];
-				Ogre::Vector3 vp(vp2.x, vp2.y, 0);
-				Ogre::Vector3 normal = -Ogre::Vector3::UNIT_Z;
-
-				Ogre::Vector3 newPoint = vp;
-				buffer.position(newPoint);
-				buffer.normal(normal);
-				buffer.textureCoord(vp2.x, vp2.y);
-			}
+		if (multiShape.getShape(k).getPointCount()>0 && containers[k].size()%2==0)
+		{
+			componentIndex[k] = components.size();
+			components.push_back(std::vector<int>(1, k));
+		}
+	}
+	for (int k=0;k<numShapes;k++)
+	{
+		if (multiShape.getShape(k).getPointCount()==0 || containers[k].size()%2==0)
+			continue;
+		int parent = -1;
+		for (std::vector<int>::iterator it = containers[k].begin(); it!=containers[k].end(); it++)
+			if (containers[*it].size()+1==containers[k].size())
+				parent = *it;
+		if (parent==-1)
+		{
+			componentIndex[k] = components.size();
+			components.push_back(std::vector<int>(1, k));
+		}
+		else
+			components[componentIndex[parent]].push_back(k);
+	}
+}
+//-----------------------------------------------------------------------
+void Triangulator::_splitContour(const Shape& shape, size_t numPieces, std::vector<std::vector<int> >& pieces)
+{
+	const PointList& pl = shape.getPointsReference();
+	pieces.assign(1, std::vector<int>(pl.size()));
+	for (size_t i=0;i<pl.size();i++)
+		pieces[0][i] = i;
+
+	// The biggest piece is cut in two, until there are enough pieces or the biggest one can't be cut
+	std::vector<std::vector<int> > uncutPieces;
+	std::vector<int> firstPart, secondPart;
+	while (!pieces.empty() && pieces.size()+uncutPieces.size()<numPieces)
+	{
+		size_t biggest = 0;
+		for (size_t p=1;p<pieces.size();p++)
+			if (pieces[p].size()>pieces[biggest].size())
+				biggest = p;
+		if (pieces[biggest].size()<64)
+			break;
+		if (_cutPiece(pl, pieces[biggest], firstPart, secondPart))
+		{
+			pieces[biggest].swap(firstPart);
+			pieces.push_back(secondPart);
+		}
+		else
+		{
+			uncutPieces.push_back(std::vector<int>());
+			uncutPieces.back().swap(pieces[biggest]);
+			pieces.erase(pieces.begin()+biggest);
+		}
+	}
+	pieces.insert(pieces.end(), uncutPieces.begin(), uncutPieces.end());
+}
+//-----------------------------------------------------------------------
+bool Triangulator::_cutPiece(const PointList& pl, const std::vector<int>& piece, std::vector<int>& firstPart, std::vector<int>& secondPart)
+{
+	size_t numPoints = piece.size();
+	double area = 0;
+	for (size_t i=0;i<numPoints;i++)
+		area += _orient(Vector2::ZERO, pl[piece[i]], pl[piece[(i+1)%numPoints]]);
+	if (area==0)
+		return false;
+	double orientation = area>0?1.:-1.;
+
+	// From a few starting points, the shortest diagonals to a point about half the piece away are tried,
+	// as they are the most likely to stay inside the piece
+	const size_t numStarts = 8;
+	const size_t numCandidates = 4;
+	std::vector<std::pair<double, size_t> > candidates;
+	for (size_t s=0;s<numStarts;s++)
+	{
+		size_t a = s*numPoints/numStarts;
+		candidates.clear();
+		for (size_t offset=numPoints/4;offset<=3*numPoints/4;offset++)
+		{
+			size_t b = (a+offset)%numPoints;
+			candidates.push_back(std::make_pair((double)pl[piece[a]].squaredDistance(pl[piece[b]]), b));
+		}
+		size_t numTried = std::min(numCandidates, candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin()+numTried, candidates.end());
+		for (size_t c=0;c<numTried;c++)
+		{
+			size_t b = candidates[c].second;
+			if (!_isDiagonal(pl, piece, a, b, orientation))
+				continue;
+			size_t first = std::min(a, b);
+			size_t last = std::max(a, b);
+			firstPart.assign(piece.begin()+first, piece.begin()+last+1);
+			secondPart.assign(piece.begin()+last, piece.end());
+			secondPart.insert(secondPart.end(), piece.begin(), piece.begin()+first+1);
+			return true;
+		}
+	}
+	return false;
+}
+//-----------------------------------------------------------------------
+bool Triangulator::_isDiagonal(const PointList& pl, const std::vector<int>& piece, size_t a, size_t b, double orientation)
+{
+	size_t numPoints = piece.size();
+
+	// The diagonal must leave both of its ends towards the inside of the piece...
+	size_t ends[2] = {a, b};
+	for (int e=0;e<2;e++)
+	{
+		size_t i = ends[e];
+		const Vector2& p = pl[piece[i]];
+		const Vector2& other = pl[piece[ends[1-e]]];
+		const Vector2& previous = pl[piece[(i+numPoints-1)%numPoints]];
+		const Vector2& next = pl[piece[(i+1)%numPoints]];
+		if (orientation*_orient(previous, p, next)>0)
+		{
+			if (orientation*_orient(p, other, previous)<=0 || orientation*_orient(other, p, next)<=0)
+				return false;
+		}
+		else if (orientation*_orient(p, other, next)>=0 && orientation*_orient(other, p, previous)>=0)
+			return false;
+	}
+
+	// ...and not even touch the edges which don't end at its ends
+	const Vector2& pa = pl[piece[a]];
+	const Vector2& pb = pl[piece[b]];
+	for (size_t i=0;i<numPoints;i++)
+	{
+		size_t j = (i+1)%numPoints;
+		if (i==a || j==a || i==b || j==b)
+			continue;
+		const Vector2& p0 = pl[piece[i]];
+		const Vector2& p1 = pl[piece[j]];
+		double o0 = _orient(pa, pb, p0);
+		double o1 = _orient(pa, pb, p1);
+		if ((o0>0 && o1>0) || (o0<0 && o1<0))
+			continue;
+		double o2 = _orient(p0, p1, pa);
+		double o3 = _orient(p0, p1, pb);
+		if ((o2>0 && o3>0) || (o2<0 && o3<0))
+			continue;
+		return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------
+/// Copies the triangles left in a workspace, converting their vertices to global indices and their neighbours to indices in the output
+void Triangulator::_copyTriangles(const DelaunayTriangleBuffer& tbuffer, const std::vector<int>& globalIndices, DelaunayTriangleBuffer& output, std::vector<int>& triangleIndices)
+{
+	triangleIndices.assign(tbuffer.size(), -1);
+	int numTriangles = 0;
+	for (size_t t=0;t<tbuffer.size();t++)
+		if (!tbuffer[t].isDead)
+			triangleIndices[t] = numTriangles++;
+	output.clear();
+	output.reserve(numTriangles);
+	for (DelaunayTriangleBuffer::const_iterator it = tbuffer.begin(); it!=tbuffer.end();it++)
+	{
+		if (it->isDead)
+			continue;
+		Triangle tri = *it;
+		for (int k=0;k<3;k++)
+		{
+			tri.i[k] = globalIndices[tri.i[k]];
+			tri.n[k] = (tri.n[k]>=0)?triangleIndices[tri.n[k]]:-1;
+		}
+		output.push_back(tri);
+	}
+}
+//-----------------------------------------------------------------------
+bool Triangulator::_stitchPieces(DelaunayTriangleBuffer& tbuffer, const PointList& pl, size_t shapeOffset, size_t numPieces, std::vector<int>& stack)
+{
+	// Cuts are the borders of the pieces which don't join consecutive points of the contour
+	int numPoints = pl.size();
+	std::vector<HalfEdge> cuts;
+	for (size_t t=0;t<tbuffer.size();t++)
+		for (int k=0;k<3;k++)
+		{
+			if (tbuffer[t].n[k]!=-1)
+				continue;
+			int i1 = tbuffer[t].i[(k+1)%3]-shapeOffset;
+			int i2 = tbuffer[t].i[(k+2)%3]-shapeOffset;
+			if ((i1+1)%numPoints!=i2 && (i2+1)%numPoints!=i1)
+				cuts.push_back(HalfEdge(std::min(i1, i2), std::max(i1, i2), t, k));
+		}
+
+	// Each cut must border two pieces, which isn't the case when the pieces weren't triangulated as expected
+	if (cuts.size()!=2*(numPieces-1))
+		return false;
+	std::sort(cuts.begin(), cuts.end());
+	stack.clear();
+	for (size_t c=0;c<cuts.size();c+=2)
+	{
+		if (cuts[c].i1!=cuts[c+1].i1 || cuts[c].i2!=cuts[c+1].i2)
+			return false;
+		tbuffer[cuts[c].triangle].n[cuts[c].k] = cuts[c+1].triangle;
+		tbuffer[cuts[c].triangle].constrained[cuts[c].k] = false;
+		tbuffer[cuts[c+1].triangle].n[cuts[c+1].k] = cuts[c].triangle;
+		tbuffer[cuts[c+1].triangle].constrained[cuts[c+1].k] = false;
+		stack.push_back(cuts[c].triangle);
+		stack.push_back(cuts[c].k);
+	}
+
+	// Lawson flips : an edge which isn't Delaunay is replaced by the other diagonal of its quad, whose sides are then checked
+	while (!stack.empty())
+	{
+		int k = stack.back();
+		stack.pop_back();
+		int t = stack.back();
+		stack.pop_back();
+		int nb = tbuffer[t].n[k];
+		if (nb<0 || tbuffer[t].constrained[k])
+			continue;
+		Triangle& tri = tbuffer[t];
+		Triangle& other = tbuffer[nb];
+		int c = tri.i[k];
+		int a = tri.i[(k+1)%3];
+		int b = tri.i[(k+2)%3];
+		int kk = other.findSegNumber(a, b);
+		int d = other.i[kk];
+		const Vector2& pa = pl[a-shapeOffset];
+		const Vector2& pb = pl[b-shapeOffset];
+		const Vector2& pc = pl[c-shapeOffset];
+		const Vector2& pd = pl[d-shapeOffset];
+		// Cocircular points are left as they are, so that rounding errors can't flip an edge back and forth
+		double size = std::max(std::max(pa.squaredDistance(pc), pb.squaredDistance(pc)), std::max(pa.squaredDistance(pd), pb.squaredDistance(pd)));
+		if (_inCircle(pc, pa, pb, pd)<=1e-12*size*size || _orient(pc, pa, pd)<=0 || _orient(pd, pb, pc)<=0)
+			continue;
+
+		int nbc = tri.n[(k+1)%3];
+		int nca = tri.n[(k+2)%3];
+		int nad = other.n[(kk+1)%3];
+		int ndb = other.n[(kk+2)%3];
+		bool cbc = tri.constrained[(k+1)%3];
+		bool cca = tri.constrained[(k+2)%3];
+		bool cad = other.constrained[(kk+1)%3];
+		bool cdb = other.constrained[(kk+2)%3];
+		tri.setVertices(c, a, d);
+		tri.n[0] = nad;
+		tri.n[1] = nb;
+		tri.n[2] = nca;
+		tri.constrained[0] = cad;
+		tri.constrained[1] = false;
+		tri.constrained[2] = cca;
+		other.setVertices(d, b, c);
+		other.n[0] = nbc;
+		other.n[1] = t;
+		other.n[2] = ndb;
+		other.constrained[0] = cbc;
+		other.constrained[1] = false;
+		other.constrained[2] = cdb;
+		if (nad>=0)
+			tbuffer[nad].n[tbuffer[nad].findSegNumber(a, d)] = t;
+		if (nbc>=0)
+			tbuffer[nbc].n[tbuffer[nbc].findSegNumber(b, c)] = nb;
+		int sides[8] = {t, 0, t, 2, nb, 0, nb, 2};
+		stack.insert(stack.end(), sides, sides+8);
+	}
+	return true;
+}
+//-----------------------------------------------------------------------
+/// Sink filling a point list and an index buffer
+class IndexBufferSink : public TriangulationSink
+{
+	std::vector<int>& mIndexBuffer;
+	PointList& mPointList;
+public:
+	IndexBufferSink(std::vector<int>& indexBuffer, PointList& pointList) : mIndexBuffer(indexBuffer), mPointList(pointList) {}
+
+	void begin(size_t numVertices, size_t numTriangles)
+	{
+		mPointList.clear();
+		mPointList.reserve(numVertices);
+		mIndexBuffer.reserve(mIndexBuffer.size()+3*numTriangles);
+	}
+
+	void vertex(const Vector2& position)
+	{
+		mPointList.push_back(position);
+	}
+
+	void triangle(int i0, int i1, int i2)
+	{
+		mIndexBuffer.push_back(i0);
+		mIndexBuffer.push_back(i1);
+		mIndexBuffer.push_back(i2);
+	}
+};
+//-----------------------------------------------------------------------
+/// Sink forwarding the triangulation to another sink, while keeping a copy of the triangles
+class RecordingSink : public TriangulationSink
+{
+	TriangulationSink& mSink;
+public:
+	std::vector<int> mIndices;
+
+	RecordingSink(TriangulationSink& sink) : mSink(sink) {}
+
+	void begin(size_t numVertices, size_t numTriangles)
+	{
+		mIndices.reserve(3*numTriangles);
+		mSink.begin(numVertices, numTriangles);
+	}
+
+	void vertex(const Vector2& position)
+	{
+		mSink.vertex(position);
+	}
+
+	void triangle(int i0, int i1, int i2)
+	{
+		mIndices.push_back(i0);
+		mIndices.push_back(i1);
+		mIndices.push_back(i2);
+		mSink.triangle(i0, i1, i2);
+	}
+};
+//-----------------------------------------------------------------------
+void Triangulator::triangulate(std::vector<int>& output, PointList& outputVertices) const
+{
+	IndexBufferSink sink(output, outputVertices);
+	triangulate(sink);
+}
+//-----------------------------------------------------------------------
+void Triangulator::triangulate(TriangulationSink& sink) const
+{
+	assert((mShapeToTriangulate || mMultiShapeToTriangulate) && "Either shape or multishape must be defined");
+
+	Workspace localWorkspace;
+	Workspace& ws = mWorkspace?*mWorkspace:localWorkspace;
+	const MultiShape* multiShapePtr = mMultiShapeToTriangulate;
+	if (mShapeToTriangulate)
+	{
+		// the shape is copied into the workspace, which reuses the memory of the previous copy
+		if (ws.mShapeWrapper.getShapeCount()==0)
+			ws.mShapeWrapper.addShape(*mShapeToTriangulate);
+		else
+			ws.mShapeWrapper.getShape(0) = *mShapeToTriangulate;
+		multiShapePtr = &ws.mShapeWrapper;
+	}
+	const MultiShape& multiShape = *multiShapePtr;
+
+	if (!mCache)
+	{
+		_triangulate(multiShape, ws, sink);
+		return;
+	}
+	TriangulationCache::IndexListPtr cached = mCache->find(multiShape);
+	if (cached)
+	{
+		// Vertices are the points of the shapes, so only the triangles need to be stored
+		sink.begin(multiShape.getPointCount(), cached->size()/3);
+		for (MultiShape::PointIterator it = multiShape.pointsBegin(); it!=multiShape.pointsEnd(); it++)
+			sink.vertex(*it);
+		const std::vector<int>& indices = *cached;
+		for (size_t i=0;i<indices.size();i+=3)
+			sink.triangle(indices[i], indices[i+1], indices[i+2]);
+		return;
+	}
+	RecordingSink recordingSink(sink);
+	_triangulate(multiShape, ws, recordingSink);
+	mCache->insert(multiShape, recordingSink.mIndices);
+}
+//-----------------------------------------------------------------------
+void Triangulator::_triangulate(const MultiShape& multiShape, Workspace& ws, TriangulationSink& sink) const
+{
+	unsigned int numThreads = mNumThreads;
+	if (numThreads==0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::vector<int> > components;
+	// Threads only pay off when there are enough points to share
+	if (numThreads>1 && multiShape.getPointCount()>=4096 && multiShape.isClosed())
+		_findComponents(multiShape, components);
+
+	// Each component makes a job, except big contours without holes, which are cut into pieces making a job each
+	std::vector<std::vector<std::vector<int> > > componentPieces(components.size());
+	std::vector<std::pair<int, int> > jobs;
+	for (size_t c=0;c<components.size();c++)
+	{
+		if (components[c].size()==1)
+		{
+			const Shape& contour = multiShape.getShape(components[c][0]);
+			size_t numPieces = std::min<size_t>(numThreads, contour.getPointCount()/2048);
+			if (numPieces>1)
+				_splitContour(contour, numPieces, componentPieces[c]);
+		}
+		if (componentPieces[c].size()<2)
+		{
+			componentPieces[c].clear();
+			jobs.push_back(std::make_pair(c, -1));
+		}
+		else
+			for (size_t p=0;p<componentPieces[c].size();p++)
+				jobs.push_back(std::make_pair(c, p));
+	}
+	if (jobs.size()<2)
+	{
+		// Output directly from the workspace
+		size_t numTriangles = _triangulate(multiShape, ws);
+		sink.begin(ws.mPoints.size(), numTriangles);
+		for (PointList::const_iterator it = ws.mPoints.begin(); it!=ws.mPoints.end(); it++)
+			sink.vertex(*it);
+		for (DelaunayTriangleBuffer::const_iterator it = ws.mTriangles.begin(); it!=ws.mTriangles.end();it++)
+			if (!it->isDead)
+				sink.triangle(it->i[0], it->i[1], it->i[2]);
+		return;
+	}
 
-			for (size_t i=0;i<indexBuffer.size()/3;i++)
+	// Biggest jobs go first, to balance the work between threads
+	size_t numPoints = 0;
+	std::vector<size_t> shapeOffsets(multiShape.getShapeCount(), 0);
+	for (int k=0;k<multiShape.getShapeCount();k++)
+	{
+		shapeOffsets[k] = numPoints;
+		numPoints += multiShape.getShape(k).getPointCount();
+	}
+	std::vector<std::pair<size_t, size_t> > jobOrder(jobs.size());
+	for (size_t j=0;j<jobs.size();j++)
+	{
+		size_t numJobPoints = 0;
+		if (jobs[j].second>=0)
+			numJobPoints = componentPieces[jobs[j].first][jobs[j].second].size();
+		else
+			for (std::vector<int>::iterator it = components[jobs[j].first].begin(); it!=components[jobs[j].first].end(); it++)
+				numJobPoints += multiShape.getShape(*it).getPointCount();
+		jobOrder[j] = std::make_pair(numJobPoints, j);
+	}
+	std::sort(jobOrder.rbegin(), jobOrder.rend());
+
+	// Triangulate each job on its own
+	std::vector<DelaunayTriangleBuffer> jobOutputs(jobs.size());
+	std::vector<char> jobsComplete(jobs.size(), 1);
+	std::atomic<size_t> nextJob(0);
+	std::exception_ptr error;
+	std::mutex errorMutex;
+	std::vector<std::thread> threads;
+	for (unsigned int i=0;i<std::min<size_t>(numThreads, jobs.size());i++)
+	{
+		threads.push_back(std::thread([&, i]()
+		{
+			// the first thread uses the main workspace, the others have their own
+			Workspace threadWorkspace;
+			Workspace& workspace = (i==0)?ws:threadWorkspace;
+			std::vector<int> globalIndices;
+			std::vector<int> triangleIndices;
+			for (size_t n = nextJob++; n<jobs.size(); n = nextJob++)
 			{
-				buffer.index(indexBuffer[i*3]);
-				buffer.index(indexBuffer[i*3+2]);
-				buffer.index(indexBuffer[i*3+1]);
+				size_t j = jobOrder[n].second;
+				int c = jobs[j].first;
+				try
+				{
+					MultiShape jobShape;
+					globalIndices.clear();
+					if (jobs[j].second<0)
+					{
+						for (std::vector<int>::iterator it = components[c].begin(); it!=components[c].end(); it++)
+						{
+							jobShape.addShape(multiShape.getShape(*it));
+							for (size_t p=0;p<multiShape.getShape(*it).getPointCount();p++)
+								globalIndices.push_back(shapeOffsets[*it]+p);
+						}
+					}
+					else
+					{
+						const Shape& contour = multiShape.getShape(components[c][0]);
+						const std::vector<int>& piece = componentPieces[c][jobs[j].second];
+						Shape pieceShape;
+						pieceShape.reserve(piece.size());
+						for (std::vector<int>::const_iterator it = piece.begin(); it!=piece.end(); it++)
+						{
+							pieceShape.addPoint(contour.getPoint(*it));
+							globalIndices.push_back(shapeOffsets[components[c][0]]+*it);
+						}
+						jobShape.addShape(pieceShape.close());
+					}
+					bool allConstraintsInserted = true;
+					_triangulate(jobShape, workspace, &allConstraintsInserted);
+					jobsComplete[j] = allConstraintsInserted;
+					_copyTriangles(workspace.mTriangles, globalIndices, jobOutputs[j], triangleIndices);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(errorMutex);
+					if (!error)
+						error = std::current_exception();
+				}
 			}
+		}));
+	}
+	for (std::vector<std::thread>::iterator it = threads.begin(); it!=threads.end(); it++)
+		it->join();
+	if (error)
+		std::rethrow_exception(error);
+
+	// Gather the jobs of each component
+	std::vector<DelaunayTriangleBuffer> componentOutputs(components.size());
+	std::vector<char> componentsComplete(components.size(), 1);
+	for (size_t j=0;j<jobs.size();j++)
+	{
+		DelaunayTriangleBuffer& output = componentOutputs[jobs[j].first];
+		if (!jobsComplete[j])
+			componentsComplete[jobs[j].first] = 0;
+		if (jobs[j].second<0)
+		{
+			output.swap(jobOutputs[j]);
+			continue;
+		}
+		int offset = output.size();
+		for (DelaunayTriangleBuffer::iterator it = jobOutputs[j].begin(); it!=jobOutputs[j].end(); it++)
+		{
+			for (int k=0;k<3;k++)
+				if (it->n[k]>=0)
+					it->n[k] += offset;
+			output.push_back(*it);
+		}
+		DelaunayTriangleBuffer().swap(jobOutputs[j]);
 	}
+
+	// Stitch back the pieces of the contours which were cut
+	std::vector<int> stack;
+	for (size_t c=0;c<components.size();c++)
+	{
+		if (componentPieces[c].empty())
+			continue;
+		int s = components[c][0];
+		const Shape& contour = multiShape.getShape(s);
+		if (componentsComplete[c] && _stitchPieces(componentOutputs[c], contour.getPointsReference(), shapeOffsets[s], componentPieces[c].size(), stack))
+			continue;
+		// The contour crosses itself, or has duplicate points : it is triangulated whole
+		MultiShape contourShape;
+		contourShape.addShape(contour);
+		_triangulate(contourShape, ws);
+		std::vector<int> globalIndices(contour.getPointCount());
+		for (size_t i=0;i<globalIndices.size();i++)
+			globalIndices[i] = shapeOffsets[s]+i;
+		_copyTriangles(ws.mTriangles, globalIndices, componentOutputs[c], stack);
+	}
+
+	// Output the components, whose indices already refer to the whole multishape
+	size_t numTriangles = 0;
+	for (size_t c=0;c<components.size();c++)
+		numTriangles += componentOutputs[c].size();
+	sink.begin(numPoints, numTriangles);
+	for (MultiShape::PointIterator it = multiShape.pointsBegin(); it!=multiShape.pointsEnd(); it++)
+		sink.vertex(*it);
+	for (size_t c=0;c<components.size();c++)
+		for (DelaunayTriangleBuffer::const_iterator it = componentOutputs[c].begin(); it!=componentOutputs[c].end();it++)
+			sink.triangle(it->i[0], it->i[1], it->i[2]);
+}
+//-----------------------------------------------------------------------
+/// Sink writing a flat, downward facing mesh into a triangle buffer
+class FlatTriangleBufferSink : public TriangulationSink
+{
+	TriangleBuffer& mBuffer;
+public:
+	FlatTriangleBufferSink(TriangleBuffer& buffer) : mBuffer(buffer) {}
+
+	void begin(size_t numVertices, size_t numTriangles)
+	{
+		mBuffer.estimateVertexCount(numVertices);
+		mBuffer.estimateIndexCount(3*numTriangles);
+	}
+
+	void vertex(const Vector2& position)
+	{
+		mBuffer.position(Vector3(position.x, position.y, 0));
+		mBuffer.normal(-Vector3::UNIT_Z);
+		mBuffer.textureCoord(position.x, position.y);
+	}
+
+	void triangle(int i0, int i1, int i2)
+	{
+		mBuffer.index(i0);
+		mBuffer.index(i2);
+		mBuffer.index(i1);
+	}
+};
+//-----------------------------------------------------------------------
+void Triangulator::addToTriangleBuffer(TriangleBuffer& buffer) const
+{
+	assert((mShapeToTriangulate || mMultiShapeToTriangulate) && "Either shape or multishape must be defined");
+	buffer.rebaseOffset();
+	FlatTriangleBufferSink sink(buffer);
+	triangulate(sink);
 }
 }
@@ -30,6 +30,7 @@ THE SOFTWARE.
 
 #include "BaseApplication.h"
 #include "OgreProcedural.h"
+#include "OgreProceduralGeometryHelpers.h"
 using namespace Ogre;
 using namespace OgreProcedural;
 
@@ -41,6 +42,26 @@ protected:
 	std::vector<Entity*> mEntities;
 	std::vector<SceneNode*> mSceneNodes;
 	Ogre::Timer mTimer;
+	int mFailedCheckCount;
+
+	/// Checks a result of the test. Unlike assert, it also runs in release builds : failures are logged, and counted.
+	void check(bool condition, const String& description)
+	{
+		if (!condition)
+		{
+			mFailedCheckCount++;
+			Utils::log("Check failed : " + description);
+		}
+	}
+
+	/// Checks that two triangle buffers hold the same indices, and the same vertices bit for bit
+	void checkSameBuffers(const TriangleBuffer& buffer1, const TriangleBuffer& buffer2, const String& description)
+	{
+		const std::vector<TriangleBuffer::Vertex>& vertices1 = buffer1.getVertices();
+		const std::vector<TriangleBuffer::Vertex>& vertices2 = buffer2.getVertices();
+		check(buffer1.getIndices()==buffer2.getIndices() && vertices1.size()==vertices2.size()
+			&& (vertices1.empty() || memcmp(&vertices1[0], &vertices2[0], vertices1.size()*sizeof(TriangleBuffer::Vertex))==0), description);
+	}
 
 	void putMesh(const String& meshName, int materialIndex=0)
 	{
@@ -69,7 +90,7 @@ protected:
 	}
 
 public:
-	Unit_Test(SceneManager* sn) : mSceneMgr(sn) {}
+	Unit_Test(SceneManager* sn) : mSceneMgr(sn), mFailedCheckCount(0) {}
 
 	virtual String getDescription()=0;
 	virtual void initImpl()=0;
@@ -84,8 +105,11 @@ public:
 	{
 		Utils::log("Loading test : " + getDescription());
 		mTimer.reset();
+		mFailedCheckCount = 0;
 		initImpl();
 		Utils::log("Test loaded in : " + Ogre::StringConverter::toString(mTimer.getMilliseconds()) + " ms");
+		if (mFailedCheckCount>0)
+			Utils::log(Ogre::StringConverter::toString(mFailedCheckCount) + " checks failed in test : " + getDescription());
 		Ogre::OverlayManager::getSingleton().getOverlayElement("myText")->setCaption(getDescription());
 	}
 
@@ -225,6 +249,11 @@ class Unit_Tests : public BaseApplication
 
 			putMesh(Triangulator().setMultiShapeToTriangulate(&ms).realizeMesh());
 
+			// Chained transforms are only applied once, when the triangulator reads the points
+			MultiShape transformed = ms;
+			transformed.rotate(Degree(30)).scale(1.5,.5).translate(Vector2(10,0));
+			putMesh(Triangulator().setMultiShapeToTriangulate(&transformed).realizeMesh());
+
 			Path p = LinePath().realizePath();
 			Extruder().setMultiShapeToExtrude(&ms).setExtrusionPath(&p).realizeMesh("extrudedMesh");
 			putMesh("extrudedMesh",1);
@@ -233,11 +262,162 @@ class Unit_Tests : public BaseApplication
 			putMesh(s.realizeMesh());
 			putMesh(Triangulator().setShapeToTriangulate(&s).realizeMesh());
 
+			// The sink receives the same vertices and triangles as the index buffer, announced by begin()
+			{
+				struct CollectingSink : public TriangulationSink
+				{
+					size_t mAnnouncedVertexCount, mAnnouncedTriangleCount;
+					PointList mVertices;
+					std::vector<int> mIndices;
+					CollectingSink() : mAnnouncedVertexCount(0), mAnnouncedTriangleCount(0) {}
+					void begin(size_t numVertices, size_t numTriangles)
+					{
+						mAnnouncedVertexCount = numVertices;
+						mAnnouncedTriangleCount = numTriangles;
+					}
+					void vertex(const Vector2& position)
+					{
+						mVertices.push_back(position);
+					}
+					void triangle(int i0, int i1, int i2)
+					{
+						mIndices.push_back(i0);
+						mIndices.push_back(i1);
+						mIndices.push_back(i2);
+					}
+				};
+				CollectingSink sink;
+				Triangulator().setMultiShapeToTriangulate(&ms).triangulate(sink);
+				std::vector<int> indexBuffer;
+				PointList pointList;
+				Triangulator().setMultiShapeToTriangulate(&ms).triangulate(indexBuffer, pointList);
+				check(sink.mVertices==pointList && sink.mIndices==indexBuffer, "The sink receives the same triangulation as the index buffer");
+				check(sink.mAnnouncedVertexCount==sink.mVertices.size() && sink.mAnnouncedTriangleCount*3==sink.mIndices.size(),
+					"The sink is told how many vertices and triangles are coming");
+
+				// Triangles go straight into the buffer, after the vertices it already holds, facing down
+				TriangleBuffer buffer;
+				IcoSphereGenerator().setNumIterations(1).addToTriangleBuffer(buffer);
+				size_t firstVertex = buffer.getVertexCount();
+				size_t firstIndex = buffer.getIndexCount();
+				Triangulator().setMultiShapeToTriangulate(&ms).addToTriangleBuffer(buffer);
+				bool sameTriangles = buffer.getIndexCount()-firstIndex==indexBuffer.size() && buffer.getVertexCount()-firstVertex==pointList.size();
+				for (size_t i=0;sameTriangles && i<indexBuffer.size();i++)
+				{
+					static const int flipped[3] = {0, 2, 1};
+					sameTriangles = buffer.getIndices()[firstIndex+i]==(int)firstVertex+indexBuffer[i-i%3+flipped[i%3]];
+				}
+				for (size_t i=0;sameTriangles && i<pointList.size();i++)
+					sameTriangles = buffer.getVertices()[firstVertex+i].mPosition==Vector3(pointList[i].x, pointList[i].y, 0);
+				check(sameTriangles, "The triangle buffer receives the same triangles, offset by its previous vertices");
+			}
+
 			Shape s3 = CircleShape().setNumSeg(8).realizeShape();
 			putMesh(Triangulator().setShapeToTriangulate(&s3).realizeMesh());
 
 			s3.translate(Vector2(.5,0));
 			putMesh(Triangulator().setShapeToTriangulate(&s3).realizeMesh());
+
+			// Lots of small shapes, triangulated in the same workspace
+			Triangulator::Workspace workspace;
+			TriangleBuffer tb;
+			for (int i=0;i<100;i++)
+			{
+				Shape s4 = CircleShape().setRadius(.2).setNumSeg(8+i%8).realizeShape().translate(.5*(i%10), .5*(i/10));
+				Triangulator().setShapeToTriangulate(&s4).setWorkspace(&workspace).addToTriangleBuffer(tb);
+			}
+			Utils::log("Workspace : " + StringConverter::toString(workspace.getCallCount()) + " triangulations, "
+				+ StringConverter::toString(workspace.getGrowthCount()) + " of them growing its buffers");
+			putMesh(tb.transformToMesh(Utils::getName()));
+		}
+	};
+
+	class Test_LargeTriangulation : public Unit_Test
+	{
+	public:
+		Test_LargeTriangulation(SceneManager* sn) : Unit_Test(sn) {}
+
+		String getDescription()
+		{
+			return "Large triangulations";
+		}
+
+		void initImpl()
+		{
+			// Coastline-like shape, well beyond the range of 16 bits indices
+			const int numPoints = 1200000;
+			Shape s;
+			for (int i=0;i<numPoints;i++)
+			{
+				Real angle = Math::TWO_PI * i / numPoints;
+				Real radius = 4.f + .3f*Math::Sin(7.f*angle) + .1f*Math::Sin(53.f*angle) + .001f*Math::Sin(1237.f*angle);
+				s.addPoint(radius * Math::Cos(angle), radius * Math::Sin(angle));
+			}
+			s.close();
+
+			// The contour is cut into pieces, which are triangulated in parallel, then stitched back together
+			std::vector<int> indexBuffer;
+			PointList pointList;
+			Triangulator().setShapeToTriangulate(&s).setNumThreads(4).triangulate(indexBuffer, pointList);
+			Utils::log("Large triangulation : " + StringConverter::toString(indexBuffer.size()/3) + " triangles for " + StringConverter::toString(numPoints) + " points");
+			check((int)indexBuffer.size()/3 == numPoints-2, "A simple polygon must be triangulated into n-2 triangles");
+			bool allDirect = true;
+			for (size_t i=0;i<indexBuffer.size();i+=3)
+			{
+				const Vector2& p0 = pointList[indexBuffer[i]];
+				allDirect = allDirect && (pointList[indexBuffer[i+1]]-p0).crossProduct(pointList[indexBuffer[i+2]]-p0)>0;
+			}
+			check(allDirect, "Triangles must be counter-clockwise, wherever the contour was cut");
+
+			// Along a jagged contour, stitching back the pieces gives the triangles of the whole contour
+			// (a smooth one has cocircular points, whose triangles can go either way)
+			Shape jagged;
+			for (int i=0;i<20000;i++)
+			{
+				Real angle = Math::TWO_PI * i / 20000;
+				Real radius = Math::RangeRandom(.9f, 1.1f);
+				jagged.addPoint(radius * Math::Cos(angle), radius * Math::Sin(angle));
+			}
+			jagged.close();
+			std::vector<std::pair<std::pair<int, int>, int> > triangleSets[2];
+			for (int t=0;t<2;t++)
+			{
+				std::vector<int> indices;
+				PointList points;
+				Triangulator().setShapeToTriangulate(&jagged).setNumThreads(t==0?1:4).triangulate(indices, points);
+				// triangles are compared from their smallest index, keeping their orientation
+				for (size_t i=0;i<indices.size();i+=3)
+				{
+					size_t first = std::min_element(indices.begin()+i, indices.begin()+i+3) - indices.begin();
+					size_t second = i + (first-i+1)%3;
+					size_t third = i + (first-i+2)%3;
+					triangleSets[t].push_back(std::make_pair(std::make_pair(indices[first], indices[second]), indices[third]));
+				}
+				std::sort(triangleSets[t].begin(), triangleSets[t].end());
+			}
+			check(triangleSets[0] == triangleSets[1], "Stitching the pieces of a contour must give the same triangles as triangulating it whole");
+
+			putMesh(Triangulator().setShapeToTriangulate(&s).realizeMesh());
+
+			// Archipelago : independent islands with lakes are triangulated in parallel
+			MultiShape archipelago;
+			for (int i=0;i<16;i++)
+			{
+				Vector2 center(8.f*(i%4), 8.f*(i/4));
+				archipelago.addShape(CircleShape().setRadius(3).setNumSeg(20000).realizeShape().translate(center));
+				archipelago.addShape(CircleShape().setRadius(1).setNumSeg(5000).realizeShape().switchSide().translate(center));
+			}
+			putMesh(Triangulator().setMultiShapeToTriangulate(&archipelago).realizeMesh());
+
+			// Bounding box of the archipelago, going through its points without copying them
+			Vector2 archipelagoMin = *archipelago.pointsBegin(), archipelagoMax = archipelagoMin;
+			for (MultiShape::PointIterator it = archipelago.pointsBegin(); it!=archipelago.pointsEnd(); ++it)
+			{
+				archipelagoMin.makeFloor(*it);
+				archipelagoMax.makeCeil(*it);
+			}
+			Utils::log("Archipelago : " + StringConverter::toString(archipelago.getPointCount()) + " points, from "
+				+ StringConverter::toString(archipelagoMin) + " to " + StringConverter::toString(archipelagoMax));
 		}
 	};
 
@@ -272,6 +452,85 @@ class Unit_Tests : public BaseApplication
 			s = s1.booleanDifference(s2);
 			s.realizeMesh("contourdifference");
 			putMesh("contourdifference");
+
+			// detailed outlines barely overlapping
+			Shape s3 = CircleShape().setNumSeg(5000).realizeShape();
+			Shape s4 = CircleShape().setNumSeg(5000).realizeShape().translate(1.8f, 0.f);
+			s = s3.booleanUnion(s4);
+			s.realizeMesh("contourdetailedunion");
+			putMesh("contourdetailedunion");
+
+			// wavy outlines crossing many times : the sweep finds the same crossings, in the same order, as testing every pair of segments
+			{
+				Shape wavy1, wavy2;
+				for (int i=0;i<2000;i++)
+				{
+					Real angle = Math::TWO_PI*i/2000;
+					Real r1 = 1.f+.1f*Math::Sin(40*angle);
+					Real r2 = 1.f+.1f*Math::Cos(37*angle);
+					wavy1.addPoint(r1*Math::Cos(angle), r1*Math::Sin(angle));
+					wavy2.addPoint(r2*Math::Cos(angle)+.05f, r2*Math::Sin(angle));
+				}
+				wavy1.close();
+				wavy2.close();
+				std::vector<Vector2> swept, expected;
+				wavy1.findIntersections(wavy2, swept);
+				for (size_t i=0;i<wavy1.getSegCount();i++)
+					for (size_t j=0;j<wavy2.getSegCount();j++)
+					{
+						Vector2 intersection;
+						if (Segment2D(wavy1.getPoint(i), wavy1.getPoint(i+1)).findIntersect(Segment2D(wavy2.getPoint(j), wavy2.getPoint(j+1)), intersection))
+							expected.push_back(intersection);
+					}
+				check(!expected.empty() && swept==expected, "The sweep finds the crossings of every pair of segments, in the same order");
+			}
+
+			// many overlapping footprints merged at once, then pierced by a multishape with a hole
+			MultiShape footprints;
+			for (int i=0;i<10;i++)
+				for (int j=0;j<10;j++)
+					footprints.addShape(RectangleShape().setWidth(0.3f+0.05f*((i*7+j*3)%5)).setHeight(0.3f).realizeShape().translate(i*0.3f, j*0.3f));
+			MultiShape ring;
+			ring.addShape(CircleShape().setRadius(1.2f).realizeShape().translate(1.5f, 1.5f));
+			ring.addShape(CircleShape().setRadius(0.6f).realizeShape().translate(1.5f, 1.5f).switchSide());
+			// footprints share edges which are only equal up to rounding : snapping them to a grid merges them exactly
+			s = footprints.booleanUnion(MultiShape(), WR_NONZERO, 1e-4f);
+			s.realizeMesh("contourmultiunion");
+			putMesh("contourmultiunion");
+			// when the sweep keeps finding edges which meet, the operation fails rather than giving an empty result
+			{
+				MultiShape unbounded = footprints._booleanUnion(MultiShape(), WR_NONZERO, 1e-4f, 0);
+				MultiShape twoPasses = footprints._booleanUnion(MultiShape(), WR_NONZERO, 1e-4f, 2);
+				check(unbounded.getShapeCount()>0 && twoPasses.getShapeCount()==unbounded.getShapeCount(), "Two sweep passes are enough for the footprints");
+				bool failed = false;
+				try
+				{
+					footprints._booleanUnion(MultiShape(), WR_NONZERO, 1e-4f, 1);
+				}
+				catch (const std::runtime_error&)
+				{
+					failed = true;
+				}
+				check(failed, "A boolean operation whose sweep doesn't converge throws");
+			}
+			s = footprints.booleanDifference(ring);
+			s.realizeMesh("contourmultidifference");
+			putMesh("contourmultidifference");
+			s = footprints.booleanXor(ring);
+			s.realizeMesh("contourmultixor");
+			putMesh("contourmultixor");
+
+			// scatter points over the difference, testing them all at once
+			MultiShape difference = footprints.booleanDifference(ring);
+			PointInsideIndex index(difference);
+			std::vector<Vector2> candidates(100000);
+			for (size_t i=0;i<candidates.size();i++)
+				candidates[i] = Vector2(Math::RangeRandom(-.5f, 3.5f), Math::RangeRandom(-.5f, 3.5f));
+			bool* inside = new bool[candidates.size()];
+			index.isPointInside(&candidates[0], candidates.size(), inside, 0);
+			size_t numInside = std::count(inside, inside+candidates.size(), true);
+			delete[] inside;
+			Utils::log("Scattered points inside the difference : " + StringConverter::toString(numInside) + " / " + StringConverter::toString(candidates.size()));
 		}
 	};
 
@@ -299,6 +558,15 @@ class Unit_Tests : public BaseApplication
 			putMesh(s2.realizeMesh());
 			MultiShape ms2 = s2.thicken(.1);
 			putMesh(ms2.realizeMesh());
+
+			//Offsets, with the different joins
+			Shape s3 = RectangleShape().setWidth(2).setHeight(2).realizeShape().translate(Vector2(0,20));
+			putMesh(s3.realizeMesh());
+			putMesh(s3.offset(.5, JT_MITER).realizeMesh());
+			putMesh(s3.offset(1., JT_ROUND, 2., 32).realizeMesh());
+			putMesh(s3.offset(1.5, JT_SQUARE).realizeMesh());
+			putMesh(s3.offset(-.5).realizeMesh());
+			putMesh(Shape(s).translate(Vector2(10,0)).thicken(.5, JT_ROUND).realizeMesh());
 		}
 	};
 
@@ -325,7 +593,74 @@ class Unit_Tests : public BaseApplication
 				.addPoint(Vector2(-2,2))
 				.setNumSeg(8)
 				.close();
-			putMesh(cs.realizeShape().realizeMesh());
+			Shape csShape = cs.realizeShape();
+			putMesh(csShape.realizeMesh());
+
+			// Same spline, resampled with evenly spaced points
+			Shape resampled;
+			unsigned int cursor = 0;
+			for (int i=0;i<100;i++)
+				resampled.addPoint(csShape.getPosition(i/100.f*csShape.getTotalLength(), cursor));
+			putMesh(resampled.close().translate(5,0).realizeMesh());
+
+			// Same spline, with the points which don't change it by more than 0.02 removed
+			Shape simplified = csShape;
+			simplified.simplify(.02);
+			Utils::log("Simplified spline : " + StringConverter::toString(simplified.getPointCount()) + " points out of " + StringConverter::toString(csShape.getPointCount()));
+			putMesh(simplified.translate(10,0).realizeMesh());
+
+			// Same spline, with segments added where it bends rather than a fixed number per control point
+			Shape adaptive = cs.setMaxDeviation(.01).setMaxAngle(Degree(10)).realizeShape();
+			Utils::log("Adaptive spline : " + StringConverter::toString(adaptive.getPointCount()) + " points");
+			{
+				// a much finer tessellation of the spline stays within the deviation of the adaptive one
+				Shape fine = CatmullRomSpline2(cs).setMaxDeviation(0.).setMaxAngle(Radian(0.)).setNumSeg(64).realizeShape();
+				Real maxDistance = 0.;
+				for (size_t i=0;i<fine.getPointCount();i++)
+				{
+					Real distance = _distanceToSegment(fine.getPoint(i), adaptive.getPoint(0), adaptive.getPoint(1));
+					for (size_t j=1;j<adaptive.getSegCount();j++)
+						distance = std::min(distance, _distanceToSegment(fine.getPoint(i), adaptive.getPoint(j), adaptive.getPoint(j+1)));
+					maxDistance = std::max(maxDistance, distance);
+				}
+				check(maxDistance<=.01f*1.05f, "The adaptive spline stays within its maximum deviation");
+				check(CatmullRomSpline2(cs).setMaxDeviation(.001).realizeShape().getPointCount()>adaptive.getPointCount(),
+					"A smaller deviation gives more points");
+				// straight parts only get their control points
+				CatmullRomSpline2 straight;
+				straight.addPoint(0,0).addPoint(1,0).addPoint(2,0).addPoint(3,0).setMaxDeviation(.01).setMaxAngle(Degree(10));
+				check(straight.realizeShape().getPointCount()==4, "A straight spline only gets its control points");
+			}
+			{
+				// the batched evaluation of curves gives the same points as evaluating them one by one
+				std::vector<HermiteCurve<Vector2> > curves2;
+				std::vector<HermiteCurve<Vector3> > curves3;
+				for (int i=0;i<50;i++)
+				{
+					curves2.push_back(HermiteCurve<Vector2>(Vector2(Math::RangeRandom(-5,5), Math::RangeRandom(-5,5)), Vector2(Math::RangeRandom(-5,5), Math::RangeRandom(-5,5)),
+						Vector2(Math::RangeRandom(-5,5), Math::RangeRandom(-5,5)), Vector2(Math::RangeRandom(-5,5), Math::RangeRandom(-5,5))));
+					curves3.push_back(HermiteCurve<Vector3>(Vector3(Math::RangeRandom(-5,5), Math::RangeRandom(-5,5), Math::RangeRandom(-5,5)),
+						Vector3(Math::RangeRandom(-5,5), Math::RangeRandom(-5,5), Math::RangeRandom(-5,5)),
+						Vector3(Math::RangeRandom(-5,5), Math::RangeRandom(-5,5), Math::RangeRandom(-5,5)),
+						Vector3(Math::RangeRandom(-5,5), Math::RangeRandom(-5,5), Math::RangeRandom(-5,5))));
+				}
+				HermiteBasis basis(13);
+				std::vector<Real> outputs2[2], outputs3[3];
+				basis.evaluate(curves2, 2, outputs2);
+				basis.evaluate(curves3, 3, outputs3);
+				Real maxError = 0.;
+				for (size_t i=0;i<curves2.size();i++)
+					for (size_t j=0;j<basis.getSize();j++)
+					{
+						Real t = (Real)j/(Real)basis.getSize();
+						size_t k = i*basis.getSize()+j;
+						maxError = std::max(maxError, curves2[i].getPoint(t).distance(Vector2(outputs2[0][k], outputs2[1][k])));
+						maxError = std::max(maxError, curves3[i].getPoint(t).distance(Vector3(outputs3[0][k], outputs3[1][k], outputs3[2][k])));
+					}
+				check(outputs2[0].size()==curves2.size()*13 && outputs3[2].size()==curves3.size()*13 && maxError<1e-4,
+					"The batched curve evaluation matches the scalar one");
+			}
+			putMesh(adaptive.translate(15,0).realizeMesh());
 
 			// Kochanek Bartels
 			KochanekBartelsSpline2 kbs2;
@@ -377,6 +712,33 @@ class Unit_Tests : public BaseApplication
 				Shape s = RectangleShape().realizeShape();
 				Extruder ex;
 				putMesh(ex.setShapeToExtrude(&s).setExtrusionPath(&l).setRotationTrack(&t).setScaleTrack(&t2).realizeMesh(),1);
+
+				// smooth scale, which doesn't overshoot its keys, read from a baked table
+				Track smooth = Track(Track::AM_RELATIVE_LINEIC, false).setInterpolationMode(Track::IM_MONOTONIC_CUBIC);
+				for (int i=0;i<=10;i++)
+					smooth.addKeyFrame(i/10., (i%2)?1.:.5);
+				Track exact = smooth;
+				smooth.bakeLookupTable(256);
+				{
+					// reading with a cursor gives the same values as searching the keys from scratch, even when going back
+					unsigned int cursor = 0;
+					bool sameValues = true;
+					Real maxBakedError = 0., minValue = 1., maxValue = .5;
+					for (int i=0;i<=1000;i++)
+					{
+						Real pos = (i<=800)?i/800.:(i-800)/200.;
+						Real value = exact.getValue(pos, cursor);
+						sameValues = sameValues && value==exact.getValue(pos);
+						maxBakedError = std::max(maxBakedError, std::abs(smooth.getValue(pos)-value));
+						minValue = std::min(minValue, value);
+						maxValue = std::max(maxValue, value);
+					}
+					check(sameValues, "Reading the track with a cursor gives the same values");
+					check(minValue>=.5 && maxValue<=1., "The monotonic cubic interpolation doesn't overshoot the keys");
+					check(maxBakedError<.002, "The baked lookup table stays close to the track");
+					Utils::log("Baked track : max error " + StringConverter::toString(maxBakedError));
+				}
+				putMesh(ex.setScaleTrack(&smooth).realizeMesh(),1);
 			}
 
 			// tests different addressing modes for the (scale) track
@@ -416,6 +778,195 @@ class Unit_Tests : public BaseApplication
 				putMesh(ex2.setShapeToExtrude(&unaxed3).setExtrusionPath(&l3).setRotationTrack(&r2).realizeMesh(),1);
 			}
 
+			// capped extrusions of the same shape along several paths share their cap triangulation
+			{
+				Shape s = CircleShape().setNumSeg(32).realizeShape();
+				TriangulationCache cache;
+				Extruder ex;
+				ex.setShapeToExtrude(&s).setTriangulationCache(&cache);
+				for (int i=0;i<4;i++)
+				{
+					Path p = CatmullRomSpline3().addPoint(0,0,0).addPoint(i,2,1).addPoint(0,4,0).realizePath();
+					putMesh(ex.setExtrusionPath(&p).realizeMesh(),1);
+				}
+				check(cache.getMissCount()==1 && cache.getHitCount()==3, "The cap is triangulated once, then found in the cache");
+				Utils::log("Cap triangulation cache : " + StringConverter::toString(cache.getHitCount()) + " hits, "
+					+ StringConverter::toString(cache.getMissCount()) + " misses");
+			}
+
+			// the profile table places a ring as turning each point and normal of the shape by the orientation would
+			{
+				Shape profile = CircleShape().setRadius(.5).setNumSeg(16).realizeShape();
+				ProfileTable table(profile);
+				Vector3 position(1,2,3);
+				Quaternion orientation(Degree(40), Vector3(1,2,-1).normalisedCopy());
+				std::vector<Real> positions[3], normals[3];
+				Real* positionArrays[3];
+				Real* normalArrays[3];
+				for (int k=0;k<3;k++)
+				{
+					positions[k].resize(table.getSize());
+					normals[k].resize(table.getSize());
+					positionArrays[k] = &positions[k][0];
+					normalArrays[k] = &normals[k][0];
+				}
+				table.placeRing(position, orientation, 2., positionArrays, normalArrays);
+				Real maxError = 0.;
+				for (size_t j=0;j<table.getSize();j++)
+				{
+					Vector2 point = profile.getPoint(j);
+					Vector2 normal = profile.getAvgNormal(j);
+					Vector3 expectedPosition = position + orientation*(2.*Vector3(point.x, point.y, 0));
+					Vector3 expectedNormal = orientation*Vector3(normal.x, normal.y, 0);
+					maxError = std::max(maxError, expectedPosition.distance(Vector3(positions[0][j], positions[1][j], positions[2][j])));
+					maxError = std::max(maxError, expectedNormal.distance(Vector3(normals[0][j], normals[1][j], normals[2][j])));
+				}
+				check(table.getSize()==17 && table.getV(16)==1. && maxError<1e-5, "The profile table places rings as the shape would");
+			}
+
+			// cable along a spline : evenly spaced rings, and rings only where it bends
+			{
+				CatmullRomSpline3 cable;
+				cable.addPoint(0,0,0).addPoint(1,3,0).addPoint(1.5,3,1).addPoint(6,4,1).addPoint(12,4,1);
+				Shape s = CircleShape().setRadius(.2).setNumSeg(12).realizeShape();
+				Path evenPath = CatmullRomSpline3(cable).setSegmentLength(.25).realizePath();
+				Path adaptivePath = CatmullRomSpline3(cable).setMaxDeviation(.01).realizePath();
+				putMesh(Extruder().setShapeToExtrude(&s).setExtrusionPath(&evenPath).realizeMesh(),1);
+				Utils::log("Cable : " + StringConverter::toString(evenPath.getSegCount()) + " evenly spaced segments, "
+					+ StringConverter::toString(adaptivePath.getSegCount()) + " adaptive segments");
+
+				// evenly spaced segments are all as long, their chords being a bit shorter where the cable bends
+				Real minLength = evenPath.getPoint(0).distance(evenPath.getPoint(1)), maxLength = minLength;
+				for (size_t i=1;i<evenPath.getSegCount();i++)
+				{
+					Real length = evenPath.getPoint(i).distance(evenPath.getPoint(i+1));
+					minLength = std::min(minLength, length);
+					maxLength = std::max(maxLength, length);
+				}
+				check(maxLength<=.25f*1.001f && minLength>=.25f*.9f, "The cable is sampled at constant speed");
+				// a much finer tessellation of the cable stays within the deviation of the adaptive path
+				Path finePath = CatmullRomSpline3(cable).setNumSeg(64).realizePath();
+				Real maxDistance = 0.;
+				for (size_t i=0;i<=finePath.getSegCount();i++)
+				{
+					Real distance = _distanceToSegment(finePath.getPoint(i), adaptivePath.getPoint(0), adaptivePath.getPoint(1));
+					for (size_t j=1;j<adaptivePath.getSegCount();j++)
+						distance = std::min(distance, _distanceToSegment(finePath.getPoint(i), adaptivePath.getPoint(j), adaptivePath.getPoint(j+1)));
+					maxDistance = std::max(maxDistance, distance);
+				}
+				check(maxDistance<=.01f*1.05f && adaptivePath.getSegCount()<evenPath.getSegCount(),
+					"The adaptive cable stays within its maximum deviation, with fewer segments");
+			}
+
+			// roller coaster : the track goes through a vertical loop without flipping, and leans into the turn
+			{
+				CatmullRomSpline3 coaster;
+				coaster.addPoint(-10,0,0).addPoint(-5,0,0).addPoint(0,0,0).addPoint(3,3,.5).addPoint(0,6,1).addPoint(-3,3,1.5)
+					.addPoint(0,0,2).addPoint(5,0,2).addPoint(10,0,6).addPoint(10,0,12);
+				Path p = coaster.setSegmentLength(.2).realizePath();
+				Shape rail = RectangleShape().setWidth(1.5).setHeight(.2).realizeShape();
+				putMesh(Extruder().setShapeToExtrude(&rail).setExtrusionPath(&p).setFrameMode(Extruder::FM_ROTATION_MINIMIZING).setBanking(2.).realizeMesh(),1);
+			}
+
+			// window grid : the sections along the path are shared by all the contours, which are extruded in parallel
+			{
+				MultiShape windows;
+				windows.addShape(RectangleShape().setWidth(10).setHeight(10).realizeShape());
+				for (int x=0;x<4;x++)
+					for (int y=0;y<4;y++)
+						windows.addShape(RectangleShape().realizeShape().translate(Vector2(x*2.5-3.75,y*2.5-3.75)).switchSide());
+				Path p = CatmullRomSpline3().addPoint(0,0,0).addPoint(2,5,0).addPoint(0,10,0).realizePath();
+				Track twist = Track(Track::AM_RELATIVE_LINEIC).addKeyFrame(0,0).addKeyFrame(1,Math::HALF_PI);
+				putMesh(Extruder().setMultiShapeToExtrude(&windows).setExtrusionPath(&p).setRotationTrack(&twist).setNumThreads(0).realizeMesh(),1);
+				// the rings written by the threads land exactly where a single thread would write them
+				TriangleBuffer serial, parallel;
+				Extruder().setMultiShapeToExtrude(&windows).setExtrusionPath(&p).setRotationTrack(&twist).setNumThreads(1).addToTriangleBuffer(serial);
+				Extruder().setMultiShapeToExtrude(&windows).setExtrusionPath(&p).setRotationTrack(&twist).setNumThreads(4).addToTriangleBuffer(parallel);
+				checkSameBuffers(serial, parallel, "The parallel extrusion gives the same buffer as the serial one");
+			}
+
+			// road being edited : only the rings around the moved point, then the new rings, are written into the mesh
+			{
+				Path road;
+				for (int i=0;i<200;i++)
+					road.addPoint(i*.5, 0, 5*Math::Sin(i*.05));
+				Shape profile = RectangleShape().setWidth(3).setHeight(.3).realizeShape();
+				Extruder ex;
+				ex.setShapeToExtrude(&profile).setExtrusionPath(&road);
+				IncrementalExtruder editor(ex);
+				MeshPtr mesh = editor.realizeMesh();
+				road.setPoint(100, road.getPoint(100)+Vector3(0,2,0));
+				editor.update();
+				check(editor.getUpdatedRingCount()==3, "Moving a point only rewrites the rings around it");
+				check(editor.getPlacedSectionCount()<=5, "Moving a point only places the sections around it again");
+				for (int i=0;i<20;i++)
+					road.addPoint(road.getPoint(road.getSegCount())+Vector3(.5,0,0));
+				editor.update();
+				check(editor.getUpdatedRingCount()==21 && editor.getPlacedSectionCount()<=22, "Appending points only places the new sections");
+				putMesh(mesh,1);
+
+				// the vertices only hold what the extruder is set to produce
+				Extruder bare;
+				bare.setShapeToExtrude(&profile).setExtrusionPath(&road).setEnableNormals(false).setNumTexCoordSet(2);
+				IncrementalExtruder bareEditor(bare);
+				VertexDeclaration* declaration = bareEditor.realizeMesh()->getSubMesh(0)->vertexData->vertexDeclaration;
+				check(declaration->getVertexSize(0)==3*sizeof(float) && declaration->getVertexSize(1)==4*sizeof(float),
+					"The incremental mesh follows the normals and texture coordinates settings");
+			}
+
+			// long road cut into chunks, each with its own bounds, so that the chunks out of view can be culled
+			{
+				Path road = CatmullRomSpline3().addPoint(0,0,0).addPoint(20,0,10).addPoint(40,2,-10).addPoint(60,0,0).setSegmentLength(.5).realizePath();
+				Shape profile = RectangleShape().setWidth(3).setHeight(.3).realizeShape();
+				std::vector<MeshPtr> chunks = Extruder().setShapeToExtrude(&profile).setExtrusionPath(&road).setChunkLength(10).realizeChunkMeshes();
+				for (std::vector<MeshPtr>::iterator it = chunks.begin(); it!=chunks.end(); it++)
+					putMesh(*it,1);
+			}
+
+			// road whose points are generated while it is extruded : only the chunk being built is held in memory
+			{
+				struct RoadSource : public PathSource
+				{
+					int mIndex;
+					RoadSource() : mIndex(0) {}
+					bool nextPoint(Vector3& point)
+					{
+						if (mIndex==400)
+							return false;
+						point = Vector3(mIndex*.25, 0, 5*Math::Sin(mIndex*.02));
+						mIndex++;
+						return true;
+					}
+				};
+				struct MeshSink : public ExtrusionChunkSink
+				{
+					std::vector<MeshPtr> mMeshes;
+					void chunk(TriangleBuffer& buffer, size_t chunkIndex)
+					{
+						mMeshes.push_back(buffer.transformToMesh(Utils::getName()));
+					}
+				};
+				Shape profile = RectangleShape().setWidth(3).setHeight(.3).realizeShape();
+				RoadSource source;
+				MeshSink sink;
+				Extruder().setShapeToExtrude(&profile).setChunkSegCount(50).streamChunks(source, sink);
+				for (std::vector<MeshPtr>::iterator it = sink.mMeshes.begin(); it!=sink.mMeshes.end(); it++)
+					putMesh(*it,1);
+
+				// the length of a streamed path is unknown until its end, so tracks can't be relative to it
+				Track twist = Track(Track::AM_RELATIVE_LINEIC).addKeyFrame(0,0).addKeyFrame(1,Math::HALF_PI);
+				RoadSource otherSource;
+				bool failed = false;
+				try
+				{
+					Extruder().setShapeToExtrude(&profile).setRotationTrack(&twist).streamChunks(otherSource, sink);
+				}
+				catch (const std::runtime_error&)
+				{
+					failed = true;
+				}
+				check(failed, "Streaming with a relative lineic track throws");
+			}
 
 		}
 	};
@@ -438,6 +989,14 @@ class Unit_Tests : public BaseApplication
 			Shape s = cs.realizeShape();
 			Lathe l = Lathe().setShapeToExtrude(&s);
 			putMesh(l.realizeMesh(),1);
+
+			// finely tessellated lathe : angular steps are shared by the hardware threads
+			Shape fine = CatmullRomSpline2(cs).setNumSeg(64).realizeShape();
+			putMesh(Lathe(&fine, 512).setNumThreads(0).realizeMesh(),1);
+			TriangleBuffer serial, parallel;
+			Lathe(&fine, 512).setNumThreads(1).addToTriangleBuffer(serial);
+			Lathe(&fine, 512).setNumThreads(4).addToTriangleBuffer(parallel);
+			checkSameBuffers(serial, parallel, "The parallel lathe gives the same buffer as the serial one");
 		}
 	};
 
@@ -48,6 +48,7 @@ void Unit_Tests::createScene(void)
 		mUnitTests.push_back(new Test_Primitives(mSceneMgr));
 		mUnitTests.push_back(new Test_SharpAngles(mSceneMgr));
 		mUnitTests.push_back(new Test_Triangulation(mSceneMgr));
+		mUnitTests.push_back(new Test_LargeTriangulation(mSceneMgr));
 		mUnitTests.push_back(new Test_ShapeBoolean(mSceneMgr));
 		mUnitTests.push_back(new Test_Extruder(mSceneMgr));
 		mUnitTests.push_back(new Test_Lathe(mSceneMgr));